@@ -0,0 +1,614 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <ParsePatch.hpp>
+#include <ParsePatch/Json.hpp>
+#include <ParsePatch/MappedFile.hpp>
+#include <ParsePatch/Pool.hpp>
+#include <ParsePatch/Split.hpp>
+#include <ParsePatch/Writer.hpp>
+
+namespace {
+
+using namespace ParsePatch;
+using Clock = std::chrono::steady_clock;
+
+const char usage[] = R"(usage: parsepatch <command> [options] <file>...
+
+Commands:
+  stat                    added and removed lines of every file, tab-separated, and the totals
+  files                   names of the changed files, one per line
+  json                    the JSON of rust-parsepatch, one document per line and input
+  filter --path <prefix>  the diffs of the files under <prefix>
+  split [-o <dir>] [--depth <n>]
+                          writes the diffs into <dir>/<directory>.patch by the first <n> (1) directories of their names,
+                          with % and / in <directory> written %25 and %2F, and the top level into <dir>/%root.patch
+  bench [-n <runs>]       parses the inputs <runs> (5) times and prints the throughput of the best run
+
+Options:
+  -j <n>       parse <n> inputs in parallel (0: one per core), for stat, files, json and bench
+  -t, --timings
+               print the time of every phase to stderr
+
+A file is mapped into memory, - reads stdin (once).
+)";
+
+struct Options {
+	std::string_view command;
+	std::vector<std::string_view> files;
+	size_t threads = 1;
+	bool timings = false;
+	std::string_view path;
+	std::filesystem::path out_dir = ".";
+	size_t depth = 1;
+	size_t runs = 5;
+};
+
+/// The time of every phase, printed at the end with `--timings`
+struct Timings {
+	bool enabled = false;
+	std::vector<std::pair<std::string, Clock::duration>> phases;
+	Clock::time_point start = Clock::now();
+
+	/// Ends the current phase
+	void lap(std::string name) {
+		auto now = Clock::now();
+		phases.emplace_back(std::move(name), now - start);
+		start = now;
+	}
+
+	void print() const {
+		if(!enabled) {
+			return;
+		}
+		for(auto &[name, duration]: phases) {
+			std::cerr << name << '\t' << std::chrono::duration<double, std::milli>(duration).count() << " ms\n";
+		}
+	}
+};
+
+/// The inputs, mapped or read from stdin
+struct Inputs {
+	std::vector<MappedFile> mapped;
+	std::string stdin_text;
+	std::vector<std::string_view> views;
+
+	bool open(const std::vector<std::string_view> &files) {
+		// the views of stdin would all be of the last read
+		if(std::count(begin(files), end(files), "-") > 1) {
+			std::cerr << "parsepatch: - can be given once\n";
+			return false;
+		}
+		for(auto file: files) {
+			if(file == "-") {
+				stdin_text.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+				views.emplace_back(stdin_text);
+				continue;
+			}
+			auto some = MappedFile::open(std::filesystem::path(file));
+			if(!some) {
+				std::cerr << "parsepatch: cannot open " << file << '\n';
+				return false;
+			}
+			views.emplace_back(some->view());
+			mapped.emplace_back(std::move(*some));
+		}
+		return true;
+	}
+};
+
+/// The name a file is known by in the output: the new one, the old one if it is deleted
+std::string_view name_of(std::string_view old_name, std::string_view new_name) {
+	return new_name.empty() ? old_name : new_name;
+}
+
+/// Writes `added\tremoved\tname` for every diff and sums them
+struct StatPatch: public Patch {
+	std::string out;
+	uint64_t files = 0, added = 0, removed = 0;
+
+	struct StatDiff: public Diff {
+		StatPatch *patch = nullptr;
+		std::string_view name;
+		uint64_t added = 0, removed = 0;
+
+		virtual void set_info(const std::string_view old_name, const std::string_view new_name, FileOp, std::optional<std::vector<BinaryHunk>>, std::optional<FileMode>) override {
+			name = name_of(old_name, new_name);
+			added = removed = 0;
+		}
+
+		virtual void add_line(uint32_t old_line, uint32_t new_line, std::string_view &&) override {
+			added += !old_line;
+			removed += !new_line;
+		}
+
+		using Diff::new_hunk;
+
+		virtual void new_hunk() override {
+		}
+
+		virtual void close() override {
+			auto &p = *patch;
+			p.out.append(std::to_string(added)).append("\t").append(std::to_string(removed)).append("\t").append(name).append("\n");
+			++p.files;
+			p.added += added;
+			p.removed += removed;
+		}
+	} diff;
+
+	StatPatch() {
+		diff.patch = this;
+	}
+
+	virtual Diff *new_diff() override {
+		return &diff;
+	}
+
+	virtual void close() override {
+	}
+};
+
+/// Writes the name of every diff
+struct FilesPatch: public Patch {
+	std::string out;
+
+	struct FilesDiff: public Diff {
+		std::string *out = nullptr;
+
+		virtual void set_info(const std::string_view old_name, const std::string_view new_name, FileOp, std::optional<std::vector<BinaryHunk>>, std::optional<FileMode>) override {
+			out->append(name_of(old_name, new_name)).push_back('\n');
+		}
+
+		virtual void add_line(uint32_t, uint32_t, std::string_view &&) override {
+		}
+
+		using Diff::new_hunk;
+
+		virtual void new_hunk() override {
+		}
+
+		virtual void close() override {
+		}
+	} diff;
+
+	FilesPatch() {
+		diff.out = &out;
+	}
+
+	virtual Diff *new_diff() override {
+		return &diff;
+	}
+
+	virtual void close() override {
+	}
+};
+
+struct JsonPatch: public JsonWriter {
+	std::string out;
+
+	JsonPatch(): JsonWriter(out) {
+	}
+
+	virtual void close() override {
+		JsonWriter::close();
+		out.push_back('\n');
+	}
+};
+
+/// Counts the diffs and the lines, for `bench`
+struct CountingPatch: public Patch {
+	uint64_t diffs = 0, lines = 0;
+
+	struct CountingDiff: public Diff {
+		CountingPatch *patch = nullptr;
+
+		virtual void set_info(const std::string_view, const std::string_view, FileOp, std::optional<std::vector<BinaryHunk>>, std::optional<FileMode>) override {
+			++patch->diffs;
+		}
+
+		virtual void add_line(uint32_t, uint32_t, std::string_view &&) override {
+			++patch->lines;
+		}
+
+		using Diff::new_hunk;
+
+		virtual void new_hunk() override {
+		}
+
+		virtual void close() override {
+		}
+	} diff;
+
+	CountingPatch() {
+		diff.patch = this;
+	}
+
+	virtual Diff *new_diff() override {
+		return &diff;
+	}
+
+	virtual void close() override {
+	}
+};
+
+/// A patch per input, kept until the outputs are written in the order of the inputs
+template <typename P>
+struct PerInput: public PatchFactory {
+	std::vector<std::unique_ptr<P>> patches;
+	std::vector<ParsepatchError> errors;
+
+	PerInput(size_t count): patches(count), errors(count, ParsepatchError {ParsepatchErrorCode::OK, 0}) {
+	}
+
+	virtual Patch *patch_for(size_t index, size_t) override {
+		patches[index] = std::make_unique<P>();
+		return patches[index].get();
+	}
+
+	virtual void finished(size_t index, size_t, Patch *, ParsepatchError err) override {
+		errors[index] = err;
+	}
+};
+
+/// One patch per worker, for `bench`
+struct PerWorker: public PatchFactory {
+	std::vector<CountingPatch> patches;
+
+	PerWorker(size_t workers): patches(workers) {
+	}
+
+	virtual Patch *patch_for(size_t, size_t worker) override {
+		return &patches[worker];
+	}
+};
+
+/// Prints the errors of the inputs, returns whether there was one
+bool report_errors(const Options &options, const std::vector<ParsepatchError> &errors) {
+	bool failed = false;
+	for(size_t i = 0; i < errors.size(); ++i) {
+		if(errors[i]) {
+			// the operator ends the message with a line end
+			std::cerr << "parsepatch: " << options.files[i] << ": " << errors[i];
+			failed = true;
+		}
+	}
+	return failed;
+}
+
+/// Reports the first failure of writing `target` (the standard output, or a file), returns whether there was one
+bool report_write_error(std::error_code error, std::string_view target) {
+	if(!error) {
+		return false;
+	}
+	std::cerr << "parsepatch: cannot write " << target << ": " << error.message() << '\n';
+	return true;
+}
+
+/// The failure of a stream, found when it is flushed
+std::error_code stream_error(std::ostream &out) {
+	return out.flush() ? std::error_code() : std::make_error_code(std::errc::io_error);
+}
+
+template <typename P>
+int run_text(const Options &options, const Inputs &inputs, Timings &timings) {
+	PerInput<P> factory(inputs.views.size());
+	auto stats = parse_many(inputs.views, factory, options.threads);
+	timings.lap("parse");
+
+	for(auto &patch: factory.patches) {
+		if(patch) {
+			std::cout.write(patch->out.data(), static_cast<std::streamsize>(patch->out.size()));
+		}
+	}
+	if constexpr(std::is_same_v<P, StatPatch>) {
+		uint64_t files = 0, added = 0, removed = 0;
+		for(auto &patch: factory.patches) {
+			if(patch) {
+				files += patch->files;
+				added += patch->added;
+				removed += patch->removed;
+			}
+		}
+		std::cout << added << '\t' << removed << '\t' << files << " files\n";
+	}
+	auto write_error = stream_error(std::cout);
+	timings.lap("output");
+	if(timings.enabled) {
+		std::cerr << "threads\t" << stats.workers.size() << "\nbusy\t" << std::chrono::duration<double, std::milli>(stats.total.busy).count() << " ms\n";
+	}
+	bool failed = report_errors(options, factory.errors);
+	return report_write_error(write_error, "the output") || failed ? 1 : 0;
+}
+
+/// Sends the diffs of the files under a path to partition 0
+struct PathFilter: public Partitioner {
+	std::string_view prefix;
+
+	virtual std::optional<size_t> partition_of(std::string_view old_name, std::string_view new_name) override {
+		auto under = [&](std::string_view name) {
+			// a directory prefix without the trailing slash doesn't match a longer name
+			return name.starts_with(prefix) && (name.size() == prefix.size() || prefix.ends_with('/') || name[prefix.size()] == '/');
+		};
+		if(under(old_name) || under(new_name)) {
+			return 0;
+		}
+		return {};
+	}
+};
+
+int run_filter(const Options &options, const Inputs &inputs, Timings &timings) {
+	PathFilter filter;
+	filter.prefix = options.path;
+	PatchSplitter splitter;
+	std::vector<ParsepatchError> errors;
+	std::error_code write_error;
+	for(auto view: inputs.views) {
+		PatchWriter writer(std::cout);
+		writer.source = view;
+		PatchWriter *outputs[] = {&writer};
+		errors.emplace_back(splitter.split(view, filter, outputs));
+		if(!write_error) {
+			write_error = writer.error;
+		}
+	}
+	if(!write_error) {
+		write_error = stream_error(std::cout);
+	}
+	timings.lap("filter");
+	bool failed = report_errors(options, errors);
+	return report_write_error(write_error, "the output") || failed ? 1 : 0;
+}
+
+/// Sends a diff to the partition of the first directories of its name
+struct DirectoryPartitioner: public Partitioner {
+	size_t depth;
+	std::map<std::string, size_t, std::less<>> partitions;
+
+	std::string directory_of(std::string_view old_name, std::string_view new_name) const {
+		auto name = name_of(old_name, new_name);
+		size_t end = 0;
+		for(size_t i = 0; i < depth; ++i) {
+			auto slash = name.find('/', end);
+			if(slash == std::string_view::npos) {
+				break;
+			}
+			end = slash + 1;
+		}
+		return end ? std::string(name.substr(0, end - 1)) : std::string();
+	}
+
+	virtual std::optional<size_t> partition_of(std::string_view old_name, std::string_view new_name) override {
+		auto directory = directory_of(old_name, new_name);
+		auto [it, added] = partitions.try_emplace(directory, partitions.size());
+		return it->second;
+	}
+};
+
+/// The file of the partition of a directory: its name with `%` and `/` percent-encoded, so that distinct directories get distinct files, all in the output directory. No encoded name starts with `%r`, the top level is `%root.patch`.
+std::string partition_file(std::string_view directory) {
+	if(directory.empty()) {
+		return "%root.patch";
+	}
+	std::string name;
+	for(auto c: directory) {
+		if(c == '%') {
+			name += "%25";
+		} else if(c == '/') {
+			name += "%2F";
+		} else {
+			name += c;
+		}
+	}
+	return name + ".patch";
+}
+
+int run_split(const Options &options, const Inputs &inputs, Timings &timings) {
+	// the directories are collected first, so that a file is opened per partition
+	DirectoryPartitioner partitioner;
+	partitioner.depth = options.depth;
+	PatchSplitter splitter;
+	std::vector<ParsepatchError> errors;
+	for(auto view: inputs.views) {
+		errors.emplace_back(splitter.split(view, partitioner, {}));
+	}
+	timings.lap("scan");
+	if(report_errors(options, errors)) {
+		return 1;
+	}
+
+	std::filesystem::create_directories(options.out_dir);
+	std::vector<std::ofstream> files(partitioner.partitions.size());
+	std::vector<std::filesystem::path> paths(files.size());
+	for(auto &[directory, index]: partitioner.partitions) {
+		paths[index] = options.out_dir / partition_file(directory);
+		files[index].open(paths[index], std::ios::binary);
+		if(!files[index]) {
+			std::cerr << "parsepatch: cannot create " << paths[index].string() << '\n';
+			return 1;
+		}
+	}
+	std::vector<std::error_code> write_errors(files.size());
+	for(auto view: inputs.views) {
+		std::vector<std::unique_ptr<PatchWriter>> writers;
+		std::vector<PatchWriter *> outputs;
+		for(auto &file: files) {
+			writers.emplace_back(std::make_unique<PatchWriter>(file));
+			writers.back()->source = view;
+			outputs.emplace_back(writers.back().get());
+		}
+		splitter.split(view, partitioner, outputs);
+		for(size_t i = 0; i < writers.size(); ++i) {
+			if(!write_errors[i]) {
+				write_errors[i] = writers[i]->error;
+			}
+		}
+	}
+	bool failed = false;
+	for(size_t i = 0; i < files.size(); ++i) {
+		if(!write_errors[i]) {
+			files[i].close();
+			if(!files[i]) {
+				write_errors[i] = std::make_error_code(std::errc::io_error);
+			}
+		}
+		failed |= report_write_error(write_errors[i], paths[i].string());
+	}
+	timings.lap("write");
+	return failed ? 1 : 0;
+}
+
+int run_bench(const Options &options, const Inputs &inputs, Timings &timings) {
+	uint64_t bytes = 0;
+	for(auto view: inputs.views) {
+		bytes += view.size();
+	}
+	std::optional<ParseManyStats> best;
+	uint64_t diffs = 0, lines = 0;
+	for(size_t run = 0; run < std::max<size_t>(options.runs, 1); ++run) {
+		PerWorker factory(std::max<size_t>(options.threads ? options.threads : std::thread::hardware_concurrency(), 1));
+		auto stats = parse_many(inputs.views, factory, options.threads);
+		if(!best || stats.wall < best->wall) {
+			best = stats;
+			diffs = lines = 0;
+			for(auto &p: factory.patches) {
+				diffs += p.diffs;
+				lines += p.lines;
+			}
+		}
+	}
+	timings.lap("bench");
+
+	auto seconds = std::chrono::duration<double>(best->wall).count();
+	std::cout << "inputs\t" << inputs.views.size() << "\nbytes\t" << bytes << "\ndiffs\t" << diffs << "\nlines\t" << lines << "\nerrors\t" << best->total.errors << "\nthreads\t" << best->workers.size() << "\nbest\t" << seconds * 1e3 << " ms\nthroughput\t" << bytes / seconds / 1e6 << " MB/s\nlines/s\t" << lines / seconds << '\n';
+	if(timings.enabled) {
+		for(size_t i = 0; i < best->workers.size(); ++i) {
+			auto &w = best->workers[i];
+			std::cerr << "worker " << i << '\t' << w.inputs << " inputs\t" << std::chrono::duration<double, std::milli>(w.busy).count() << " ms busy\t" << w.steals << " steals\n";
+		}
+	}
+	return best->total.errors ? 1 : 0;
+}
+
+std::optional<size_t> parse_number(std::string_view text) {
+	size_t value;
+	auto res = std::from_chars(text.data(), text.data() + text.size(), value);
+	if(res.ec != std::errc() || res.ptr != text.data() + text.size()) {
+		return {};
+	}
+	return value;
+}
+
+/// Returns nothing on a usage error
+std::optional<Options> parse_options(int argc, char **argv) {
+	if(argc < 2) {
+		return {};
+	}
+	Options options;
+	options.command = argv[1];
+	const std::string_view commands[] = {"stat", "files", "json", "filter", "split", "bench"};
+	if(std::find(std::begin(commands), std::end(commands), options.command) == std::end(commands)) {
+		return {};
+	}
+	for(int i = 2; i < argc; ++i) {
+		std::string_view arg = argv[i];
+		auto value = [&]() -> std::optional<std::string_view> {
+			if(i + 1 >= argc) {
+				return {};
+			}
+			return std::string_view(argv[++i]);
+		};
+		auto number = [&]() -> std::optional<size_t> {
+			auto text = value();
+			return text ? parse_number(*text) : std::nullopt;
+		};
+		std::optional<size_t> n;
+		std::optional<std::string_view> text;
+		if(arg == "-t" || arg == "--timings") {
+			options.timings = true;
+		} else if(arg == "-j") {
+			if(!(n = number())) {
+				return {};
+			}
+			options.threads = *n;
+		} else if(arg == "-n") {
+			if(!(n = number())) {
+				return {};
+			}
+			options.runs = *n;
+		} else if(arg == "--depth") {
+			if(!(n = number()) || !*n) {
+				return {};
+			}
+			options.depth = *n;
+		} else if(arg == "--path") {
+			if(!(text = value())) {
+				return {};
+			}
+			options.path = *text;
+		} else if(arg == "-o") {
+			if(!(text = value())) {
+				return {};
+			}
+			options.out_dir = std::filesystem::path(*text);
+		} else if(arg.starts_with('-') && arg != "-") {
+			return {};
+		} else {
+			options.files.emplace_back(arg);
+		}
+	}
+	if(options.files.empty() || (options.command == "filter" && options.path.empty())) {
+		return {};
+	}
+	return options;
+}
+
+}// namespace
+
+int main(int argc, char **argv) {
+	auto some_options = parse_options(argc, argv);
+	if(!some_options) {
+		std::cerr << usage;
+		return 2;
+	}
+	auto &options = *some_options;
+	std::ios::sync_with_stdio(false);
+
+	Timings timings;
+	timings.enabled = options.timings;
+	Inputs inputs;
+	if(!inputs.open(options.files)) {
+		return 1;
+	}
+	timings.lap("open");
+
+	int status;
+	auto &command = options.command;
+	if(command == "stat") {
+		status = run_text<StatPatch>(options, inputs, timings);
+	} else if(command == "files") {
+		status = run_text<FilesPatch>(options, inputs, timings);
+	} else if(command == "json") {
+		status = run_text<JsonPatch>(options, inputs, timings);
+	} else if(command == "filter") {
+		status = run_filter(options, inputs, timings);
+	} else if(command == "split") {
+		status = run_split(options, inputs, timings);
+	} else {
+		status = run_bench(options, inputs, timings);
+	}
+	timings.print();
+	return status;
+}
@@ -0,0 +1,177 @@
+#pragma once
+/* A stable C API for FFI consumers.
+ *
+ * A patch is parsed once into struct-of-arrays tables kept in a `parsepatch_reader`, then the tables are copied into caller-provided column buffers in batches, so a whole patch crosses the FFI boundary in a handful of calls. Text is never copied: names and lines are described by offsets and lengths into the buffer given to `parsepatch_parse`, so it must outlive the reader (or at least the next `parsepatch_parse` call).
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _MSC_VER
+	#define PARSEPATCH_C_EXPORT_API __declspec(dllexport)
+	#define PARSEPATCH_C_IMPORT_API __declspec(dllimport)
+#else
+	#ifdef _WIN32
+		#define PARSEPATCH_C_EXPORT_API __attribute__((dllexport))
+		#define PARSEPATCH_C_IMPORT_API __attribute__((dllimport))
+	#else
+		#define PARSEPATCH_C_EXPORT_API __attribute__((visibility("default")))
+		#define PARSEPATCH_C_IMPORT_API
+	#endif
+#endif
+
+#ifdef PARSEPATCH_EXPORTS
+	#define PARSEPATCH_C_API PARSEPATCH_C_EXPORT_API
+#else
+	#define PARSEPATCH_C_API PARSEPATCH_C_IMPORT_API
+#endif
+
+/* Bumped on every incompatible change of the structs and functions below */
+#define PARSEPATCH_C_API_VERSION 2
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Mirrors `ParsePatch::ParsepatchErrorCode` */
+enum parsepatch_error_code {
+	PARSEPATCH_OK = 0,
+	PARSEPATCH_INVALID_HUNK_HEADER,
+	PARSEPATCH_NEW_MODE_EXPECTED,
+	PARSEPATCH_NO_FILENAME,
+	PARSEPATCH_INVALID_STRING,
+	PARSEPATCH_INVALID_COMPRESSED_DATA,
+	PARSEPATCH_LINE_TOO_LONG
+};
+
+/* Mirrors `ParsePatch::LineKind` */
+enum parsepatch_line_kind {
+	PARSEPATCH_LINE_CONTEXT = 0,
+	PARSEPATCH_LINE_ADDED,
+	PARSEPATCH_LINE_REMOVED
+};
+
+/* Mirrors `ParsePatch::FileOpCode` */
+enum parsepatch_file_op {
+	PARSEPATCH_FILE_NEW = 0,
+	PARSEPATCH_FILE_DELETED,
+	PARSEPATCH_FILE_RENAMED,
+	PARSEPATCH_FILE_COPIED,
+	PARSEPATCH_FILE_NONE
+};
+
+/* Bits of `parsepatch_diffs::flags`, mirror `ParsePatch::DiffFlags` */
+enum parsepatch_diff_flags {
+	PARSEPATCH_DIFF_BINARY = 1 << 0,
+	PARSEPATCH_DIFF_FILE_MODE = 1 << 1
+};
+
+/* Mirrors `ParsePatch::BinaryHunkType` */
+enum parsepatch_binary_type {
+	PARSEPATCH_BINARY_LITERAL = 0,
+	PARSEPATCH_BINARY_DELTA
+};
+
+/* Mirrors `ParsePatch::Utf8Check` */
+enum parsepatch_utf8_check {
+	PARSEPATCH_UTF8_NONE = 0,
+	PARSEPATCH_UTF8_FILENAMES,
+	PARSEPATCH_UTF8_ALL
+};
+
+typedef struct parsepatch_error {
+	uint8_t code; /* `parsepatch_error_code` */
+	uint64_t line;
+} parsepatch_error;
+
+/* Every table is a set of columns of `capacity` elements owned by the caller.
+ * A column pointer may be NULL if the caller is not interested in it; `capacity` of 0 skips the whole table.
+ * `count` is set to the number of rows written, `first` to the index of the first written row in the whole table.
+ * Indices stored in the columns (`first_hunk`, `first_line`, `diff` ...) are indices in the whole tables, not in the batch.
+ */
+
+typedef struct parsepatch_diffs {
+	size_t capacity, count, first;
+	uint64_t *old_name_offset;
+	uint32_t *old_name_length;
+	uint64_t *new_name_offset;
+	uint32_t *new_name_length;
+	uint8_t *op;	   /* `parsepatch_file_op` */
+	uint32_t *op_mode; /* mode of a new or deleted file */
+	uint32_t *old_mode;
+	uint32_t *new_mode;
+	uint8_t *flags; /* `parsepatch_diff_flags` */
+	uint32_t *first_hunk;
+	uint32_t *hunk_count;
+	uint32_t *first_binary;
+	uint32_t *binary_count;
+} parsepatch_diffs;
+
+typedef struct parsepatch_hunks {
+	size_t capacity, count, first;
+	uint32_t *diff;
+	uint64_t *first_line;
+	uint32_t *line_count;
+	uint32_t *old_count; /* numbers of the `@@` line, 0 for a hunk without one */
+	uint32_t *old_lines;
+	uint32_t *new_count;
+	uint32_t *new_lines;
+	uint64_t *section_offset; /* of the section heading after the `@@` line */
+	uint32_t *section_length;
+} parsepatch_hunks;
+
+typedef struct parsepatch_lines {
+	size_t capacity, count, first;
+	uint8_t *kind; /* `parsepatch_line_kind` */
+	uint32_t *old_line;
+	uint32_t *new_line;
+	uint64_t *offset; /* of the line content without the `+`/`-`/` ` marker */
+	uint32_t *length;
+} parsepatch_lines;
+
+typedef struct parsepatch_binary {
+	size_t capacity, count, first;
+	uint32_t *diff;
+	uint8_t *type; /* `parsepatch_binary_type` */
+	uint64_t *size;
+} parsepatch_binary;
+
+typedef struct parsepatch_batch {
+	parsepatch_diffs diffs;
+	parsepatch_hunks hunks;
+	parsepatch_lines lines;
+	parsepatch_binary binary;
+} parsepatch_batch;
+
+/* Total numbers of rows in the tables of the last parse */
+typedef struct parsepatch_totals {
+	size_t diffs, hunks, lines, binary;
+} parsepatch_totals;
+
+typedef struct parsepatch_reader parsepatch_reader;
+
+/* Returns NULL if the memory cannot be allocated */
+PARSEPATCH_C_API parsepatch_reader *parsepatch_reader_new(void);
+
+PARSEPATCH_C_API void parsepatch_reader_free(parsepatch_reader *reader);
+
+/* Sets what the next parses check to be valid UTF-8 (`parsepatch_utf8_check`), invalid text fails with PARSEPATCH_INVALID_STRING.
+ * Returns nonzero if `check` is not a `parsepatch_utf8_check` value, the setting is then unchanged.
+ */
+PARSEPATCH_C_API int parsepatch_set_utf8_check(parsepatch_reader *reader, int check);
+
+/* Parses the buffer into the tables of the reader and rewinds the batch cursors. Tables of the previous parse are discarded, their memory is reused. */
+PARSEPATCH_C_API parsepatch_error parsepatch_parse(parsepatch_reader *reader, const char *buf, size_t len);
+
+PARSEPATCH_C_API parsepatch_totals parsepatch_get_totals(const parsepatch_reader *reader);
+
+/* Copies the next rows of every table into the batch (each table advances independently, up to its capacity).
+ * Returns nonzero while rows remain in any table whose capacity is not 0.
+ */
+PARSEPATCH_C_API int parsepatch_next_batch(parsepatch_reader *reader, parsepatch_batch *batch);
+
+/* Restarts batching from the first rows */
+PARSEPATCH_C_API void parsepatch_rewind(parsepatch_reader *reader);
+
+#ifdef __cplusplus
+}
+#endif
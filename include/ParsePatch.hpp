@@ -1,8 +1,11 @@
 #pragma once
 #include <cstdint>
 
+#include <iosfwd>
 #include <optional>
 #include <string_view>
+#include <tuple>
+#include <vector>
 
 #if __has_include(<expected>)
 	#include <expected>
@@ -50,7 +53,7 @@ namespace ParsePatch {
 	using expected = std::expected<T, E>;
 
 	template <typename E>
-	using unexpeced = std::unexpected<E>;
+	using unexpected = std::unexpected<E>;
 
 #else
 	#if __has_include(<tl/expected.hpp>)
@@ -100,7 +103,9 @@ enum struct ParsepatchErrorCode : uint8_t {
 	InvalidHunkHeader,
 	NewModeExpected,
 	NoFilename,
-	InvalidString
+	InvalidString,
+	InvalidCompressedData,
+	LineTooLong
 };
 
 struct PARSEPATCH_API ParsepatchError {
@@ -164,6 +169,9 @@ struct PARSEPATCH_API LineReader {
 
 	Result<NumbersT> parse_numbers();
 
+	/// The section heading after the closing `@@` of a hunk line (i.e. the function the hunk is in), empty if there is none
+	std::string_view hunk_section() const;
+
 	static Result<std::string_view> get_filename(std::string_view buf, size_t line);
 
 	uint32_t parse_mode(const std::string_view start);
@@ -195,6 +203,27 @@ struct PARSEPATCH_API Diff {
 	/// A new hunk is created
 	virtual void new_hunk() = 0;
 
+	/// A new hunk is created from an `@@` line: `nums` are its numbers (the line counts give how many lines follow on each side) and `section` is the heading after it. Producers without an `@@` line call `new_hunk()`. Calls `new_hunk()` by default.
+	virtual void new_hunk(const NumbersT &nums, std::string_view section);
+
+	/// The last line added has no line end in its file: a `\ No newline at end of file` line follows it. Does nothing by default.
+	virtual void no_newline();
+
+	/// The number of hunks and of lines of the diff, called after `set_info` by the producers which know them before the hunks (`SnapshotView::replay`), so storage can be reserved once. Does nothing by default.
+	virtual void size_hint(uint32_t hunks, uint64_t lines);
+
+	/// The raw lines of the diff header, from the `diff` (or `---`) line up to the first hunk or the binary data, called after `set_info`. Does nothing by default.
+	virtual void set_header(std::string_view header);
+
+	/// The ids of the names of `set_info` in `PatchReader::interner` (`PathInterner::no_path` for an empty name), called after `set_header` if the reader has an interner. Does nothing by default.
+	virtual void set_path_ids(uint32_t old_id, uint32_t new_id);
+
+	/// The byte range `[begin, end)` of the last hunk in the input, from its `@@` line to the end of its last line (or of the `\ No newline at end of file` line after it), called after its lines. Does nothing by default.
+	virtual void set_hunk_range(uint64_t begin, uint64_t end);
+
+	/// The byte range `[begin, end)` of the diff in the input, from its first header line to the end of its last hunk (or of its header or binary data), called before `close`. Does nothing by default.
+	virtual void set_range(uint64_t begin, uint64_t end);
+
 	/// Close the diff: no more lines will be added
 	virtual void close() = 0;
 };
@@ -211,6 +240,8 @@ struct PARSEPATCH_API Patch {
 
 typedef bool (*NextFilterF)(LineReader &);
 
+struct PathInterner;
+
 namespace ScannerUtils {
 size_t parse_usize(const std::string_view buf);
 
@@ -229,6 +260,42 @@ bool old_mode(LineReader &line);
 bool hunk_change(LineReader &line);
 };// namespace ScannerUtils
 
+/// Everything known about a diff before its hunks: the arguments of `Diff::set_info`
+struct PARSEPATCH_API DiffHeader {
+	std::string_view old_name, new_name;
+	FileOp op;
+	std::optional<std::vector<BinaryHunk>> binary_sizes;
+	std::optional<FileMode> file_mode;
+	/// The `@@` line of the first hunk, if the diff has hunks
+	std::optional<LineReader> hunks;
+	/// The lines of the header, see `Diff::set_header`
+	std::string_view raw;
+	/// The ids of the names, if the reader has an interner
+	uint32_t old_id = 0, new_id = 0;
+};
+
+/// A line of a hunk, numbered as in `Diff::add_line`
+struct HunkLine {
+	uint32_t old_line, new_line;
+	std::string_view line;
+};
+
+/// What `PatchReader` checks to be valid UTF-8. Invalid text is `InvalidString` at its line.
+enum struct Utf8Check : uint8_t {
+	None,     /// Nothing, names and lines are bytes
+	Filenames,/// The names of the files, before `Diff::set_info`
+	All       /// Every byte of the input as well, in the same pass as the search for the line ends. The parse stops after the diff with an invalid line (before it, if the line is in the header).
+};
+
+/// An error passed over by `PatchReader::recover`
+struct PARSEPATCH_API RecoveredError {
+	ParsepatchError error;
+	/// Byte offset in the input (`PatchReader::offset` included) of the start of the line of the error
+	uint64_t offset;
+	/// The error is in the hunks of a diff: the diff is closed (after `Diff::set_range` up to the error) with the lines read before it. Otherwise no `Diff` is created for it, or it is an invalid line (`Utf8Check::All`) of a diff parsed in full or between diffs.
+	bool truncated;
+};
+
 /// Type to read a patch
 struct PARSEPATCH_API PatchReader {
 	std::string_view buf;
@@ -236,6 +303,28 @@ struct PARSEPATCH_API PatchReader {
 	size_t line;
 	std::optional<LineReader> last;
 	std::ostream *tracing = nullptr;
+	/// `buf` is cut right before a `diff -` line (see `ChunkedPatchReader`), so a diff starting with `---` is known to be followed by one
+	bool diff_follows = false;
+	/// Offset of `buf` in the whole input, added to the byte ranges passed to `Diff`
+	uint64_t offset = 0;
+	/// Position of the `\ndiff -` found by the lookahead of the last `---` line, npos if there is none after it
+	std::optional<size_t> diff_ahead {};
+	/// Line number of the `diff -` line at `diff_ahead`, counted once when it is found
+	size_t diff_ahead_line = 0;
+	Utf8Check utf8_check = Utf8Check::None;
+	/// With `Utf8Check::All`, the bytes of `buf` before this position are checked, the next line has number `utf8_line`
+	size_t utf8_checked = 0;
+	size_t utf8_line = 1;
+	/// The first invalid line found by `Utf8Check::All`
+	ParsepatchError utf8_error {ParsepatchErrorCode::OK, 0};
+	/// Gives the names of the diffs ids, see `Diff::set_path_ids`. May be shared by readers on several threads.
+	PathInterner *interner = nullptr;
+	/// Instead of stopping at an error, record it in `errors` and go on from the next line starting a diff (`diff -`, `---`, ...), so a broken diff costs only itself. `parse` then succeeds unless the patch can't be read at all. Used by `by_buf`, `parse` and `ChunkedPatchReader`, not by `WindowedPatchReader`.
+	bool recover = false;
+	/// The errors passed over since `reset`, in the order of the input
+	std::vector<RecoveredError> errors {};
+	/// The section heading of the `@@` line read by the last `next_hunk`
+	std::string_view hunk_section {};
 
 	void reset();
 
@@ -243,23 +332,57 @@ struct PARSEPATCH_API PatchReader {
 
 	size_t get_line() const;
 
+	/// Position in `buf` of the first line not consumed yet (a line read ahead is not consumed)
+	size_t consumed() const;
+
+	/// `consumed`, moved past a `\ No newline at end of file` line left after the end of a hunk
+	size_t hunk_end() const;
+
 	//<Diff D, Patch<D> P>
 	ParsepatchError parse(Patch &patch);
 
+	/// `parse` without closing the patch, so a patch can be assembled from several buffers
+	ParsepatchError parse_diffs(Patch &patch);
+
 	ParsepatchError parse_diff(LineReader &diff_line, Patch &patch);
 
-	ParsepatchError parse_minus(LineReader &line, FileOp op, std::optional<FileMode> file_mode, Patch &patch);
+	/// Reads the header of the diff starting at `diff_line`. `header` is left empty if the lines turn out not to be a diff.
+	ParsepatchError parse_diff_header(LineReader &diff_line, std::optional<DiffHeader> &header);
+
+	/// `parse_diff_header` without `DiffHeader::raw` of most kinds of diffs
+	ParsepatchError read_diff_header(LineReader &diff_line, std::optional<DiffHeader> &header);
+
+	ParsepatchError parse_minus(LineReader &line, FileOp op, std::optional<FileMode> file_mode, std::optional<DiffHeader> &header);
 
 	ParsepatchError parse_hunks(LineReader &line, Diff *diff);
 
 	void parse_hunk(NumbersT lines_count, Diff *diff);
 
+	/// Reads the `@@` line of the next hunk of the current diff. `first` is the one from `DiffHeader::hunks`, it is consumed by the first call. Returns nothing when the diff has no more hunks.
+	Result<std::optional<NumbersT>> next_hunk(std::optional<LineReader> &first);
+
+	/// Reads the next line of the current hunk, `lines_count` are the numbers of its `@@` line, updated on every line. Returns nothing at the end of the hunk.
+	std::optional<HunkLine> next_hunk_line(NumbersT &lines_count);
+
+	/// Reads the `\ No newline at end of file` line following the hunk line read last, if there is one
+	bool next_no_newline();
+
 	void set_last(LineReader line);
 
+	/// Appends an error to `errors`, the offset of its line is found from the line `anchor_line` starting at `anchor`
+	void record_error(ParsepatchError err, size_t anchor, size_t anchor_line, bool truncated = false);
+
 	std::optional<LineReader> next(NextFilterF filter, bool return_on_false);
 
+	/// The next line of a diff header. A `diff -` line starts the next diff, it is left unread as if the buffer ended before it, so a broken header never takes it.
+	std::optional<LineReader> next_header_line();
+
+	/// Skips a binary hunk up to the empty line after it, or up to a `diff -` line
 	void skip_until_empty_line();
 
+	/// Checks the lines from `utf8_checked` to `until` (the start of a line or the end of `buf`) jumped over without reading them
+	void check_utf8(size_t until);
+
 	std::vector<BinaryHunk> skip_binary();
 };
 
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+
+#include <filesystem>
+#include <string_view>
+
+#include "../ParsePatch.hpp"
+#include "EventLog.hpp"
+
+namespace ParsePatch {
+
+/// A content-addressed on-disk cache of parse results, wrapping `PatchReader::by_buf`.
+///
+/// A buffer is identified by its XXH64, its size and `reader.utf8_check`. On a hit the event log (`EventLogWriter`) stored in the cache directory is mapped and replayed to the consumer instead of parsing the buffer, so the consumer gets the same callbacks as from a parse; on a miss the buffer is parsed and the log is stored. A reader with `recover` or an `interner` bypasses the cache: the errors and the path ids belong to the parse. Entries are published by renaming a complete temporary file, and evicted least-recently-used first (by modification time, which is refreshed on every hit) once the directory grows beyond `max_size`, so several processes on one host can share a directory. The directory is scanned when the cache is created and then only when the size scanned plus the entries stored since exceeds `max_size`, so entries stored by other processes are noticed late.
+struct PARSEPATCH_API ParseCache {
+	std::filesystem::path directory;
+	uint64_t max_size;
+	PatchReader reader {};
+
+	/// Counters of this object only, not of the whole directory
+	struct Stats {
+		uint64_t hits = 0, misses = 0, stores = 0, evictions = 0;
+		/// Parses not looked up because of the reader options
+		uint64_t bypassed = 0;
+	} stats;
+
+	/// Creates the directory if needed and evicts from it
+	ParseCache(std::filesystem::path directory, uint64_t max_size);
+
+	/// Same as `PatchReader::by_buf`. Filesystem errors are not reported: the cache is just bypassed.
+	ParsepatchError by_buf(std::string_view buf, Patch &patch);
+
+	/// Path of the entry for a buffer with the current `reader.utf8_check`
+	std::filesystem::path entry_path(std::string_view buf) const;
+
+	/// Scans the directory and removes the least recently used entries until the size of the cache is within `max_size`
+	void evict();
+
+private:
+	EventLogWriter writer;
+	/// Size of the directory at the last scan plus the entries stored since
+	uint64_t estimated_size = 0;
+};
+
+};// namespace ParsePatch
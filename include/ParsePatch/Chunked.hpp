@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "../ParsePatch.hpp"
+
+namespace ParsePatch {
+
+/// A producer of input split into pieces of arbitrary size
+struct PARSEPATCH_API ChunkSource {
+	virtual ~ChunkSource();
+
+	/// Returns the next piece of the input, valid until the next call. An empty piece means the end of the input.
+	virtual Result<std::string_view> next_chunk() = 0;
+};
+
+/// Parses input arriving in chunks without holding all of it in memory.
+///
+/// Chunks are accumulated until a `diff -` line is seen, then everything before that line is parsed and dropped, so memory is bounded by the largest diff (plus a chunk). Views passed to `Diff` are valid only until the diff is closed. Patches without `diff -` lines are accumulated whole.
+struct PARSEPATCH_API ChunkedPatchReader {
+	PatchReader reader {};
+
+	/// Parses the whole input of the source and closes the patch
+	ParsepatchError parse(ChunkSource &source, Patch &patch);
+
+	/// Parses a buffer which may be compressed with any of the formats detected by `detect_compression`. Compressed input is inflated on a separate thread, overlapping with parsing; plain input is parsed in place by `PatchReader::by_buf`.
+	ParsepatchError by_compressed_buf(std::string_view buf, Patch &patch);
+
+private:
+	std::string pending;
+
+	ParsepatchError parse_pending(size_t size, bool diff_follows, Patch &patch);
+};
+
+/// Parses input of any size in a window of a fixed size, i.e. `git log -p` streams with generated diffs of millions of lines.
+///
+/// Chunks are copied into the window, and when the next line is not whole in it, the unparsed rest is moved to the start of the window and the window is filled up again. So memory is bounded by the window (plus the chunks of the source) whatever the size of a diff, at the price of the lifetime of views: names, headers and lines passed to `Diff` are valid only until the callback returns.
+///
+/// A line longer than the window is `LineTooLong`, and so is a header (up to its first hunk) longer than the window; the body of a `GIT binary patch` may be of any size. Everything else is parsed as by `PatchReader`, but looking only as far as the window: the lookahead of a diff starting with `---` doesn't see past it.
+struct PARSEPATCH_API WindowedPatchReader {
+	PatchReader reader {};
+
+	WindowedPatchReader(size_t window_size = 1 << 20);
+
+	/// Parses the whole input of the source and closes the patch
+	ParsepatchError parse(ChunkSource &source, Patch &patch);
+
+private:
+	std::unique_ptr<char[]> window;
+	size_t capacity, filled = 0;
+	ChunkSource *source = nullptr;
+	/// The part of the last chunk not copied into the window yet
+	std::string_view pending;
+	bool eof = false;
+
+	/// Copies chunks into the window until it is full or the input ends
+	ParsepatchError fill();
+
+	/// Drops the first `from` bytes of the window. `held` is a line already read, which is moved with the rest.
+	void compact(size_t from, std::optional<LineReader> *held);
+
+	/// Makes sure the next line to read is whole in the window
+	ParsepatchError ensure_line(std::optional<LineReader> *held);
+
+	/// Reads the hunks of a `GIT binary patch` from the current line, refilling the window
+	ParsepatchError skip_binary(std::vector<BinaryHunk> &sizes);
+
+	ParsepatchError parse_diff(LineReader &diff_line, Patch &patch);
+};
+
+};// namespace ParsePatch
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "../ParsePatch.hpp"
+#include "PathInterner.hpp"
+#include "Pool.hpp"
+
+namespace ParsePatch {
+
+struct PARSEPATCH_API ChurnStats {
+	uint64_t added = 0, removed = 0;
+	/// Number of commits changing the file, or any file in the directory
+	uint64_t commits = 0;
+
+	ChurnStats &operator+=(const ChurnStats &other);
+};
+
+/// The churn of a history, keyed by the ids of a `PathInterner`
+struct PARSEPATCH_API ChurnReport {
+	/// A rename or a copy found in the history
+	struct Rename {
+		size_t commit;
+		/// The ids of the names in the commit
+		uint32_t from, to;
+		bool copy;
+	};
+
+	/// Indexed by path id: the churn of the file whose last name is the path. It includes the changes made under the former names of the file. Paths which are not the last name of a file have zero stats.
+	std::vector<ChurnStats> files;
+	/// Indexed by path id: the churn of all the files (by their last names) in the directory and its subdirectories. A directory is named without a trailing `/`, the files at the top have none.
+	std::vector<ChurnStats> directories;
+	/// In commit order
+	std::vector<Rename> renames;
+	/// The indices of the commits which couldn't be parsed, they are left out
+	std::vector<size_t> failed;
+	ParseManyStats parse;
+};
+
+/// Computes the per-file and per-directory churn of a history, `commits` being the patches of its commits from the oldest to the newest (i.e. `git log --reverse -p` split per commit).
+///
+/// The commits are parsed in parallel by `parse_many`, sharing `paths`, into small per-worker records of the changed files (ids, operation, counts of added and removed lines). The renames are then resolved in one pass from the newest commit to the oldest, which only maps integers: the changes made to a file before it is renamed are attributed to its last name, and a name freed by a rename starts a new file when it is reused. Files are keyed by name, so a file deleted and created again at the same path has one entry. A copy is a new file: the history of its source stays with the source, which still exists. Finally the records are accumulated in parallel over ranges of commits into per-thread arrays indexed by path id, which are summed at the end.
+PARSEPATCH_API ChurnReport compute_churn(std::span<const std::string_view> commits, PathInterner &paths, size_t threads = 0);
+
+};// namespace ParsePatch
@@ -0,0 +1,109 @@
+#pragma once
+#include <cstdint>
+
+#include <string_view>
+#include <vector>
+
+#include "../ParsePatch.hpp"
+
+namespace ParsePatch {
+
+/// What a line in a hunk does
+enum struct LineKind : uint8_t {
+	Context,/// The line is present in both files
+	Added,	/// The line is present only in the new file
+	Removed /// The line is present only in the old file
+};
+
+/// Flags of a row in `ColumnarPatch::DiffTable`
+enum DiffFlags : uint8_t {
+	DIFF_BINARY = 1 << 0,  /// The diff has a `GIT binary patch`, see `ColumnarPatch::BinaryTable`
+	DIFF_FILE_MODE = 1 << 1/// `old_mode` and `new_mode` are meaningful
+};
+
+/// Flags of a row in `ColumnarPatch::LineTable`
+enum LineFlags : uint8_t {
+	LINE_NO_NEWLINE = 1 << 0/// The line has no line end in its file(s), `Diff::no_newline` was called after it
+};
+
+/// A `Patch` storing the parse results in struct-of-arrays tables.
+///
+/// Nothing is copied: names and lines are stored as offsets into `source`, so it must outlive the tables. Rows reference each other by their indices in the tables.
+struct PARSEPATCH_API ColumnarPatch: public Patch {
+	struct DiffTable {
+		std::vector<uint64_t> old_name_offset, new_name_offset;
+		std::vector<uint32_t> old_name_length, new_name_length;
+		std::vector<FileOpCode> op;
+		std::vector<uint32_t> op_mode;/// `FileOp::something`
+		std::vector<uint32_t> old_mode, new_mode;
+		std::vector<uint8_t> flags;/// `DiffFlags`
+		std::vector<uint32_t> first_hunk, hunk_count;
+		std::vector<uint32_t> first_binary, binary_count;
+
+		size_t size() const;
+	} diffs;
+
+	struct HunkTable {
+		std::vector<uint32_t> diff;
+		std::vector<uint64_t> first_line;
+		std::vector<uint32_t> line_count;
+		std::vector<uint32_t> old_count, old_lines, new_count, new_lines;/// `NumbersT` of the `@@` line, 0 if the hunk was started by `Diff::new_hunk()`
+		std::vector<uint64_t> section_offset;/// of the section heading in `source`
+		std::vector<uint32_t> section_length;
+
+		size_t size() const;
+	} hunks;
+
+	struct LineTable {
+		std::vector<LineKind> kind;
+		std::vector<uint32_t> old_line, new_line;
+		std::vector<uint64_t> offset;/// of the line content (without the `+`/`-`/` ` marker) in `source`
+		std::vector<uint32_t> length;
+		std::vector<uint8_t> flags;/// `LineFlags`
+
+		size_t size() const;
+	} lines;
+
+	struct BinaryTable {
+		std::vector<uint32_t> diff;
+		std::vector<BinaryHunkType> type;
+		std::vector<uint64_t> hunk_size;/// `BinaryHunk::size`
+
+		size_t size() const;
+	} binary;
+
+	/// The buffer all the offsets are relative to
+	std::string_view source;
+
+	/// Drops all the rows and rebinds the tables to a new buffer. The capacity of the tables is kept, so the object can be reused.
+	void reset(std::string_view source);
+
+	/// Offset of a view into `source`. Views not pointing into `source` (i.e. empty names of `/dev/null`) are mapped to 0.
+	uint64_t offset_of(std::string_view view) const;
+
+	/// Resolves an offset and a length back into a view into `source`
+	std::string_view view(uint64_t offset, uint32_t length) const;
+
+	virtual Diff *new_diff() override;
+
+	virtual void close() override;
+
+private:
+	struct PARSEPATCH_API DiffCollector: public Diff {
+		ColumnarPatch *table = nullptr;
+
+		virtual void set_info(const std::string_view old_name, const std::string_view new_name, FileOp op, std::optional<std::vector<BinaryHunk>> binary_sizes, std::optional<FileMode> file_mode) override;
+
+		virtual void add_line(uint32_t old_line, uint32_t new_line, std::string_view &&line) override;
+
+		virtual void new_hunk() override;
+
+		virtual void new_hunk(const NumbersT &nums, std::string_view section) override;
+
+		virtual void no_newline() override;
+
+		virtual void close() override;
+	} collector;
+};
+
+};// namespace ParsePatch
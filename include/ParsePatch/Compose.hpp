@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+
+#include <iosfwd>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "../ParsePatch.hpp"
+#include "Columnar.hpp"
+
+namespace ParsePatch {
+
+enum struct ConflictKind : uint8_t {
+	ContextMismatch,/// A line the second patch expects differs from the one the first patch leaves
+	FileDeleted,	/// The second patch changes a file the first one deletes
+	FileExists,		/// The second patch creates a file the first one leaves in place
+	Binary			/// Both patches change the same binary file
+};
+
+/// The single diff equivalent to applying several patches one after another, computed from the hunk lines only, without the contents of the files.
+///
+/// Lines of two patches are merged by their numbers in the intermediate file (the new side of the first patch, the old side of the second): a line added by the first patch and removed by the second cancels out, the other lines keep their kinds, and hunks are rebuilt from the resulting runs. A missing line end at the end of a file is part of the last line: a line differing only by it is not the same line. Text is not copied, so the sources of the parsed patches must outlive the result. The result is meaningful only if there are no `conflicts`.
+struct PARSEPATCH_API ComposedPatch {
+	struct Line {
+		LineKind kind;
+		/// 0 on the side the line is absent from, like in `Diff::add_line`
+		uint32_t old_line, new_line;
+		std::string_view text;
+		/// The line has no line end in the file(s) it is in, see `Diff::no_newline`
+		bool no_newline = false;
+	};
+
+	struct Hunk {
+		/// The numbers of the `@@` line
+		NumbersT numbers;
+		size_t first_line, line_count;
+	};
+
+	struct File {
+		std::string_view old_name, new_name;
+		FileOp op {FileOpCode::None};
+		std::optional<FileMode> file_mode;
+		bool binary = false;
+		std::vector<Line> lines;
+		std::vector<Hunk> hunks;
+	};
+
+	struct Conflict {
+		ConflictKind kind;
+		/// The name of the file in the intermediate state
+		std::string_view name;
+		/// The line in the intermediate file, 0 if the conflict is not about a line
+		uint32_t line;
+		/// Index of the patch which doesn't compose with the ones before it
+		size_t patch;
+	};
+
+	std::vector<File> files;
+	std::vector<Conflict> conflicts;
+	/// Number of patches composed into this one
+	size_t patches = 0;
+
+	/// A patch equivalent to a parsed one
+	static ComposedPatch from(const ColumnarPatch &patch);
+
+	/// Composes this patch with `next` applied after it
+	void then(const ComposedPatch &next);
+
+	/// Feeds the files to a `Patch` as if this patch was parsed, and closes it. Binary diffs come without `BinaryHunk`s, their data is not kept.
+	void replay(Patch &patch) const;
+
+	/// Writes a git-style unified diff with a `PatchWriter`
+	void write_unified(std::ostream &out) const;
+};
+
+/// Composes the patches in order
+PARSEPATCH_API ComposedPatch compose(std::span<const ColumnarPatch *const> patches);
+
+};// namespace ParsePatch
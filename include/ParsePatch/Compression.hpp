@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../ParsePatch.hpp"
+#include "Chunked.hpp"
+
+namespace ParsePatch {
+
+enum struct Compression : uint8_t {
+	None,
+	Gzip,
+	Zstd,
+	Xz
+};
+
+/// Detects the format by the magic bytes in the beginning of the data
+PARSEPATCH_API Compression detect_compression(std::string_view head);
+
+/// Whether the library was built with a decoder of the format
+PARSEPATCH_API bool compression_supported(Compression format);
+
+struct Decoder;
+
+/// Decompresses an in-memory buffer on a separate thread.
+///
+/// The thread fills up to `queue_depth` buffers of `chunk_size` bytes ahead of the consumer and then waits for them to be consumed, so memory usage doesn't depend on the size of the decompressed data. A chunk returned by `next_chunk` is recycled on the next call.
+struct PARSEPATCH_API DecompressingSource: public ChunkSource {
+	DecompressingSource(std::string_view compressed, Compression format, size_t chunk_size = 1 << 20, size_t queue_depth = 4);
+	virtual ~DecompressingSource();
+
+	virtual Result<std::string_view> next_chunk() override;
+
+private:
+	std::unique_ptr<Decoder> decoder;
+	std::vector<std::string> buffers;
+	std::deque<std::pair<std::string *, size_t>> filled;/// chunks ready to be consumed and their sizes
+	std::deque<std::string *> free;
+	std::string *consumed = nullptr;/// the chunk the consumer currently holds
+	bool finished = false, failed = false, stopping = false;
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::thread thread;
+
+	void run();
+};
+
+};// namespace ParsePatch
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../ParsePatch.hpp"
+
+namespace ParsePatch {
+
+/// A `Patch` recording every callback into a compact log, to replay a parse with `replay_event_log` as many times as needed, i.e. to feed several consumers or to debug one.
+///
+/// The log is a stream of tagged records with LEB128 numbers. Text is not copied: a view into `source` is its length and its distance from the end of the previous view, and line numbers are the differences from the ones expected after the previous line, so a line usually takes 2 bytes. Views outside `source` (i.e. produced by a filter) are stored inline. All the callbacks are recorded, including the numbers and the section heading of the hunks, `set_header`, the byte ranges and the path ids (which mean something only to the interner the parse used).
+struct PARSEPATCH_API EventLogWriter: public Patch {
+	static constexpr char magic_value[8] = {'P', 'P', 'E', 'V', 'L', 'O', 'G', '\1'};
+
+	/// The buffer the parsed views point into
+	std::string_view source;
+	std::string log;
+
+	EventLogWriter(std::string_view source = {});
+
+	/// Starts a new log for another source
+	void reset(std::string_view source);
+
+	virtual Diff *new_diff() override;
+
+	virtual void close() override;
+
+private:
+	struct PARSEPATCH_API Recorder: public Diff {
+		EventLogWriter *writer = nullptr;
+
+		virtual void set_info(const std::string_view old_name, const std::string_view new_name, FileOp op, std::optional<std::vector<BinaryHunk>> binary_sizes, std::optional<FileMode> file_mode) override;
+
+		virtual void set_header(std::string_view header) override;
+
+		virtual void set_path_ids(uint32_t old_id, uint32_t new_id) override;
+
+		virtual void add_line(uint32_t old_line, uint32_t new_line, std::string_view &&line) override;
+
+		virtual void new_hunk() override;
+
+		virtual void new_hunk(const NumbersT &nums, std::string_view section) override;
+
+		virtual void no_newline() override;
+
+		virtual void size_hint(uint32_t hunks, uint64_t lines) override;
+
+		virtual void set_hunk_range(uint64_t begin, uint64_t end) override;
+
+		virtual void set_range(uint64_t begin, uint64_t end) override;
+
+		virtual void close() override;
+	} recorder;
+
+	/// The end of the last view in `source`
+	uint64_t cursor = 0;
+	/// The end of the last byte range
+	uint64_t range_end = 0;
+	/// The line numbers expected for the next line
+	uint32_t old_next = 0, new_next = 0;
+
+	void put(uint64_t value);
+
+	void put_signed(int64_t value);
+
+	void put_view(std::string_view view);
+};
+
+/// Feeds a log of `EventLogWriter` to the consumer as if `source` was parsed again, without looking at the text. `source` must be the buffer the log was recorded from. Returns false without calling the consumer if the log is not a log or the size of `source` doesn't match, or stops and returns false on a damaged record.
+PARSEPATCH_API bool replay_event_log(std::string_view log, std::string_view source, Patch &patch);
+
+/// Returns true if `replay_event_log` replays the whole log, without calling any consumer. A log from an untrusted place (i.e. a file) is checked first when a consumer must not see the events of a replay stopping halfway.
+PARSEPATCH_API bool check_event_log(std::string_view log, std::string_view source);
+
+};// namespace ParsePatch
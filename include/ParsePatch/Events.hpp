@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+
+#include <string_view>
+
+#include "../ParsePatch.hpp"
+#include "Generator.hpp"
+
+namespace ParsePatch {
+
+enum struct PatchEventKind : uint8_t {
+	Diff,	/// `header` is set
+	Hunk,	/// `numbers` and `section` are set
+	Line,	/// `line` is set
+	NoNewline,/// The line before has no line end in its file (`Diff::no_newline`)
+	DiffEnd,/// The diff has no more hunks
+	Error	/// `error` is set, nothing follows
+};
+
+/// One step of parsing, the pull counterpart of a `Patch`/`Diff` callback
+struct PatchEvent {
+	PatchEventKind kind;
+	/// The header of the diff, valid until the next `Diff` event
+	const DiffHeader *header = nullptr;
+	/// The numbers of the `@@` line
+	NumbersT numbers {};
+	/// The section heading after the `@@` line
+	std::string_view section {};
+	HunkLine line {};
+	ParsepatchError error {ParsepatchErrorCode::OK, 0};
+};
+
+/// Parses `buf` lazily: every event is produced when the consumer asks for it, so parsing can be interleaved with other work on the same thread and stopped at any point (destroying the generator stops it).
+///
+/// Views are into `buf`, like with `PatchReader::by_buf`. `reader` is used for the parse state and must outlive the generator. Consume with `for(auto &&event: patch_events(reader, buf))`.
+PARSEPATCH_API Generator<PatchEvent> patch_events(PatchReader &reader, std::string_view buf);
+
+};// namespace ParsePatch
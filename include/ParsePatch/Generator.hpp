@@ -0,0 +1,122 @@
+#pragma once
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#if __has_include(<generator>)
+	#include <generator>
+#endif
+
+namespace ParsePatch {
+
+#if defined(__cpp_lib_generator)
+	template <typename T>
+	using Generator = std::generator<T>;
+#else
+	/// A minimal stand-in for `std::generator<T>` for standard libraries lacking it.
+	///
+	/// Only what range-`for` needs is implemented: a single-pass iterator dereferencing to `T&&`, like the one of `std::generator<T>`, so the same loops compile with either.
+	template <typename T>
+	struct Generator {
+		using value_type = std::remove_cvref_t<T>;
+		using reference = std::add_rvalue_reference_t<T>;
+
+		struct promise_type {
+			std::add_pointer_t<reference> value = nullptr;
+			std::exception_ptr exception;
+
+			Generator get_return_object() {
+				return Generator {std::coroutine_handle<promise_type>::from_promise(*this)};
+			}
+
+			std::suspend_always initial_suspend() noexcept {
+				return {};
+			}
+
+			std::suspend_always final_suspend() noexcept {
+				return {};
+			}
+
+			/// The yielded object lives in the coroutine frame until the coroutine is resumed, so it is not copied
+			std::suspend_always yield_value(reference v) noexcept {
+				value = std::addressof(v);
+				return {};
+			}
+
+			void return_void() noexcept {}
+
+			void unhandled_exception() {
+				exception = std::current_exception();
+			}
+
+			template <typename U>
+			void await_transform(U &&) = delete;
+		};
+
+		struct iterator {
+			using value_type = Generator::value_type;
+			using difference_type = std::ptrdiff_t;
+
+			std::coroutine_handle<promise_type> handle;
+
+			reference operator*() const {
+				return static_cast<reference>(*handle.promise().value);
+			}
+
+			iterator &operator++() {
+				handle.resume();
+				rethrow();
+				return *this;
+			}
+
+			void operator++(int) {
+				++*this;
+			}
+
+			bool operator==(std::default_sentinel_t) const {
+				return handle.done();
+			}
+
+			void rethrow() const {
+				if(handle.done() && handle.promise().exception) {
+					std::rethrow_exception(handle.promise().exception);
+				}
+			}
+		};
+
+		Generator(Generator &&other) noexcept: handle(std::exchange(other.handle, {})) {}
+
+		Generator &operator=(Generator &&other) noexcept {
+			std::swap(handle, other.handle);
+			return *this;
+		}
+
+		~Generator() {
+			if(handle) {
+				handle.destroy();
+			}
+		}
+
+		/// Runs the coroutine until the first value. Can be called only once.
+		iterator begin() {
+			iterator it {handle};
+			handle.resume();
+			it.rethrow();
+			return it;
+		}
+
+		std::default_sentinel_t end() const noexcept {
+			return {};
+		}
+
+	private:
+		std::coroutine_handle<promise_type> handle;
+
+		explicit Generator(std::coroutine_handle<promise_type> handle): handle(handle) {}
+	};
+#endif
+
+};// namespace ParsePatch
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+
+#include <array>
+#include <string_view>
+
+#include "../ParsePatch.hpp"
+
+namespace ParsePatch {
+
+/// XXH64 (https://github.com/Cyan4973/xxHash), a fast non-cryptographic hash. The results are the same as of the reference implementation, so they can be computed by other tools too.
+PARSEPATCH_API uint64_t hash64(std::string_view data, uint64_t seed = 0);
+
+/// Incremental XXH64: the digest of the concatenation of all the updates is the same as `hash64` of it
+struct PARSEPATCH_API Hasher64 {
+	explicit Hasher64(uint64_t seed = 0);
+
+	void reset(uint64_t seed = 0);
+
+	void update(std::string_view data);
+
+	uint64_t digest() const;
+
+private:
+	uint64_t acc[4];
+	uint64_t seed;
+	uint64_t total = 0;
+	uint8_t stripe[32];
+	uint32_t stripe_size = 0;
+};
+
+/// Incremental SHA-1, for the identifiers git computes with it. Not to be relied upon for security.
+struct PARSEPATCH_API Sha1 {
+	using Digest = std::array<uint8_t, 20>;
+
+	Sha1();
+
+	void reset();
+
+	void update(std::string_view data);
+
+	/// Finishes the hash and resets the object
+	Digest digest();
+
+private:
+	uint32_t state[5];
+	uint64_t total;
+	uint8_t block[64];
+	uint32_t block_size;
+
+	void compress(const uint8_t *p);
+};
+
+};// namespace ParsePatch
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+
+#include <string_view>
+#include <vector>
+
+#include "../ParsePatch.hpp"
+
+namespace ParsePatch {
+
+/// Where a diff is in the parsed buffer
+struct PARSEPATCH_API DiffSpan {
+	/// `Diff::set_range`
+	uint64_t begin, end;
+	/// The number of the line starting at `begin`
+	uint64_t line;
+};
+
+/// What a reparse changed in `IncrementalParser::diffs`: the diffs `[first, first + removed)` of the previous parse are replaced by `inserted` diffs, passed to the consumer. The diffs after them are the same, moved by `byte_shift` bytes and `line_shift` lines.
+struct PARSEPATCH_API DiffsChange {
+	size_t first = 0, removed = 0, inserted = 0;
+	int64_t byte_shift = 0, line_shift = 0;
+};
+
+/// Parses a buffer edited in place again after every edit, reparsing only the diffs the edit touches.
+///
+/// The parser keeps the byte range and the first line of every diff of the last parse. After an edit, the diffs to reparse go from the one the edit starts in (the one before it too if the edit touches its first line, which the previous diff read ahead) to the first diff starting with a `diff -` line after the end of the edit: no header, hunk or binary line is ever read from a `diff -` line (`PatchReader::next_header_line`), so the diffs from there parse the same and are only moved. Just these lines are parsed, as `ChunkedPatchReader` parses a section, so the cost depends on the size of the touched diffs, and on the number of diffs only through moving the spans after them. Diffs started with `---` lines can be taken by the hunks before them, they are reparsed up to the next `diff -` line; and since a `---` line is a diff only without a `diff -` line after it, an edit adding one after such diffs reparses everything.
+struct PARSEPATCH_API IncrementalParser {
+	/// Its options (`utf8_check`, `recover`, `interner`) apply to every parse. Set `recover` for text being typed, which is often broken for a while: without it a failed parse makes the next edit reparse everything. `errors` are the ones of the last parsed section.
+	PatchReader reader {};
+	/// The diffs of the buffer, in order
+	std::vector<DiffSpan> diffs;
+
+	/// Parses the whole buffer into the consumer and closes it
+	ParsepatchError parse(std::string_view buf, Patch &patch);
+
+	/// Parses `buf` again after the bytes `[begin, begin + removed)` of the buffer of the last parse were replaced by `inserted` bytes. Only the diffs in `change` are passed to the consumer, which is closed at the end; their byte ranges and line numbers are the ones in `buf`. An edit not fitting the last buffer (or following a failed parse) reparses everything, as a change replacing all the diffs.
+	ParsepatchError reparse(std::string_view buf, uint64_t begin, uint64_t removed, uint64_t inserted, Patch &patch, DiffsChange &change);
+
+private:
+	/// The size of the buffer of the last parse, and if it succeeded
+	uint64_t size = 0;
+	bool valid = false;
+
+	ParsepatchError parse_section(std::string_view buf, uint64_t begin, uint64_t end, uint64_t line, bool diff_follows, Patch &patch, std::vector<DiffSpan> &spans);
+};
+
+};// namespace ParsePatch
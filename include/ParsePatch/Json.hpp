@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../ParsePatch.hpp"
+
+namespace ParsePatch {
+
+/// Appends `text` to `out` as the contents of a JSON string: `"`, `\` and control characters are escaped, bytes which are not valid UTF-8 become U+FFFD
+PARSEPATCH_API void append_json_escaped(std::string_view text, std::string &out);
+
+/// A `Patch` writing the diffs as the JSON of rust-parsepatch (the one of the test dataset), as they are parsed:
+///
+/// `{"diffs":[{"filename":"f","new":false,"deleted":false,"binary":false,"renamed_from":null,"copied_from":null,"file_mode":null,"hunks":[{"lines":[{"line":1,"deleted":true,"data":"text"}]}]}]}`
+///
+/// As in rust-parsepatch, only added and removed lines are written, and `file_mode` of a new or a deleted file is its mode. The text is appended to `out` with no intermediate tree, so a patch is converted in one pass, and `out` can be reused for many of them.
+struct PARSEPATCH_API JsonWriter: public Patch {
+	std::string &out;
+
+	JsonWriter(std::string &out);
+
+	virtual Diff *new_diff() override;
+
+	/// Finishes the document, the next diff starts a new one
+	virtual void close() override;
+
+private:
+	bool started = false, first_diff = true;
+
+	struct PARSEPATCH_API JsonDiff: public Diff {
+		JsonWriter *writer = nullptr;
+		bool hunk_open = false, first_hunk = true, first_line = true;
+
+		virtual void set_info(const std::string_view old_name, const std::string_view new_name, FileOp op, std::optional<std::vector<BinaryHunk>> binary_sizes, std::optional<FileMode> file_mode) override;
+
+		virtual void add_line(uint32_t old_line, uint32_t new_line, std::string_view &&line) override;
+
+		using Diff::new_hunk;
+
+		virtual void new_hunk() override;
+
+		virtual void close() override;
+
+		void end_hunk();
+	} diff;
+
+	void start();
+};
+
+/// Parses `buf` and appends its JSON to `out`. On an error the JSON is cut where the parse stopped.
+PARSEPATCH_API ParsepatchError patch_to_json(std::string_view buf, std::string &out);
+
+};// namespace ParsePatch
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "../ParsePatch.hpp"
+
+namespace ParsePatch {
+
+/// Translates line numbers of a file between its old and new versions.
+///
+/// Only the changed blocks (maximal runs of removed and added lines) are stored, sorted. Lines between blocks are unchanged and shifted by the sum of the size differences of the blocks before them, so a line is mapped with a binary search over the blocks. Line numbers start at 1; 0 means that the line has no counterpart (it is removed or added).
+struct PARSEPATCH_API LineMap {
+	struct Block {
+		/// `old_start` is the first removed line, or the old line the added lines are inserted before; `new_start` likewise
+		uint32_t old_start, old_count, new_start, new_count;
+	};
+
+	std::vector<Block> blocks;
+
+	uint32_t map_old_to_new(uint32_t old_line) const;
+
+	uint32_t map_new_to_old(uint32_t new_line) const;
+
+	/// Maps sorted lines in a single pass over the blocks, `out` must be as long as `old_lines`
+	void map_old_to_new(std::span<const uint32_t> old_lines, std::span<uint32_t> out) const;
+
+	void map_new_to_old(std::span<const uint32_t> new_lines, std::span<uint32_t> out) const;
+};
+
+/// A `Patch` building a `LineMap` per diff. Line text is not stored.
+struct PARSEPATCH_API LineMapPatch: public Patch {
+	struct File {
+		std::string_view old_name, new_name;
+		LineMap map;
+	};
+
+	std::vector<File> files;
+
+	virtual Diff *new_diff() override;
+
+	virtual void close() override;
+
+private:
+	struct PARSEPATCH_API MapBuilder: public Diff {
+		LineMapPatch *patch = nullptr;
+		/// Whether the last block of the current file can still grow
+		bool open = false;
+		/// `new - old` for the lines after the closed blocks
+		int64_t delta = 0;
+
+		virtual void set_info(const std::string_view old_name, const std::string_view new_name, FileOp op, std::optional<std::vector<BinaryHunk>> binary_sizes, std::optional<FileMode> file_mode) override;
+
+		virtual void add_line(uint32_t old_line, uint32_t new_line, std::string_view &&line) override;
+
+		using Diff::new_hunk;
+
+		virtual void new_hunk() override;
+
+		virtual void close() override;
+
+		LineMap::Block &open_block(uint32_t old_start, uint32_t new_start);
+		void close_block();
+	} builder;
+};
+
+};// namespace ParsePatch
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "../ParsePatch.hpp"
+
+namespace ParsePatch {
+
+/// A set of line numbers stored as sorted disjoint runs
+struct PARSEPATCH_API LineRangeSet {
+	/// [begin, end)
+	struct Range {
+		uint32_t begin, end;
+	};
+
+	std::vector<Range> ranges;
+
+	/// Adds a line. Amortized constant when lines come in ascending order, as from a diff; an earlier line is merged into the runs in linear time
+	void append(uint32_t line);
+
+	/// Number of lines in the set
+	uint64_t count() const;
+
+	bool contains(uint32_t line) const;
+
+	LineRangeSet intersect(const LineRangeSet &other) const;
+
+	/// Size of the intersection without building it
+	uint64_t count_intersection(const LineRangeSet &other) const;
+
+	/// Number of lines of a sorted array which are in the set
+	uint64_t count_intersection(std::span<const uint32_t> sorted_lines) const;
+};
+
+/// A `Patch` collecting per file the added lines (new line numbers) and the removed lines (old line numbers). Line text is not stored.
+struct PARSEPATCH_API ChangedLinesPatch: public Patch {
+	struct File {
+		std::string_view old_name, new_name;
+		LineRangeSet added, removed;
+	};
+
+	std::vector<File> files;
+
+	virtual Diff *new_diff() override;
+
+	virtual void close() override;
+
+private:
+	struct PARSEPATCH_API RangeCollector: public Diff {
+		ChangedLinesPatch *patch = nullptr;
+
+		virtual void set_info(const std::string_view old_name, const std::string_view new_name, FileOp op, std::optional<std::vector<BinaryHunk>> binary_sizes, std::optional<FileMode> file_mode) override;
+
+		virtual void add_line(uint32_t old_line, uint32_t new_line, std::string_view &&line) override;
+
+		using Diff::new_hunk;
+
+		virtual void new_hunk() override;
+
+		virtual void close() override;
+	} collector;
+};
+
+};// namespace ParsePatch
@@ -0,0 +1,34 @@
+#pragma once
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "../ParsePatch.hpp"
+
+namespace ParsePatch {
+
+/// A read-only file mapped into memory. Files which can't be mapped (pipes, `/dev/stdin`, ...), and all files where `mmap` is unavailable, are read into a buffer instead.
+struct PARSEPATCH_API MappedFile {
+	MappedFile() = default;
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+	MappedFile(MappedFile &&other) noexcept;
+	MappedFile &operator=(MappedFile &&other) noexcept;
+	~MappedFile();
+
+	/// Returns nothing if the file cannot be opened or mapped
+	static std::optional<MappedFile> open(const std::filesystem::path &path);
+
+	std::string_view view() const;
+
+private:
+	const char *data = nullptr;
+	size_t size = 0;
+	bool mapped = false;
+	std::string buffer;
+
+	void unmap();
+};
+
+};// namespace ParsePatch
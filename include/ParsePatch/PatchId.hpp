@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../ParsePatch.hpp"
+#include "Hash.hpp"
+
+namespace ParsePatch {
+
+/// Appends the bytes of `line` which are not whitespace (` `, `\t`, `\r`, `\n`, as git counts them)
+PARSEPATCH_API void strip_spaces(std::string_view line, std::string &out);
+
+/// A `Patch` computing the patch-id of `git patch-id`: a SHA-1 of the diff headers and the changed lines with whitespace removed, ignoring line numbers, so the same change has the same id wherever it is applied.
+///
+/// The stable id (`git patch-id --stable`) is the sum of the ids of the files, so it doesn't depend on their order; the unstable one hashes the whole patch at once. Besides, XXH64 of every diff (its header and lines) and of every hunk (its lines) is computed from the same normalized text, to find identical changes in many patches.
+struct PARSEPATCH_API PatchIdPatch: public Patch {
+	struct File {
+		std::string_view old_name, new_name;
+		uint64_t hash = 0;
+		std::vector<uint64_t> hunk_hashes;
+	};
+
+	bool stable = true;
+	std::vector<File> files;
+	/// The patch-id, set when the patch is closed
+	Sha1::Digest id {};
+
+	explicit PatchIdPatch(bool stable = true);
+
+	/// Prepares the object to a new patch
+	void reset();
+
+	/// The patch-id in hex, as git prints it
+	std::string hex() const;
+
+	virtual Diff *new_diff() override;
+
+	virtual void close() override;
+
+private:
+	struct PARSEPATCH_API IdCollector: public Diff {
+		PatchIdPatch *patch = nullptr;
+		bool binary = false, has_hunks = false;
+
+		virtual void set_info(const std::string_view old_name, const std::string_view new_name, FileOp op, std::optional<std::vector<BinaryHunk>> binary_sizes, std::optional<FileMode> file_mode) override;
+
+		virtual void set_header(std::string_view header) override;
+
+		virtual void add_line(uint32_t old_line, uint32_t new_line, std::string_view &&line) override;
+
+		using Diff::new_hunk;
+
+		virtual void new_hunk() override;
+
+		virtual void close() override;
+
+		void end_hunk();
+	} collector;
+
+	Sha1 sha;
+	Hasher64 diff_hasher, hunk_hasher;
+	std::string normalized;
+	/// From the last `index` line; git keeps them from diff to diff as well
+	std::string pre_oid, post_oid;
+	/// What git does at the next `diff` line, depending on the previous diff
+	bool flush_on_diff = false, skip_diff_line = false;
+
+	void hash(std::string_view normalized);
+	void flush();
+};
+
+};// namespace ParsePatch
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+#include "../ParsePatch.hpp"
+
+namespace ParsePatch {
+
+/// Gives the paths of files small dense integer ids, stable for the lifetime of the interner, so paths seen in many patches are hashed and compared once and aggregations can be keyed on integers.
+///
+/// All the methods are thread-safe, so a single interner can be shared by the readers of all the threads of `parse_many`. The table is split into shards by the hash of a path, every shard having its own lock (shared for the lookups of known paths, the usual case) and its own arena the paths are copied into, so the views returned by `path` don't depend on the parsed buffers. Ids are given in the order the paths are first seen and go from 1 up; the ids of a path differ between runs that are concurrent.
+struct PARSEPATCH_API PathInterner {
+	/// The id of no path: the empty name of a created or deleted file
+	static constexpr uint32_t no_path = 0;
+
+	PathInterner();
+	~PathInterner();
+
+	PathInterner(const PathInterner &) = delete;
+	PathInterner &operator=(const PathInterner &) = delete;
+
+	/// Returns the id of `path`, adding it if it is new
+	uint32_t intern(std::string_view path);
+
+	/// Returns the id of `path` if it is interned
+	std::optional<uint32_t> find(std::string_view path) const;
+
+	/// The path of an id returned by `intern`, the view is valid as long as the interner
+	std::string_view path(uint32_t id) const;
+
+	/// The number of ids given so far, including `no_path`
+	size_t size() const;
+
+private:
+	struct Shard;
+
+	static constexpr size_t shard_bits = 6;
+	static constexpr size_t segment_count = 32;
+
+	std::unique_ptr<Shard[]> shards;
+	/// The paths by id: segment `k` holds the ids from `2^k` to `2^(k+1) - 1`, so a segment never moves once allocated
+	std::atomic<std::string_view *> segments[segment_count] {};
+	std::atomic<uint32_t> next_id {1};
+
+	std::string_view &slot_of(uint32_t id) const;
+};
+
+};// namespace ParsePatch
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+
+#include <chrono>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "../ParsePatch.hpp"
+
+namespace ParsePatch {
+
+/// Provides the consumers of the inputs of `parse_many`
+struct PARSEPATCH_API PatchFactory {
+	virtual ~PatchFactory();
+
+	/// Returns the patch the input `index` is parsed into. Called on the thread of `worker`, concurrently with the other workers.
+	virtual Patch *patch_for(size_t index, size_t worker) = 0;
+
+	/// Called on the thread of `worker` when the input `index` is parsed (the patch is closed unless `err` is set), so the patch can be released or recycled
+	virtual void finished(size_t index, size_t worker, Patch *patch, ParsepatchError err);
+};
+
+struct PARSEPATCH_API ParseManyStats {
+	struct Worker {
+		uint64_t inputs = 0, bytes = 0, lines = 0, errors = 0;
+		/// Number of times the worker ran out of inputs and took some from another one
+		uint64_t steals = 0;
+		/// Time spent parsing, without waiting and stealing
+		std::chrono::nanoseconds busy {};
+
+		Worker &operator+=(const Worker &other);
+	};
+
+	std::vector<Worker> workers;
+	/// Sum of `workers`
+	Worker total;
+	/// Number of inputs not parsed, past the first `UINT32_MAX` ones
+	uint64_t skipped = 0;
+	std::chrono::nanoseconds wall {};
+};
+
+/// Parses many independent inputs on `threads` threads (0 means `std::thread::hardware_concurrency()`), the calling thread being one of them. The readers of all the workers share `interner`, if there is one (see `PatchReader::interner`).
+///
+/// Every worker owns a `PatchReader`, reused for all its inputs, and a contiguous range of input indices it consumes from the front. A worker whose range is exhausted steals the back half of the range of another worker, so the load is balanced without any shared queue. Both ends of a range are packed into a single atomic word, so taking and stealing are single compare-and-swaps. Indices are therefore 32-bit: only the first `UINT32_MAX` inputs are parsed, the others are counted in `ParseManyStats::skipped`.
+PARSEPATCH_API ParseManyStats parse_many(std::span<const std::string_view> inputs, PatchFactory &factory, size_t threads = 0, PathInterner *interner = nullptr);
+
+};// namespace ParsePatch
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "../ParsePatch.hpp"
+
+namespace ParsePatch {
+
+/// Turns the description of a change into the one of the change undoing it: `New` and `Deleted` are swapped, other operations are kept
+PARSEPATCH_API void reverse(FileOp &op);
+
+PARSEPATCH_API void reverse(FileMode &mode);
+
+/// Swaps the old and the new sides of the `@@` numbers
+PARSEPATCH_API void reverse(NumbersT &numbers);
+
+/// Swaps the line numbers, so an added line becomes a removed one and vice versa
+PARSEPATCH_API void reverse(HunkLine &line);
+
+/// Swaps the names, the modes and the binary hunks and reverses the operation. `raw` is cleared, since the header text describes the forward change.
+PARSEPATCH_API void reverse(DiffHeader &header);
+
+/// A `Patch` passing the parse of a patch to another `Patch` as if the patch was reversed (as by `git apply -R`).
+///
+/// Everything is swapped on the fly and nothing is allocated, so a reversed parse costs the same as a forward one. Lines come in the order of the forward patch, so in a hunk the added lines precede the removed ones they replace. The raw header (`Diff::set_header`) isn't passed, since it describes the forward change; byte ranges are passed as is.
+struct PARSEPATCH_API ReversePatch: public Patch {
+	Patch &target;
+
+	ReversePatch(Patch &target);
+
+	virtual Diff *new_diff() override;
+
+	virtual void close() override;
+
+private:
+	struct PARSEPATCH_API ReverseDiff: public Diff {
+		Diff *target = nullptr;
+
+		virtual void set_info(const std::string_view old_name, const std::string_view new_name, FileOp op, std::optional<std::vector<BinaryHunk>> binary_sizes, std::optional<FileMode> file_mode) override;
+
+		virtual void add_line(uint32_t old_line, uint32_t new_line, std::string_view &&line) override;
+
+		virtual void new_hunk() override;
+
+		virtual void new_hunk(const NumbersT &nums, std::string_view section) override;
+
+		virtual void no_newline() override;
+
+		virtual void size_hint(uint32_t hunks, uint64_t lines) override;
+
+		virtual void set_path_ids(uint32_t old_id, uint32_t new_id) override;
+
+		virtual void set_hunk_range(uint64_t begin, uint64_t end) override;
+
+		virtual void set_range(uint64_t begin, uint64_t end) override;
+
+		virtual void close() override;
+	} diff;
+};
+
+};// namespace ParsePatch
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "../ParsePatch.hpp"
+
+namespace ParsePatch {
+
+/// Finds any of a set of literal strings in text, in one pass whatever their number.
+///
+/// The patterns are compiled into an Aho–Corasick automaton whose transitions are a dense table over the classes of the bytes found in the patterns, so a byte costs one table load. A transition to a state where a pattern ends has its high bit set, so the outputs are only looked at on a match. Outside of a partial match the text is skipped to the next byte which starts a pattern: with SSE2 16 bytes at once if the patterns start with at most 3 distinct bytes, through a table otherwise.
+struct PARSEPATCH_API LiteralSearcher {
+	/// A match of pattern `pattern` at offset `begin` of the text
+	struct Hit {
+		uint32_t pattern;
+		uint32_t begin;
+	};
+
+	/// Empty patterns are ignored. The number of states (at most the total length of the patterns) times the number of distinct bytes in them must be below 2^31.
+	explicit LiteralSearcher(std::span<const std::string_view> patterns);
+
+	/// Appends all the matches in `text`, overlapping ones included, in the order of their ends
+	void find(std::string_view text, std::vector<Hit> &hits) const;
+
+	/// The length of pattern `pattern`
+	uint32_t pattern_size(uint32_t pattern) const;
+
+private:
+	static constexpr uint32_t match_bit = 1u << 31;
+
+	std::vector<uint32_t> sizes;
+	uint16_t classes[256] {};
+	uint32_t class_count = 1;
+	/// `state * class_count + class`: the next state, `match_bit` set if patterns end in it
+	std::vector<uint32_t> transitions;
+	/// The patterns ending in state `s` are `outputs[output_begin[s]..output_begin[s + 1]]`
+	std::vector<uint32_t> output_begin, outputs;
+	/// The bytes which leave the root
+	bool starts[256] {};
+	/// The distinct first bytes of the patterns, if there are at most `max_start_bytes` of them, for the vectorized skip
+	static constexpr uint32_t max_start_bytes = 3;
+	uint8_t start_bytes[max_start_bytes] {};
+	uint32_t start_count = 0;
+
+	size_t skip(const char *text, size_t pos, size_t size) const;
+};
+
+/// The lines a search looks at
+enum struct SearchSide : uint8_t {
+	Added,  /// `+` lines, numbered in the new file
+	Removed /// `-` lines, numbered in the old file
+};
+
+/// A match in a line of a hunk
+struct PARSEPATCH_API SearchMatch {
+	/// The new name of the file for `SearchSide::Added`, the old one for `SearchSide::Removed`, a view into the parsed buffer
+	std::string_view file;
+	uint32_t line;
+	/// 1-based byte offset of the match in the line, without the marker
+	uint32_t column;
+	uint32_t pattern;
+};
+
+/// Searches the patterns in the added (or removed) lines of the hunks of a patch only. The diffs are read with the steppers of `PatchReader`, so no `Diff` is created and no line goes through `Diff::add_line`; headers, context lines and lines of the other side are not searched.
+PARSEPATCH_API ParsepatchError search_patch(PatchReader &reader, std::string_view buf, const LiteralSearcher &searcher, SearchSide side, std::vector<SearchMatch> &matches);
+
+};// namespace ParsePatch
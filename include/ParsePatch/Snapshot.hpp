@@ -0,0 +1,96 @@
+#pragma once
+#include <cstdint>
+
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "../ParsePatch.hpp"
+#include "Columnar.hpp"
+
+namespace ParsePatch {
+
+/// A compact binary image of a parsed patch.
+///
+/// The image contains the tables of `ColumnarPatch` one column after another, every column aligned to 8 bytes, behind a fixed-size header. It doesn't contain the text: names and lines are offsets into the original patch, which must be supplied again when reading. The image uses the native byte order and is rejected on machines with another one.
+struct PARSEPATCH_API SnapshotHeader {
+	static constexpr char magic_value[8] = {'P', 'P', 'S', 'N', 'A', 'P', '\0', '\1'};
+	static constexpr uint32_t current_version = 3;
+	static constexpr uint32_t byte_order_mark = 0x01020304;
+
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint64_t source_size;
+	uint64_t diffs, hunks, lines, binary;/// counts of rows in the tables
+};
+
+/// Serializes the tables into an image, replacing the contents of `image`
+PARSEPATCH_API void write_snapshot(const ColumnarPatch &tables, std::string &image);
+
+/// A `Patch` collecting the tables and serializing them into `image` when the patch is closed
+struct PARSEPATCH_API SnapshotWriter: public ColumnarPatch {
+	std::string image;
+
+	virtual void close() override;
+};
+
+/// A zero-copy reader of an image, i.e. of a memory-mapped file. Columns are views into the image, so it must outlive the object.
+struct PARSEPATCH_API SnapshotView {
+	struct DiffTable {
+		std::span<const uint64_t> old_name_offset, new_name_offset;
+		std::span<const uint32_t> old_name_length, new_name_length;
+		std::span<const FileOpCode> op;
+		std::span<const uint32_t> op_mode;
+		std::span<const uint32_t> old_mode, new_mode;
+		std::span<const uint8_t> flags;
+		std::span<const uint32_t> first_hunk, hunk_count;
+		std::span<const uint32_t> first_binary, binary_count;
+
+		size_t size() const;
+	} diffs;
+
+	struct HunkTable {
+		std::span<const uint32_t> diff;
+		std::span<const uint64_t> first_line;
+		std::span<const uint32_t> line_count;
+		std::span<const uint32_t> old_count, old_lines, new_count, new_lines;
+		std::span<const uint64_t> section_offset;
+		std::span<const uint32_t> section_length;
+
+		size_t size() const;
+	} hunks;
+
+	struct LineTable {
+		std::span<const LineKind> kind;
+		std::span<const uint32_t> old_line, new_line;
+		std::span<const uint64_t> offset;
+		std::span<const uint32_t> length;
+		std::span<const uint8_t> flags;
+
+		size_t size() const;
+	} lines;
+
+	struct BinaryTable {
+		std::span<const uint32_t> diff;
+		std::span<const BinaryHunkType> type;
+		std::span<const uint64_t> hunk_size;
+
+		size_t size() const;
+	} binary;
+
+	/// Size of the patch the image was made from
+	uint64_t source_size = 0;
+
+	/// Checks the header and the size of the image, maps the columns and checks them with `validate`. Returns nothing if the image is malformed or was written for another byte order or version.
+	static std::optional<SnapshotView> open(std::string_view image);
+
+	/// Checks that every reference is within the tables or within `source_size` bytes, and that the enum columns (`FileOpCode`, `LineKind`, `BinaryHunkType`) hold values of their enums, so that a replay cannot stop halfway on a damaged image
+	bool validate() const;
+
+	/// Feeds the recorded parse to the consumer as if `source` was parsed again. `source` must be the patch the image was made from, it is the storage of names and lines. Returns false without calling the consumer if the size of `source` doesn't match; the rest was checked by `open`. The tables give the sizes of every diff ahead, so `Diff::size_hint` is called for the diffs with hunks; hunks are started with `Diff::new_hunk(nums, section)`.
+	bool replay(std::string_view source, Patch &patch) const;
+};
+
+};// namespace ParsePatch
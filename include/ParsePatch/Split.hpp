@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include "../ParsePatch.hpp"
+#include "Writer.hpp"
+
+namespace ParsePatch {
+
+/// Decides where the diffs of a split patch go
+struct PARSEPATCH_API Partitioner {
+	virtual ~Partitioner();
+
+	/// The index of the partition of a diff, nothing to drop the diff
+	virtual std::optional<size_t> partition_of(std::string_view old_name, std::string_view new_name) = 0;
+};
+
+/// Splits a patch into several ones, i.e. per directory or per owner.
+///
+/// Diffs are written as the exact slices of the input reported by `Diff::set_range`, so nothing is formatted: with `source` of the writers set to a mapped input, splitting is just `writev` of views into the mapping, and slices of consecutive diffs going into one partition are written as one piece.
+struct PARSEPATCH_API PatchSplitter {
+	PatchReader reader {};
+	/// Write the text before the first diff (i.e. the message of a `git format-patch` mail) into every partition before its first diff
+	bool keep_preamble = false;
+
+	/// Parses `buf` and writes every diff into `outputs[partition]`, diffs of partitions out of `outputs` are dropped. The outputs are closed.
+	ParsepatchError split(std::string_view buf, Partitioner &partitioner, std::span<PatchWriter *const> outputs);
+};
+
+};// namespace ParsePatch
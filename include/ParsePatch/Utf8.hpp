@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+
+#include <string_view>
+
+#include "../ParsePatch.hpp"
+
+namespace ParsePatch {
+
+/// Offset of the first byte of `buf` which is not a part of valid UTF-8 (a truncated sequence at the end is invalid), npos if all of it is valid
+PARSEPATCH_API size_t find_invalid_utf8(std::string_view buf);
+
+/// Position of the first `\n` of `buf` from `pos`, npos if there is none. The bytes before it (all the rest if there is none) are checked in the same pass: `invalid` is set to the position of the first one which is not valid UTF-8, npos if there is none.
+PARSEPATCH_API size_t find_eol_utf8(std::string_view buf, size_t pos, size_t &invalid);
+
+};// namespace ParsePatch
@@ -0,0 +1,126 @@
+#pragma once
+#include <cstdint>
+
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "../ParsePatch.hpp"
+#include "Events.hpp"
+
+namespace ParsePatch {
+
+/// A `Patch` writing the diffs back as git-style unified diff text.
+///
+/// The text is collected as a list of pieces and written with `writev` in batches. Views pointing into `source` are not copied: the `+`/`-`/` ` marker and the newline of a line are taken from the buffer when they are there, and pieces adjacent in the buffer are merged, so an unchanged run of lines is written from the buffer as one piece. Only markers which differ from the buffer (i.e. when reversing), generated headers and `@@` lines are formatted into a reused buffer. The raw header of a diff (`Diff::set_header`) is written as is, a header is generated only if there is no raw one.
+///
+/// The `@@` line is computed from the line numbers, since the lines may not be the ones of the `@@` line of the input (i.e. when filtered), so a hunk is held until it ends. The section heading of `Diff::new_hunk` is written after it, and `\ No newline at end of file` after a line reported by `Diff::no_newline`. The data of binary patches doesn't reach a `Diff`, so a binary diff is written as its slice of `source` (from `Diff::set_range`, starting with the raw header); without it (i.e. reversed, or from `write`) the writer fails with `std::errc::invalid_argument`.
+///
+/// The views must stay valid until they are written: at the latest on `close`, or at the end of every diff if `flush_every_diff` is set (needed with `ChunkedPatchReader`).
+struct PARSEPATCH_API PatchWriter: public Patch {
+	/// The buffer the parsed views point into
+	std::string_view source;
+	/// Write everything at the end of every diff instead of when `flush_size` bytes of text are formatted
+	bool flush_every_diff = false;
+	/// The first failure of writing, nothing is written after it
+	std::error_code error;
+
+	/// Writes into a file descriptor, which is not closed
+	PatchWriter(int fd, size_t flush_size = 1 << 16);
+
+	/// Writes into a stream, piece by piece
+	PatchWriter(std::ostream &out, size_t flush_size = 1 << 16);
+
+	/// Writes the text of the finished hunks
+	void flush();
+
+	/// Writes an event of `patch_events`. `close` still has to be called at the end.
+	void write(const PatchEvent &event);
+
+	/// Writes a piece of text as is, i.e. a slice of the input, between diffs
+	void write_slice(std::string_view slice);
+
+	virtual Diff *new_diff() override;
+
+	/// Writes everything left
+	virtual void close() override;
+
+private:
+	/// A view into memory outside the writer or, if `base` is null, into `text`
+	struct Piece {
+		const char *base;
+		size_t offset, size;
+	};
+
+	int fd = -1;
+	std::ostream *out = nullptr;
+	size_t flush_size;
+	std::string text;
+	std::vector<Piece> pieces;
+	/// `pieces` resolved into pointers for writing
+	std::vector<std::pair<const char *, size_t>> resolved;
+
+	struct PARSEPATCH_API DiffWriter: public Diff {
+		PatchWriter *writer = nullptr;
+		std::string_view old_name, new_name, raw;
+		/// The line end of the raw header, used for the generated lines
+		std::string_view eol = "\n";
+		FileOp op {FileOpCode::None};
+		std::optional<FileMode> file_mode;
+		bool binary = false, header_written = false, hunk_open = false;
+		/// The piece reserved for the `@@` line of the open hunk
+		size_t hunk_piece = 0;
+		NumbersT hunk {};
+		/// The section heading of the open hunk
+		std::string_view section;
+		/// `Diff::set_range`
+		std::optional<std::pair<uint64_t, uint64_t>> range;
+		/// new - old of the lines before the open hunk
+		int64_t delta = 0;
+
+		void start(std::string_view old_name, std::string_view new_name, FileOp op, bool binary, std::optional<FileMode> file_mode);
+
+		void write_header();
+
+		void end_hunk();
+
+		/// Writes a binary diff from `source`
+		void write_binary();
+
+		virtual void set_info(const std::string_view old_name, const std::string_view new_name, FileOp op, std::optional<std::vector<BinaryHunk>> binary_sizes, std::optional<FileMode> file_mode) override;
+
+		virtual void add_line(uint32_t old_line, uint32_t new_line, std::string_view &&line) override;
+
+		virtual void new_hunk() override;
+
+		virtual void new_hunk(const NumbersT &nums, std::string_view section) override;
+
+		virtual void no_newline() override;
+
+		virtual void set_header(std::string_view header) override;
+
+		virtual void set_range(uint64_t begin, uint64_t end) override;
+
+		virtual void close() override;
+	} diff;
+
+	void append(std::string_view view);
+
+	/// Appends formatted text
+	void format(std::string_view view);
+
+	void format(uint32_t number, int base = 10);
+
+	void format_name(std::string_view prefix, std::string_view name);
+
+	bool should_flush() const;
+
+	/// Writes the first `count` pieces
+	void write_pieces(size_t count);
+};
+
+};// namespace ParsePatch
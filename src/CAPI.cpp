@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include "ParsePatch.h"
+#include "ParsePatch.hpp"
+#include "ParsePatch/Columnar.hpp"
+
+using namespace ParsePatch;
+
+static_assert(sizeof(LineKind) == sizeof(uint8_t) && static_cast<uint8_t>(LineKind::Removed) == PARSEPATCH_LINE_REMOVED);
+static_assert(sizeof(FileOpCode) == sizeof(uint8_t) && static_cast<uint8_t>(FileOpCode::None) == PARSEPATCH_FILE_NONE);
+static_assert(sizeof(BinaryHunkType) == sizeof(uint8_t) && static_cast<uint8_t>(BinaryHunkType::Delta) == PARSEPATCH_BINARY_DELTA);
+static_assert(static_cast<uint8_t>(ParsepatchErrorCode::InvalidCompressedData) == PARSEPATCH_INVALID_COMPRESSED_DATA);
+static_assert(static_cast<uint8_t>(ParsepatchErrorCode::LineTooLong) == PARSEPATCH_LINE_TOO_LONG);
+static_assert(static_cast<uint8_t>(Utf8Check::All) == PARSEPATCH_UTF8_ALL);
+
+struct parsepatch_reader {
+	PatchReader reader {};
+	ColumnarPatch tables {};
+
+	struct {
+		size_t diffs = 0, hunks = 0, lines = 0, binary = 0;
+	} cursor;
+};
+
+namespace {
+
+/// Copies `count` rows of a column starting at `first`; a column the caller is not interested in is NULL
+template <typename DstT, typename SrcT>
+void copy_column(DstT *dst, const std::vector<SrcT> &src, size_t first, size_t count) {
+	static_assert(sizeof(DstT) == sizeof(SrcT));
+	if(dst) {
+		std::memcpy(dst, src.data() + first, count * sizeof(DstT));
+	}
+}
+
+/// Advances a table cursor by the capacity of the caller's buffers, returns the number of rows to copy
+size_t take_rows(size_t &cursor, size_t total, size_t capacity, size_t &first, size_t &count) {
+	first = cursor;
+	count = std::min(capacity, total - cursor);
+	cursor += count;
+	return count;
+}
+
+}// namespace
+
+extern "C" {
+
+parsepatch_reader *parsepatch_reader_new(void) {
+	return new(std::nothrow) parsepatch_reader {};
+}
+
+void parsepatch_reader_free(parsepatch_reader *reader) {
+	delete reader;
+}
+
+int parsepatch_set_utf8_check(parsepatch_reader *reader, int check) {
+	if(check < PARSEPATCH_UTF8_NONE || check > PARSEPATCH_UTF8_ALL) {
+		return 1;
+	}
+	reader->reader.utf8_check = static_cast<Utf8Check>(check);
+	return 0;
+}
+
+parsepatch_error parsepatch_parse(parsepatch_reader *reader, const char *buf, size_t len) {
+	std::string_view view(buf, len);
+	reader->tables.reset(view);
+	reader->cursor = {};
+	auto err = reader->reader.by_buf(view, reader->tables);
+	return {static_cast<uint8_t>(err.code), err.line_or_str};
+}
+
+parsepatch_totals parsepatch_get_totals(const parsepatch_reader *reader) {
+	auto &t = reader->tables;
+	return {t.diffs.size(), t.hunks.size(), t.lines.size(), t.binary.size()};
+}
+
+int parsepatch_next_batch(parsepatch_reader *reader, parsepatch_batch *batch) {
+	auto &t = reader->tables;
+	auto &c = reader->cursor;
+
+	{
+		auto &d = batch->diffs;
+		auto &s = t.diffs;
+		if(take_rows(c.diffs, s.size(), d.capacity, d.first, d.count)) {
+			copy_column(d.old_name_offset, s.old_name_offset, d.first, d.count);
+			copy_column(d.old_name_length, s.old_name_length, d.first, d.count);
+			copy_column(d.new_name_offset, s.new_name_offset, d.first, d.count);
+			copy_column(d.new_name_length, s.new_name_length, d.first, d.count);
+			copy_column(d.op, s.op, d.first, d.count);
+			copy_column(d.op_mode, s.op_mode, d.first, d.count);
+			copy_column(d.old_mode, s.old_mode, d.first, d.count);
+			copy_column(d.new_mode, s.new_mode, d.first, d.count);
+			copy_column(d.flags, s.flags, d.first, d.count);
+			copy_column(d.first_hunk, s.first_hunk, d.first, d.count);
+			copy_column(d.hunk_count, s.hunk_count, d.first, d.count);
+			copy_column(d.first_binary, s.first_binary, d.first, d.count);
+			copy_column(d.binary_count, s.binary_count, d.first, d.count);
+		}
+	}
+	{
+		auto &h = batch->hunks;
+		auto &s = t.hunks;
+		if(take_rows(c.hunks, s.size(), h.capacity, h.first, h.count)) {
+			copy_column(h.diff, s.diff, h.first, h.count);
+			copy_column(h.first_line, s.first_line, h.first, h.count);
+			copy_column(h.line_count, s.line_count, h.first, h.count);
+			copy_column(h.old_count, s.old_count, h.first, h.count);
+			copy_column(h.old_lines, s.old_lines, h.first, h.count);
+			copy_column(h.new_count, s.new_count, h.first, h.count);
+			copy_column(h.new_lines, s.new_lines, h.first, h.count);
+			copy_column(h.section_offset, s.section_offset, h.first, h.count);
+			copy_column(h.section_length, s.section_length, h.first, h.count);
+		}
+	}
+	{
+		auto &l = batch->lines;
+		auto &s = t.lines;
+		if(take_rows(c.lines, s.size(), l.capacity, l.first, l.count)) {
+			copy_column(l.kind, s.kind, l.first, l.count);
+			copy_column(l.old_line, s.old_line, l.first, l.count);
+			copy_column(l.new_line, s.new_line, l.first, l.count);
+			copy_column(l.offset, s.offset, l.first, l.count);
+			copy_column(l.length, s.length, l.first, l.count);
+		}
+	}
+	{
+		auto &b = batch->binary;
+		auto &s = t.binary;
+		if(take_rows(c.binary, s.size(), b.capacity, b.first, b.count)) {
+			copy_column(b.diff, s.diff, b.first, b.count);
+			copy_column(b.type, s.type, b.first, b.count);
+			copy_column(b.size, s.hunk_size, b.first, b.count);
+		}
+	}
+
+	return (batch->diffs.capacity && c.diffs < t.diffs.size()) || (batch->hunks.capacity && c.hunks < t.hunks.size()) || (batch->lines.capacity && c.lines < t.lines.size()) || (batch->binary.capacity && c.binary < t.binary.size());
+}
+
+void parsepatch_rewind(parsepatch_reader *reader) {
+	reader->cursor = {};
+}
+}
@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <vector>
+
+#include "ParsePatch/Cache.hpp"
+#include "ParsePatch/EventLog.hpp"
+#include "ParsePatch/Hash.hpp"
+#include "ParsePatch/MappedFile.hpp"
+
+namespace ParsePatch {
+
+namespace {
+
+const std::string_view entry_extension = ".pplog";
+
+/// Feeds the events of a parse to two consumers
+struct TeePatch: public Patch {
+	struct TeeDiff: public Diff {
+		Diff *first = nullptr, *second = nullptr;
+
+		virtual void set_info(const std::string_view old_name, const std::string_view new_name, FileOp op, std::optional<std::vector<BinaryHunk>> binary_sizes, std::optional<FileMode> file_mode) override {
+			first->set_info(old_name, new_name, op, binary_sizes, file_mode);
+			second->set_info(old_name, new_name, op, std::move(binary_sizes), file_mode);
+		}
+
+		virtual void add_line(uint32_t old_line, uint32_t new_line, std::string_view &&line) override {
+			first->add_line(old_line, new_line, std::string_view(line));
+			second->add_line(old_line, new_line, std::move(line));
+		}
+
+		virtual void new_hunk() override {
+			first->new_hunk();
+			second->new_hunk();
+		}
+
+		virtual void new_hunk(const NumbersT &nums, std::string_view section) override {
+			first->new_hunk(nums, section);
+			second->new_hunk(nums, section);
+		}
+
+		virtual void no_newline() override {
+			first->no_newline();
+			second->no_newline();
+		}
+
+		virtual void size_hint(uint32_t hunks, uint64_t lines) override {
+			first->size_hint(hunks, lines);
+			second->size_hint(hunks, lines);
+		}
+
+		virtual void set_header(std::string_view header) override {
+			first->set_header(header);
+			second->set_header(header);
+		}
+
+		virtual void set_path_ids(uint32_t old_id, uint32_t new_id) override {
+			first->set_path_ids(old_id, new_id);
+			second->set_path_ids(old_id, new_id);
+		}
+
+		virtual void set_hunk_range(uint64_t begin, uint64_t end) override {
+			first->set_hunk_range(begin, end);
+			second->set_hunk_range(begin, end);
+		}
+
+		virtual void set_range(uint64_t begin, uint64_t end) override {
+			first->set_range(begin, end);
+			second->set_range(begin, end);
+		}
+
+		virtual void close() override {
+			first->close();
+			second->close();
+		}
+	};
+
+	Patch &first, &second;
+	TeeDiff diff;
+
+	TeePatch(Patch &first, Patch &second): first(first), second(second) {
+	}
+
+	virtual Diff *new_diff() override {
+		diff.first = first.new_diff();
+		diff.second = second.new_diff();
+		return &diff;
+	}
+
+	virtual void close() override {
+		first.close();
+		second.close();
+	}
+};
+
+}// namespace
+
+ParseCache::ParseCache(std::filesystem::path directory, uint64_t max_size): directory(std::move(directory)), max_size(max_size) {
+	std::error_code ec;
+	std::filesystem::create_directories(this->directory, ec);
+	evict();
+}
+
+std::filesystem::path ParseCache::entry_path(std::string_view buf) const {
+	char name[64];
+	// a buffer parsed without checking UTF-8 may fail with the check
+	std::snprintf(name, sizeof(name), "%016llx-%llx-%u", static_cast<unsigned long long>(hash64(buf)), static_cast<unsigned long long>(buf.size()), static_cast<unsigned>(reader.utf8_check));
+	return directory / (std::string(name) + std::string(entry_extension));
+}
+
+ParsepatchError ParseCache::by_buf(std::string_view buf, Patch &patch) {
+	if(reader.recover || reader.interner) {
+		// the recovered errors and the path ids are not in the log
+		++stats.bypassed;
+		return reader.by_buf(buf, patch);
+	}
+	auto path = entry_path(buf);
+	std::error_code ec;
+
+	if(auto file = MappedFile::open(path)) {
+		// the whole log is checked first, a replay stopping halfway would have fed the consumer part of the events before the parse
+		auto log = file->view();
+		if(check_event_log(log, buf) && replay_event_log(log, buf, patch)) {
+			++stats.hits;
+			std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+			return {ParsepatchErrorCode::OK, 0};
+		}
+		// a foreign or a damaged file, it will be replaced
+		std::filesystem::remove(path, ec);
+	}
+	++stats.misses;
+
+	writer.reset(buf);
+	TeePatch tee(writer, patch);
+	auto err = reader.by_buf(buf, tee);
+	if(err) {
+		// partial results are not cached, the error must be reported every time
+		return err;
+	}
+
+	// unique within the host: processes and threads have their own random nonces
+	static thread_local std::mt19937_64 nonce_gen {std::random_device {}()};
+	auto tmp = path;
+	tmp += ".tmp" + std::to_string(nonce_gen());
+	{
+		std::ofstream s(tmp, std::ios::binary | std::ios::trunc);
+		s.write(writer.log.data(), static_cast<std::streamsize>(writer.log.size()));
+		s.close();
+		if(!s) {
+			std::filesystem::remove(tmp, ec);
+			return err;
+		}
+	}
+	std::filesystem::rename(tmp, path, ec);
+	if(ec) {
+		std::filesystem::remove(tmp, ec);
+		return err;
+	}
+	++stats.stores;
+
+	estimated_size += writer.log.size();
+	if(estimated_size > max_size) {
+		evict();
+	}
+	return err;
+}
+
+void ParseCache::evict() {
+	struct Entry {
+		std::filesystem::path path;
+		std::filesystem::file_time_type time;
+		uint64_t size;
+	};
+	std::vector<Entry> entries;
+	uint64_t total = 0;
+
+	std::error_code ec;
+	for(auto it = std::filesystem::directory_iterator(directory, ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+		auto &path = it->path();
+		if(path.extension() != entry_extension) {
+			continue;
+		}
+		std::error_code entry_ec;
+		auto size = it->file_size(entry_ec);
+		auto time = it->last_write_time(entry_ec);
+		if(entry_ec) {
+			// removed by another process meanwhile
+			continue;
+		}
+		total += size;
+		entries.emplace_back(Entry {path, time, size});
+	}
+	estimated_size = total;
+	if(total <= max_size) {
+		return;
+	}
+
+	std::sort(begin(entries), end(entries), [](const Entry &a, const Entry &b) {
+		return a.time < b.time;
+	});
+	for(auto &e: entries) {
+		if(total <= max_size) {
+			break;
+		}
+		// another process may be evicting the same entry, then it is already gone, which is fine
+		if(std::filesystem::remove(e.path, ec)) {
+			++stats.evictions;
+		}
+		total -= e.size;
+	}
+	estimated_size = total;
+}
+
+};// namespace ParsePatch
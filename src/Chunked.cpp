@@ -0,0 +1,332 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "ParsePatch/Chunked.hpp"
+#include "ParsePatch/Compression.hpp"
+
+namespace ParsePatch {
+
+ChunkSource::~ChunkSource() = default;
+
+ParsepatchError ChunkedPatchReader::parse_pending(size_t size, bool diff_follows, Patch &patch) {
+	// reader.line and reader.offset are kept running, so line numbers and byte ranges are the ones in the whole input
+	reader.buf = std::string_view(pending.data(), size);
+	reader.pos = 0;
+	reader.last = {};
+	reader.diff_ahead = {};
+	reader.utf8_checked = 0;
+	reader.utf8_line = reader.line;
+	reader.diff_follows = diff_follows;
+	return reader.parse_diffs(patch);
+}
+
+ParsepatchError ChunkedPatchReader::parse(ChunkSource &source, Patch &patch) {
+	const std::string_view boundary = "\ndiff -";
+
+	reader.reset();
+	pending.clear();
+	// no boundary starts before this position of `pending`
+	size_t scanned = 0;
+
+	while(true) {
+		auto chunk_some = source.next_chunk();
+		if(!chunk_some) {
+			return chunk_some.error();
+		}
+		auto chunk = *chunk_some;
+		if(chunk.empty()) {
+			break;
+		}
+		pending.append(chunk);
+
+		auto found = std::string_view(pending).substr(scanned).rfind(boundary);
+		if(found != std::string_view::npos) {
+			// +1 for the '\n', it belongs to the last line of the section
+			auto cut = scanned + found + 1;
+			auto err = parse_pending(cut, true, patch);
+			if(err) {
+				return err;
+			}
+			pending.erase(0, cut);
+			// byte ranges are counted from the start of the input
+			reader.offset += cut;
+		}
+		scanned = pending.size() >= boundary.size() ? pending.size() - (boundary.size() - 1) : 0;
+	}
+
+	auto err = parse_pending(pending.size(), false, patch);
+	if(err) {
+		return err;
+	}
+	patch.close();
+	return {ParsepatchErrorCode::OK, 0};
+}
+
+ParsepatchError ChunkedPatchReader::by_compressed_buf(std::string_view buf, Patch &patch) {
+	auto format = detect_compression(buf);
+	if(format == Compression::None) {
+		return reader.by_buf(buf, patch);
+	}
+	if(!compression_supported(format)) {
+		return {ParsepatchErrorCode::InvalidCompressedData, 0};
+	}
+	DecompressingSource source(buf, format);
+	return parse(source, patch);
+}
+
+WindowedPatchReader::WindowedPatchReader(size_t window_size): window(std::make_unique<char[]>(std::max<size_t>(window_size, 2))), capacity(std::max<size_t>(window_size, 2)) {
+}
+
+ParsepatchError WindowedPatchReader::fill() {
+	while(filled < capacity && !eof) {
+		if(pending.empty()) {
+			auto chunk_some = source->next_chunk();
+			if(!chunk_some) {
+				return chunk_some.error();
+			}
+			if(chunk_some->empty()) {
+				eof = true;
+				break;
+			}
+			pending = *chunk_some;
+		}
+		auto n = std::min(pending.size(), capacity - filled);
+		std::memcpy(window.get() + filled, pending.data(), n);
+		pending.remove_prefix(n);
+		filled += n;
+	}
+	reader.buf = std::string_view(window.get(), filled);
+	// the new input may have a `diff -` line the lookahead hasn't seen
+	reader.diff_ahead = {};
+	return {ParsepatchErrorCode::OK, 0};
+}
+
+void WindowedPatchReader::compact(size_t from, std::optional<LineReader> *held) {
+	auto rebase = [&](std::optional<LineReader> &line) {
+		if(line) {
+			line->buf = std::string_view(line->buf.data() - from, line->buf.size());
+		}
+	};
+	if(reader.utf8_check == Utf8Check::All) {
+		reader.check_utf8(from);
+		reader.utf8_checked -= from;
+	}
+	std::memmove(window.get(), window.get() + from, filled - from);
+	filled -= from;
+	reader.pos -= from;
+	rebase(reader.last);
+	if(held) {
+		rebase(*held);
+	}
+	// byte ranges are counted from the start of the input
+	reader.offset += from;
+	reader.buf = std::string_view(window.get(), filled);
+	reader.diff_ahead = {};
+}
+
+ParsepatchError WindowedPatchReader::ensure_line(std::optional<LineReader> *held) {
+	while(true) {
+		auto from = reader.consumed();
+		if(eof || reader.buf.find('\n', from) != std::string_view::npos) {
+			return {ParsepatchErrorCode::OK, 0};
+		}
+		if(held && *held) {
+			from = std::min<size_t>(from, (*held)->buf.data() - window.get());
+		}
+		if(!from && filled == capacity) {
+			return {ParsepatchErrorCode::LineTooLong, reader.line};
+		}
+		compact(from, held);
+		auto err = fill();
+		if(err) {
+			return err;
+		}
+	}
+}
+
+ParsepatchError WindowedPatchReader::skip_binary(std::vector<BinaryHunk> &sizes) {
+	auto hunk_start = [](LineReader &line) {
+		return line.buf.starts_with("literal ") || line.buf.starts_with("delta ");
+	};
+	// as `PatchReader::skip_binary`: every hunk is its size line and the lines up to an empty one
+	sizes.clear();
+	while(true) {
+		if(auto err = ensure_line(nullptr)) {
+			return err;
+		}
+		auto line_some = reader.next(hunk_start, true);
+		if(!line_some) {
+			return {ParsepatchErrorCode::OK, 0};
+		}
+		auto literal = line_some->buf.starts_with("literal ");
+		sizes.emplace_back(BinaryHunk {literal ? BinaryHunkType::Literal : BinaryHunkType::Delta, ScannerUtils::parse_usize(line_some->buf.substr(literal ? 8 : 6))});
+		while(true) {
+			if(auto err = ensure_line(nullptr)) {
+				return err;
+			}
+			auto data_some = reader.next(ScannerUtils::mv, false);
+			// a `\r` makes the line not empty
+			if(!data_some || (data_some->buf.empty() && *data_some->buf.data() == '\n')) {
+				break;
+			}
+		}
+	}
+}
+
+ParsepatchError WindowedPatchReader::parse_diff(LineReader &diff_line, Patch &patch) {
+	auto local = [&](const LineReader &line) {
+		return static_cast<size_t>(line.buf.data() - window.get());
+	};
+
+	// the lookahead of a `---` line sees at least half of the window
+	if(!eof && filled - local(diff_line) < capacity / 2) {
+		std::optional<LineReader> held {diff_line};
+		compact(local(diff_line), &held);
+		diff_line = *held;
+		if(auto err = fill()) {
+			return err;
+		}
+	}
+
+	// the header is read from the window as it is: if the reader ran into the end of the window, it is read again from the start of a refilled one
+	std::optional<DiffHeader> header;
+	ParsepatchError err;
+	// the names and the header of a binary diff whose body is read through the window
+	std::string old_name, new_name, raw;
+	while(true) {
+		auto pos = reader.pos;
+		auto line = reader.line;
+		auto last = reader.last;
+		header = {};
+		err = reader.parse_diff_header(diff_line, header);
+		// a header ends before a whole line: the first `@@` line, or the one read ahead
+		if(eof || (!err && header && header->hunks) || reader.buf.find('\n', reader.consumed()) != std::string_view::npos) {
+			break;
+		}
+		if(!err && header && header->binary_sizes) {
+			// the `GIT binary patch` line is whole, the hunks after it are read again line by line
+			old_name = header->old_name;
+			new_name = header->new_name;
+			raw = header->raw;
+			header->old_name = old_name;
+			header->new_name = new_name;
+			header->raw = raw;
+			auto body = reader.buf.find('\n', local(diff_line) + raw.size()) + 1;
+			reader.line = diff_line.line + std::count(begin(raw), end(raw), '\n') + 1;
+			reader.pos = body;
+			reader.last = {};
+			if((err = skip_binary(*header->binary_sizes))) {
+				return err;
+			}
+			break;
+		}
+		if(!local(diff_line) && filled == capacity) {
+			return {ParsepatchErrorCode::LineTooLong, diff_line.line};
+		}
+		reader.pos = pos;
+		reader.line = line;
+		reader.last = last;
+		std::optional<LineReader> held {diff_line};
+		compact(local(diff_line), &held);
+		diff_line = *held;
+		if((err = fill())) {
+			return err;
+		}
+	}
+	if(err || !header) {
+		return err;
+	}
+	auto begin = reader.offset + local(diff_line);
+	auto diff = patch.new_diff();
+	diff->set_info(header->old_name, header->new_name, header->op, std::move(header->binary_sizes), header->file_mode);
+	diff->set_header(header->raw);
+	if(reader.interner) {
+		diff->set_path_ids(header->old_id, header->new_id);
+	}
+	auto end = reader.offset + reader.consumed();
+
+	// the views of the header are not used after this point, the window may move
+	if(auto first = header->hunks) {
+		while(true) {
+			if((err = ensure_line(&first))) {
+				return err;
+			}
+			auto hunk_begin = reader.offset + (first ? local(*first) : reader.consumed());
+			auto nums_some = reader.next_hunk(first);
+			if(!nums_some) {
+				return nums_some.error();
+			}
+			if(!*nums_some) {
+				break;
+			}
+			auto lines_count = **nums_some;
+			diff->new_hunk(lines_count, reader.hunk_section);
+			while(true) {
+				if((err = ensure_line(nullptr))) {
+					return err;
+				}
+				auto line_some = reader.next_hunk_line(lines_count);
+				if(!line_some) {
+					break;
+				}
+				diff->add_line(line_some->old_line, line_some->new_line, std::move(line_some->line));
+				// the marker is read as a line, which must be whole
+				if((err = ensure_line(nullptr))) {
+					return err;
+				}
+				if(reader.next_no_newline()) {
+					diff->no_newline();
+				}
+			}
+			// hunk_end() looks at the line after the hunk
+			if((err = ensure_line(nullptr))) {
+				return err;
+			}
+			diff->set_hunk_range(hunk_begin, reader.offset + reader.hunk_end());
+		}
+		end = reader.offset + reader.hunk_end();
+	}
+	diff->set_range(begin, end);
+	diff->close();
+	return reader.utf8_error;
+}
+
+ParsepatchError WindowedPatchReader::parse(ChunkSource &source, Patch &patch) {
+	this->source = &source;
+	reader.reset();
+	filled = 0;
+	pending = {};
+	eof = false;
+	auto err = fill();
+
+	while(!err) {
+		if((err = ensure_line(nullptr))) {
+			break;
+		}
+		auto line_some = reader.next(ScannerUtils::starter, false);
+		if(line_some) {
+			err = parse_diff(*line_some, patch);
+			continue;
+		}
+		if(eof) {
+			if(reader.utf8_check == Utf8Check::All) {
+				reader.check_utf8(reader.buf.size());
+				if((err = reader.utf8_error)) {
+					break;
+				}
+			}
+			patch.close();
+			break;
+		}
+		// no diff starts in the window: its whole lines are skipped to make room
+		auto from = reader.consumed();
+		auto end = reader.buf.rfind('\n') + 1;
+		reader.line += std::count(begin(reader.buf) + from, begin(reader.buf) + end, '\n');
+		reader.pos = end;
+		reader.last = {};
+	}
+	return err;
+}
+
+};// namespace ParsePatch
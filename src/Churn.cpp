@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <thread>
+
+#include "ParsePatch/Churn.hpp"
+
+namespace ParsePatch {
+
+ChurnStats &ChurnStats::operator+=(const ChurnStats &other) {
+	added += other.added;
+	removed += other.removed;
+	commits += other.commits;
+	return *this;
+}
+
+namespace {
+
+/// A file changed by a commit
+struct FileRecord {
+	uint32_t old_id = 0, new_id = 0;
+	uint32_t added = 0, removed = 0;
+	FileOpCode op = FileOpCode::None;
+	/// The id of the last name of the file, set when the renames are resolved
+	uint32_t last = 0;
+};
+
+/// The records of a commit in the storage of the worker which parsed it
+struct CommitRecords {
+	uint32_t worker = 0;
+	bool failed = false;
+	size_t begin = 0, count = 0;
+};
+
+/// Appends a record per diff to the storage of a worker
+struct RecordingPatch: public Patch {
+	struct RecordingDiff: public Diff {
+		std::vector<FileRecord> *records = nullptr;
+		FileRecord record;
+
+		virtual void set_info(const std::string_view, const std::string_view, FileOp op, std::optional<std::vector<BinaryHunk>>, std::optional<FileMode>) override {
+			record = {};
+			record.op = op.code;
+		}
+
+		virtual void set_path_ids(uint32_t old_id, uint32_t new_id) override {
+			record.old_id = old_id;
+			record.new_id = new_id;
+		}
+
+		virtual void add_line(uint32_t old_line, uint32_t new_line, std::string_view &&) override {
+			record.added += !old_line;
+			record.removed += !new_line;
+		}
+
+		using Diff::new_hunk;
+
+		virtual void new_hunk() override {
+		}
+
+		virtual void close() override {
+			records->emplace_back(record);
+		}
+	} diff;
+
+	virtual Diff *new_diff() override {
+		return &diff;
+	}
+
+	virtual void close() override {
+	}
+};
+
+struct RecordingFactory: public PatchFactory {
+	std::vector<RecordingPatch> patches;
+	std::vector<std::vector<FileRecord>> records;
+	std::vector<CommitRecords> commits;
+
+	RecordingFactory(size_t workers, size_t commits): patches(workers), records(workers), commits(commits) {
+		for(size_t i = 0; i < workers; ++i) {
+			patches[i].diff.records = &records[i];
+		}
+	}
+
+	virtual Patch *patch_for(size_t index, size_t worker) override {
+		commits[index] = {static_cast<uint32_t>(worker), false, records[worker].size(), 0};
+		return &patches[worker];
+	}
+
+	virtual void finished(size_t index, size_t worker, Patch *, ParsepatchError err) override {
+		auto &commit = commits[index];
+		if(err) {
+			// the diffs before the error are dropped with the commit
+			records[worker].resize(commit.begin);
+			commit.failed = true;
+		} else {
+			commit.count = records[worker].size() - commit.begin;
+		}
+	}
+
+	std::span<FileRecord> of(size_t index) {
+		auto &commit = commits[index];
+		return std::span(records[commit.worker]).subspan(commit.begin, commit.count);
+	}
+};
+
+/// The churn accumulated by a thread, indexed by path id
+struct Accumulator {
+	struct Entry {
+		ChurnStats stats;
+		/// 1 + the last commit counted
+		size_t stamp = 0;
+
+		void add(const FileRecord &record, size_t commit) {
+			stats.added += record.added;
+			stats.removed += record.removed;
+			// a commit is counted once, whatever the number of its diffs under a directory
+			if(stamp != commit + 1) {
+				stamp = commit + 1;
+				++stats.commits;
+			}
+		}
+	};
+
+	std::vector<Entry> files, directories;
+};
+
+constexpr uint32_t unknown_parent = UINT32_MAX;
+
+}// namespace
+
+ChurnReport compute_churn(std::span<const std::string_view> commits, PathInterner &paths, size_t threads) {
+	ChurnReport report;
+	if(!threads) {
+		threads = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	// the same as parse_many, so there is storage for each of its workers
+	threads = std::clamp<size_t>(threads, 1, std::max<size_t>(commits.size(), 1));
+	commits = commits.first(std::min<size_t>(commits.size(), UINT32_MAX));
+
+	RecordingFactory factory(threads, commits.size());
+	report.parse = parse_many(commits, factory, threads, &paths);
+
+	// the renames are resolved from the newest commit: `alias` maps a name to the last name of the file it names at that point
+	std::vector<uint32_t> alias(paths.size());
+	auto resolve = [&](uint32_t id) {
+		return alias[id] ? alias[id] : id;
+	};
+	for(size_t c = commits.size(); c--;) {
+		auto records = factory.of(c);
+		for(auto &r: records) {
+			auto name = r.op == FileOpCode::Deleted || !r.new_id ? r.old_id : r.new_id;
+			r.last = resolve(name);
+		}
+		// the names the commit creates didn't name the file before it, the names of a swap are reset before they are set
+		for(auto &r: records) {
+			if(r.op == FileOpCode::New || r.op == FileOpCode::Renamed || r.op == FileOpCode::Copied) {
+				alias[r.new_id] = 0;
+			}
+		}
+		for(auto &r: records) {
+			if(r.op == FileOpCode::Renamed && r.old_id != r.last) {
+				alias[r.old_id] = r.last;
+			}
+		}
+	}
+
+	for(size_t c = 0; c < commits.size(); ++c) {
+		if(factory.commits[c].failed) {
+			report.failed.emplace_back(c);
+			continue;
+		}
+		for(auto &r: factory.of(c)) {
+			if(r.op == FileOpCode::Renamed || r.op == FileOpCode::Copied) {
+				report.renames.emplace_back(ChurnReport::Rename {c, r.old_id, r.new_id, r.op == FileOpCode::Copied});
+			}
+		}
+	}
+
+	// the directories of the last names, interned along the way
+	std::vector<uint32_t> parent(paths.size(), unknown_parent);
+	auto parent_of = [&](uint32_t id) {
+		if(id >= parent.size()) {
+			parent.resize(id + 1, unknown_parent);
+		}
+		if(parent[id] == unknown_parent) {
+			auto path = paths.path(id);
+			auto slash = path.rfind('/');
+			parent[id] = slash == std::string_view::npos ? PathInterner::no_path : paths.intern(path.substr(0, slash));
+		}
+		return parent[id];
+	};
+	for(auto &records: factory.records) {
+		for(auto &r: records) {
+			for(auto d = parent_of(r.last); d != PathInterner::no_path; d = parent_of(d)) {
+			}
+		}
+	}
+	auto ids = paths.size();
+	parent.resize(ids, unknown_parent);
+
+	// the commits are split evenly between the threads, each accumulating into its own arrays
+	std::vector<Accumulator> accumulators(threads);
+	auto accumulate = [&](size_t t) {
+		auto &acc = accumulators[t];
+		acc.files.resize(ids);
+		acc.directories.resize(ids);
+		for(auto c = commits.size() * t / threads, end = commits.size() * (t + 1) / threads; c < end; ++c) {
+			for(auto &r: factory.of(c)) {
+				acc.files[r.last].add(r, c);
+				for(auto d = parent[r.last]; d != PathInterner::no_path; d = parent[d]) {
+					acc.directories[d].add(r, c);
+				}
+			}
+		}
+	};
+	report.files.resize(ids);
+	report.directories.resize(ids);
+	// the arrays are summed by ranges of ids, in parallel as well
+	auto merge = [&](size_t t) {
+		for(auto id = ids * t / threads, end = ids * (t + 1) / threads; id < end; ++id) {
+			for(auto &acc: accumulators) {
+				report.files[id] += acc.files[id].stats;
+				report.directories[id] += acc.directories[id].stats;
+			}
+		}
+	};
+	auto in_parallel = [&](auto &step) {
+		std::vector<std::jthread> workers;
+		workers.reserve(threads - 1);
+		for(size_t t = 1; t < threads; ++t) {
+			workers.emplace_back([&step, t] {
+				step(t);
+			});
+		}
+		step(0);
+	};
+	in_parallel(accumulate);
+	in_parallel(merge);
+	return report;
+}
+
+};// namespace ParsePatch
@@ -0,0 +1,173 @@
+#include "ParsePatch/Columnar.hpp"
+
+namespace ParsePatch {
+
+size_t ColumnarPatch::DiffTable::size() const {
+	return op.size();
+}
+
+size_t ColumnarPatch::HunkTable::size() const {
+	return diff.size();
+}
+
+size_t ColumnarPatch::LineTable::size() const {
+	return kind.size();
+}
+
+size_t ColumnarPatch::BinaryTable::size() const {
+	return diff.size();
+}
+
+void ColumnarPatch::reset(std::string_view source) {
+	this->source = source;
+
+	diffs.old_name_offset.clear();
+	diffs.new_name_offset.clear();
+	diffs.old_name_length.clear();
+	diffs.new_name_length.clear();
+	diffs.op.clear();
+	diffs.op_mode.clear();
+	diffs.old_mode.clear();
+	diffs.new_mode.clear();
+	diffs.flags.clear();
+	diffs.first_hunk.clear();
+	diffs.hunk_count.clear();
+	diffs.first_binary.clear();
+	diffs.binary_count.clear();
+
+	hunks.diff.clear();
+	hunks.first_line.clear();
+	hunks.line_count.clear();
+	hunks.old_count.clear();
+	hunks.old_lines.clear();
+	hunks.new_count.clear();
+	hunks.new_lines.clear();
+	hunks.section_offset.clear();
+	hunks.section_length.clear();
+
+	lines.kind.clear();
+	lines.old_line.clear();
+	lines.new_line.clear();
+	lines.offset.clear();
+	lines.length.clear();
+	lines.flags.clear();
+
+	binary.diff.clear();
+	binary.type.clear();
+	binary.hunk_size.clear();
+}
+
+uint64_t ColumnarPatch::offset_of(std::string_view view) const {
+	if(view.data() >= source.data() && view.data() + view.size() <= source.data() + source.size()) {
+		return static_cast<uint64_t>(view.data() - source.data());
+	}
+	return 0;
+}
+
+std::string_view ColumnarPatch::view(uint64_t offset, uint32_t length) const {
+	return source.substr(offset, length);
+}
+
+Diff *ColumnarPatch::new_diff() {
+	collector.table = this;
+
+	diffs.old_name_offset.emplace_back(0);
+	diffs.new_name_offset.emplace_back(0);
+	diffs.old_name_length.emplace_back(0);
+	diffs.new_name_length.emplace_back(0);
+	diffs.op.emplace_back(FileOpCode::None);
+	diffs.op_mode.emplace_back(0);
+	diffs.old_mode.emplace_back(0);
+	diffs.new_mode.emplace_back(0);
+	diffs.flags.emplace_back(0);
+	diffs.first_hunk.emplace_back(static_cast<uint32_t>(hunks.size()));
+	diffs.hunk_count.emplace_back(0);
+	diffs.first_binary.emplace_back(static_cast<uint32_t>(binary.size()));
+	diffs.binary_count.emplace_back(0);
+
+	return &collector;
+}
+
+void ColumnarPatch::close() {
+}
+
+void ColumnarPatch::DiffCollector::set_info(const std::string_view old_name, const std::string_view new_name, FileOp op, std::optional<std::vector<BinaryHunk>> binary_sizes, std::optional<FileMode> file_mode) {
+	auto &diffs = table->diffs;
+	auto idx = diffs.size() - 1;
+
+	diffs.old_name_offset[idx] = table->offset_of(old_name);
+	diffs.old_name_length[idx] = static_cast<uint32_t>(old_name.size());
+	diffs.new_name_offset[idx] = table->offset_of(new_name);
+	diffs.new_name_length[idx] = static_cast<uint32_t>(new_name.size());
+	diffs.op[idx] = op.code;
+	diffs.op_mode[idx] = op.something;
+
+	uint8_t flags = 0;
+	if(file_mode) {
+		flags |= DIFF_FILE_MODE;
+		diffs.old_mode[idx] = file_mode->old;
+		diffs.new_mode[idx] = file_mode->neo;
+	}
+	if(binary_sizes) {
+		flags |= DIFF_BINARY;
+		diffs.binary_count[idx] = static_cast<uint32_t>(binary_sizes->size());
+		for(auto &h: *binary_sizes) {
+			table->binary.diff.emplace_back(static_cast<uint32_t>(idx));
+			table->binary.type.emplace_back(h.type);
+			table->binary.hunk_size.emplace_back(h.size);
+		}
+	}
+	diffs.flags[idx] = flags;
+}
+
+void ColumnarPatch::DiffCollector::add_line(uint32_t old_line, uint32_t new_line, std::string_view &&line) {
+	auto &lines = table->lines;
+
+	LineKind kind;
+	if(old_line == 0) {
+		kind = LineKind::Added;
+	} else if(new_line == 0) {
+		kind = LineKind::Removed;
+	} else {
+		kind = LineKind::Context;
+	}
+
+	lines.kind.emplace_back(kind);
+	lines.old_line.emplace_back(old_line);
+	lines.new_line.emplace_back(new_line);
+	lines.offset.emplace_back(table->offset_of(line));
+	lines.length.emplace_back(static_cast<uint32_t>(line.size()));
+	lines.flags.emplace_back(0);
+
+	++table->hunks.line_count.back();
+}
+
+void ColumnarPatch::DiffCollector::new_hunk() {
+	new_hunk(NumbersT {}, {});
+}
+
+void ColumnarPatch::DiffCollector::new_hunk(const NumbersT &nums, std::string_view section) {
+	auto &hunks = table->hunks;
+	hunks.diff.emplace_back(static_cast<uint32_t>(table->diffs.size() - 1));
+	hunks.first_line.emplace_back(table->lines.size());
+	hunks.line_count.emplace_back(0);
+	hunks.old_count.emplace_back(nums.old_count);
+	hunks.old_lines.emplace_back(nums.old_lines);
+	hunks.new_count.emplace_back(nums.new_count);
+	hunks.new_lines.emplace_back(nums.new_lines);
+	hunks.section_offset.emplace_back(table->offset_of(section));
+	hunks.section_length.emplace_back(static_cast<uint32_t>(section.size()));
+
+	++table->diffs.hunk_count.back();
+}
+
+void ColumnarPatch::DiffCollector::no_newline() {
+	if(!table->lines.flags.empty()) {
+		table->lines.flags.back() |= LINE_NO_NEWLINE;
+	}
+}
+
+void ColumnarPatch::DiffCollector::close() {
+}
+
+};// namespace ParsePatch
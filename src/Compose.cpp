@@ -0,0 +1,419 @@
+#include <algorithm>
+#include <unordered_map>
+
+#include "ParsePatch/Compose.hpp"
+#include "ParsePatch/Writer.hpp"
+
+namespace ParsePatch {
+
+namespace {
+
+using Line = ComposedPatch::Line;
+using File = ComposedPatch::File;
+
+/// Groups the lines of a file into hunks: a line starts a new hunk if it is not right after the previous one on both sides
+void build_hunks(File &file) {
+	file.hunks.clear();
+	// new - old of the lines passed
+	int64_t delta = 0;
+	uint32_t next_old = 0, next_new = 0;
+	for(size_t i = 0; i < file.lines.size(); ++i) {
+		auto &line = file.lines[i];
+		uint32_t old_pos = line.old_line, new_pos = line.new_line;
+		if(line.kind == LineKind::Removed) {
+			new_pos = static_cast<uint32_t>(old_pos + delta);
+		} else if(line.kind == LineKind::Added) {
+			old_pos = static_cast<uint32_t>(new_pos - delta);
+		}
+
+		if(file.hunks.empty() || old_pos != next_old || new_pos != next_new) {
+			file.hunks.emplace_back(ComposedPatch::Hunk {{old_pos, 0, new_pos, 0}, i, 0});
+		}
+		auto &hunk = file.hunks.back();
+		++hunk.line_count;
+		next_old = old_pos;
+		next_new = new_pos;
+		if(line.kind != LineKind::Added) {
+			++hunk.numbers.old_lines;
+			++next_old;
+		}
+		if(line.kind != LineKind::Removed) {
+			++hunk.numbers.new_lines;
+			++next_new;
+		}
+		delta = static_cast<int64_t>(next_new) - next_old;
+	}
+}
+
+/// Drops the hunks left with context lines only, after the changes in them cancelled out
+void drop_unchanged_hunks(File &file) {
+	std::vector<Line> lines;
+	std::vector<ComposedPatch::Hunk> hunks;
+	for(auto &hunk: file.hunks) {
+		auto first = begin(file.lines) + hunk.first_line, last = first + hunk.line_count;
+		if(std::all_of(first, last, [](const Line &l) {
+			   return l.kind == LineKind::Context;
+		   })) {
+			continue;
+		}
+		hunks.emplace_back(hunk).first_line = lines.size();
+		lines.insert(end(lines), first, last);
+	}
+	file.lines = std::move(lines);
+	file.hunks = std::move(hunks);
+}
+
+/// Turns the lines removed by one patch and added back by another into context: in every run of changes, the removed and the added lines equal at its start and at its end
+void cancel_readded_lines(File &file) {
+	std::vector<Line> lines, removed, added;
+	lines.reserve(file.lines.size());
+	auto flush = [&] {
+		size_t prefix = 0, suffix = 0;
+		auto same = [](const Line &r, const Line &a) {
+			return r.text == a.text && r.no_newline == a.no_newline;
+		};
+		while(prefix < removed.size() && prefix < added.size() && same(removed[prefix], added[prefix])) {
+			++prefix;
+		}
+		while(suffix < removed.size() - prefix && suffix < added.size() - prefix && same(removed[removed.size() - 1 - suffix], added[added.size() - 1 - suffix])) {
+			++suffix;
+		}
+		auto context = [&](size_t r, size_t a) {
+			lines.emplace_back(Line {LineKind::Context, removed[r].old_line, added[a].new_line, removed[r].text, removed[r].no_newline});
+		};
+		for(size_t i = 0; i < prefix; ++i) {
+			context(i, i);
+		}
+		lines.insert(end(lines), begin(removed) + prefix, end(removed) - suffix);
+		lines.insert(end(lines), begin(added) + prefix, end(added) - suffix);
+		for(size_t i = suffix; i > 0; --i) {
+			context(removed.size() - i, added.size() - i);
+		}
+		removed.clear();
+		added.clear();
+	};
+	// a run ends at a gap between the lines too, positions are computed as in `build_hunks`
+	int64_t delta = 0;
+	uint32_t next_old = 0, next_new = 0;
+	for(auto &line: file.lines) {
+		uint32_t old_pos = line.old_line, new_pos = line.new_line;
+		if(line.kind == LineKind::Removed) {
+			new_pos = static_cast<uint32_t>(old_pos + delta);
+		} else if(line.kind == LineKind::Added) {
+			old_pos = static_cast<uint32_t>(new_pos - delta);
+		}
+		if(line.kind == LineKind::Context || old_pos != next_old || new_pos != next_new) {
+			flush();
+		}
+		if(line.kind == LineKind::Context) {
+			lines.emplace_back(line);
+		} else {
+			(line.kind == LineKind::Removed ? removed : added).emplace_back(line);
+		}
+
+		next_old = old_pos + (line.kind != LineKind::Added);
+		next_new = new_pos + (line.kind != LineKind::Removed);
+		delta = static_cast<int64_t>(next_new) - next_old;
+	}
+	flush();
+	file.lines = std::move(lines);
+}
+
+/// The position of a line in the intermediate file, lines "between" the lines of the file go before the line at `y`
+struct Key {
+	uint32_t y;
+	/// 0: between lines, 1: the line itself
+	uint8_t order;
+
+	auto operator<=>(const Key &) const = default;
+};
+
+constexpr Key no_key {UINT32_MAX, UINT8_MAX};
+
+/// Walks the lines of a file, computing their positions in the intermediate file
+struct Cursor {
+	const std::vector<Line> &lines;
+	/// Whether the lines are of the first patch, positioned by their new side, or of the second one, positioned by the old side
+	bool first;
+	size_t i = 0;
+	/// added - removed of the lines passed
+	int64_t delta = 0;
+
+	Key key() const {
+		if(i == lines.size()) {
+			return no_key;
+		}
+		auto &line = lines[i];
+		if(first) {
+			if(line.kind == LineKind::Removed) {
+				return {static_cast<uint32_t>(line.old_line + delta), 0};
+			}
+			return {line.new_line, 1};
+		}
+		if(line.kind == LineKind::Added) {
+			return {static_cast<uint32_t>(line.new_line - delta), 0};
+		}
+		return {line.old_line, 1};
+	}
+
+	const Line &advance() {
+		auto &line = lines[i++];
+		if(line.kind == LineKind::Added) {
+			++delta;
+		} else if(line.kind == LineKind::Removed) {
+			--delta;
+		}
+		return line;
+	}
+};
+
+/// Composes the lines of a file changed by two patches
+void compose_lines(const File &a, const File &b, File &res, std::vector<ComposedPatch::Conflict> &conflicts, size_t patch) {
+	Cursor ca {a.lines, true}, cb {b.lines, false};
+	while(true) {
+		auto ka = ca.key(), kb = cb.key();
+		if(ka == no_key && kb == no_key) {
+			break;
+		}
+
+		// lines between the lines of the intermediate file: removed by the first patch before the ones added by the second
+		if(ka.order == 0 && ka <= kb) {
+			auto &line = ca.advance();
+			res.lines.emplace_back(Line {LineKind::Removed, line.old_line, 0, line.text, line.no_newline});
+			continue;
+		}
+		if(kb.order == 0 && kb < ka) {
+			auto &line = cb.advance();
+			res.lines.emplace_back(Line {LineKind::Added, 0, line.new_line, line.text, line.no_newline});
+			continue;
+		}
+
+		// a line of the intermediate file, touched by one of the patches or both
+		auto y = std::min(ka, kb).y;
+		bool in_a = ka.y == y, in_b = kb.y == y;
+		// unchanged lines are shifted by the changes before them
+		uint32_t old_line = static_cast<uint32_t>(y - ca.delta);
+		uint32_t new_line = static_cast<uint32_t>(y + cb.delta);
+		bool added = false, removed = false;
+		std::string_view text;
+		// the line end on the old side comes from the first patch, on the new side from the second one
+		bool old_no_newline = false, new_no_newline = false;
+		if(in_b) {
+			auto &line = cb.advance();
+			text = line.text;
+			removed = line.kind == LineKind::Removed;
+			new_line = line.new_line;
+			old_no_newline = new_no_newline = line.no_newline;
+		}
+		if(in_a) {
+			auto &line = ca.advance();
+			if(in_b && (line.text != text || line.no_newline != new_no_newline)) {
+				conflicts.emplace_back(ComposedPatch::Conflict {ConflictKind::ContextMismatch, b.old_name.empty() ? b.new_name : b.old_name, y, patch});
+			}
+			text = line.text;
+			added = line.kind == LineKind::Added;
+			old_line = line.old_line;
+			old_no_newline = line.no_newline;
+			if(!in_b) {
+				new_no_newline = line.no_newline;
+			}
+		}
+
+		if(added && removed) {
+			continue;
+		}
+		if(added) {
+			res.lines.emplace_back(Line {LineKind::Added, 0, new_line, text, new_no_newline});
+		} else if(removed) {
+			res.lines.emplace_back(Line {LineKind::Removed, old_line, 0, text, old_no_newline});
+		} else {
+			res.lines.emplace_back(Line {LineKind::Context, old_line, new_line, text, old_no_newline});
+		}
+	}
+}
+
+/// The path of the file between the two patches
+std::string_view intermediate_name(const File &file, bool first) {
+	if(first) {
+		return file.op.code == FileOpCode::Deleted ? file.old_name : file.new_name;
+	}
+	return file.op.code == FileOpCode::New ? file.new_name : file.old_name;
+}
+
+std::optional<FileMode> compose_modes(const File &a, const File &b) {
+	if(!a.file_mode) {
+		return b.file_mode;
+	}
+	if(!b.file_mode) {
+		return a.file_mode;
+	}
+	if(a.file_mode->old == b.file_mode->neo) {
+		return {};
+	}
+	return FileMode {a.file_mode->old, b.file_mode->neo};
+}
+
+/// Composes the ops of a file changed by two patches, returns nothing if the changes cancel out
+std::optional<File> compose_files(const File &a, const File &b, std::vector<ComposedPatch::Conflict> &conflicts, size_t patch) {
+	auto a_op = a.op.code, b_op = b.op.code;
+	auto name = intermediate_name(a, true);
+	if(a_op == FileOpCode::Deleted && b_op != FileOpCode::New) {
+		conflicts.emplace_back(ComposedPatch::Conflict {ConflictKind::FileDeleted, name, 0, patch});
+		return a;
+	}
+	if(a_op != FileOpCode::Deleted && b_op == FileOpCode::New) {
+		conflicts.emplace_back(ComposedPatch::Conflict {ConflictKind::FileExists, name, 0, patch});
+		return a;
+	}
+	if(a.binary && b.binary) {
+		conflicts.emplace_back(ComposedPatch::Conflict {ConflictKind::Binary, name, 0, patch});
+		return a;
+	}
+
+	File res;
+	res.old_name = a.old_name;
+	res.new_name = b.new_name;
+	res.binary = a.binary || b.binary;
+	res.file_mode = compose_modes(a, b);
+	if(a_op == FileOpCode::New && b_op == FileOpCode::Deleted) {
+		return {};
+	} else if(a_op == FileOpCode::Deleted && b_op == FileOpCode::New) {
+		// deleted and created again: a change of the contents
+		if(a.op.something != b.op.something) {
+			res.file_mode = FileMode {a.op.something, b.op.something};
+		}
+	} else if(a_op == FileOpCode::New) {
+		// the mode of a new file is the final one
+		res.op = {FileOpCode::New, res.file_mode ? res.file_mode->neo : a.op.something};
+		res.file_mode = {};
+	} else if(b_op == FileOpCode::Deleted) {
+		res.op = {FileOpCode::Deleted, res.file_mode ? res.file_mode->old : b.op.something};
+		res.file_mode = {};
+	} else if(a_op == FileOpCode::Copied || b_op == FileOpCode::Copied) {
+		res.op = {FileOpCode::Copied, 0};
+	} else if(res.old_name != res.new_name) {
+		res.op = {FileOpCode::Renamed, 0};
+	}
+
+	compose_lines(a, b, res, conflicts, patch);
+	cancel_readded_lines(res);
+	build_hunks(res);
+	drop_unchanged_hunks(res);
+	if(res.hunks.empty() && !res.binary && !res.file_mode && res.op.code == FileOpCode::None) {
+		// the changes cancelled out
+		return {};
+	}
+	return res;
+}
+
+}// namespace
+
+ComposedPatch ComposedPatch::from(const ColumnarPatch &patch) {
+	ComposedPatch res;
+	res.patches = 1;
+	auto &d = patch.diffs;
+	res.files.reserve(d.size());
+	for(size_t i = 0; i < d.size(); ++i) {
+		auto &file = res.files.emplace_back();
+		file.old_name = patch.view(d.old_name_offset[i], d.old_name_length[i]);
+		file.new_name = patch.view(d.new_name_offset[i], d.new_name_length[i]);
+		file.op = {d.op[i], d.op_mode[i]};
+		if(d.flags[i] & DIFF_FILE_MODE) {
+			file.file_mode = FileMode {d.old_mode[i], d.new_mode[i]};
+		}
+		file.binary = d.flags[i] & DIFF_BINARY;
+		for(auto h = d.first_hunk[i]; h < d.first_hunk[i] + d.hunk_count[i]; ++h) {
+			auto first = patch.hunks.first_line[h];
+			for(auto l = first; l < first + patch.hunks.line_count[h]; ++l) {
+				auto &lines = patch.lines;
+				file.lines.emplace_back(Line {lines.kind[l], lines.old_line[l], lines.new_line[l], patch.view(lines.offset[l], lines.length[l]), bool(lines.flags[l] & LINE_NO_NEWLINE)});
+			}
+		}
+		build_hunks(file);
+	}
+	return res;
+}
+
+void ComposedPatch::then(const ComposedPatch &next) {
+	std::vector<File> res;
+	res.reserve(files.size() + next.files.size());
+	std::vector<bool> used(next.files.size());
+
+	// the first file of `next` with each intermediate name not used yet, and for each file the next one with its name
+	constexpr auto none = SIZE_MAX;
+	std::unordered_map<std::string_view, size_t> by_name;
+	std::vector<size_t> same_name(next.files.size(), none);
+	by_name.reserve(next.files.size());
+	for(auto i = next.files.size(); i--;) {
+		auto name = intermediate_name(next.files[i], false);
+		if(name.empty()) {
+			continue;
+		}
+		auto [it, inserted] = by_name.try_emplace(name, i);
+		if(!inserted) {
+			same_name[i] = it->second;
+			it->second = i;
+		}
+	}
+
+	for(auto &a: files) {
+		auto name = intermediate_name(a, true);
+		auto it = name.empty() ? end(by_name) : by_name.find(name);
+		if(it == end(by_name) || it->second == none) {
+			res.emplace_back(a);
+			continue;
+		}
+		auto b = it->second;
+		it->second = same_name[b];
+		used[b] = true;
+		if(auto file = compose_files(a, next.files[b], conflicts, patches)) {
+			res.emplace_back(std::move(*file));
+		}
+	}
+	for(size_t i = 0; i < next.files.size(); ++i) {
+		if(!used[i]) {
+			res.emplace_back(next.files[i]);
+		}
+	}
+
+	files = std::move(res);
+	patches += next.patches;
+}
+
+void ComposedPatch::replay(Patch &patch) const {
+	for(auto &file: files) {
+		auto diff = patch.new_diff();
+		std::optional<std::vector<BinaryHunk>> binary_sizes;
+		if(file.binary) {
+			binary_sizes.emplace();
+		}
+		diff->set_info(file.old_name, file.new_name, file.op, std::move(binary_sizes), file.file_mode);
+		for(auto &hunk: file.hunks) {
+			diff->new_hunk();
+			for(auto l = hunk.first_line; l < hunk.first_line + hunk.line_count; ++l) {
+				auto &line = file.lines[l];
+				diff->add_line(line.old_line, line.new_line, std::string_view(line.text));
+				if(line.no_newline) {
+					diff->no_newline();
+				}
+			}
+		}
+		diff->close();
+	}
+	patch.close();
+}
+
+void ComposedPatch::write_unified(std::ostream &out) const {
+	PatchWriter writer(out);
+	replay(writer);
+}
+
+ComposedPatch compose(std::span<const ColumnarPatch *const> patches) {
+	ComposedPatch res;
+	for(auto patch: patches) {
+		res.then(ComposedPatch::from(*patch));
+	}
+	return res;
+}
+
+};// namespace ParsePatch
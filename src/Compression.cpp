@@ -0,0 +1,322 @@
+#include <algorithm>
+#include <climits>
+#include <optional>
+
+#include "ParsePatch/Compression.hpp"
+
+#ifdef PARSEPATCH_WITH_ZLIB
+	#include <zlib.h>
+#endif
+#ifdef PARSEPATCH_WITH_LZMA
+	#include <lzma.h>
+#endif
+#ifdef PARSEPATCH_WITH_ZSTD
+	#include <zstd.h>
+#endif
+
+namespace ParsePatch {
+
+/// A streaming decompressor of an in-memory buffer
+struct Decoder {
+	virtual ~Decoder() = default;
+
+	/// Decompresses the next piece into `out`. Returns the number of bytes written, 0 at the end of the data, nothing if the data is corrupted or truncated.
+	virtual std::optional<size_t> decode(char *out, size_t capacity) = 0;
+};
+
+namespace {
+
+#ifdef PARSEPATCH_WITH_ZLIB
+struct GzipDecoder: public Decoder {
+	z_stream z {};
+	std::string_view input;
+	bool ok;
+	bool member_end = false;
+
+	GzipDecoder(std::string_view input): input(input) {
+		// 32: detect a gzip or a zlib header
+		ok = inflateInit2(&z, 15 + 32) == Z_OK;
+	}
+
+	virtual ~GzipDecoder() {
+		inflateEnd(&z);
+	}
+
+	void feed() {
+		if(!z.avail_in && !input.empty()) {
+			auto n = std::min<size_t>(input.size(), UINT_MAX);
+			z.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+			z.avail_in = static_cast<uInt>(n);
+			input.remove_prefix(n);
+		}
+	}
+
+	virtual std::optional<size_t> decode(char *out, size_t capacity) override {
+		if(!ok) {
+			return {};
+		}
+		z.next_out = reinterpret_cast<Bytef *>(out);
+		z.avail_out = static_cast<uInt>(std::min<size_t>(capacity, UINT_MAX));
+		auto capacity_left = z.avail_out;
+
+		while(z.avail_out) {
+			feed();
+			if(member_end) {
+				if(!z.avail_in) {
+					break;
+				}
+				// gzip files may consist of several members
+				if(inflateReset(&z) != Z_OK) {
+					ok = false;
+					break;
+				}
+				member_end = false;
+			}
+			auto ret = inflate(&z, Z_NO_FLUSH);
+			if(ret == Z_STREAM_END) {
+				member_end = true;
+			} else if(ret != Z_OK) {
+				// Z_BUF_ERROR here means the input ended inside a member
+				ok = false;
+				break;
+			}
+		}
+
+		size_t produced = capacity_left - z.avail_out;
+		if(!ok && !produced) {
+			return {};
+		}
+		return produced;
+	}
+};
+#endif
+
+#ifdef PARSEPATCH_WITH_LZMA
+struct XzDecoder: public Decoder {
+	lzma_stream s = LZMA_STREAM_INIT;
+	bool ok, done = false;
+
+	XzDecoder(std::string_view input) {
+		ok = lzma_stream_decoder(&s, UINT64_MAX, LZMA_CONCATENATED) == LZMA_OK;
+		s.next_in = reinterpret_cast<const uint8_t *>(input.data());
+		s.avail_in = input.size();
+	}
+
+	virtual ~XzDecoder() {
+		lzma_end(&s);
+	}
+
+	virtual std::optional<size_t> decode(char *out, size_t capacity) override {
+		if(!ok) {
+			return {};
+		}
+		s.next_out = reinterpret_cast<uint8_t *>(out);
+		s.avail_out = capacity;
+
+		while(s.avail_out && !done) {
+			// the whole input is available from the start, so it is finished from the start
+			auto ret = lzma_code(&s, LZMA_FINISH);
+			if(ret == LZMA_STREAM_END) {
+				done = true;
+			} else if(ret != LZMA_OK) {
+				ok = false;
+				break;
+			}
+		}
+
+		size_t produced = capacity - s.avail_out;
+		if(!ok && !produced) {
+			return {};
+		}
+		return produced;
+	}
+};
+#endif
+
+#ifdef PARSEPATCH_WITH_ZSTD
+struct ZstdDecoder: public Decoder {
+	ZSTD_DStream *ds;
+	ZSTD_inBuffer in;
+	bool ok, done = false;
+
+	ZstdDecoder(std::string_view input): ds(ZSTD_createDStream()), in {input.data(), input.size(), 0} {
+		ok = ds && !ZSTD_isError(ZSTD_initDStream(ds));
+	}
+
+	virtual ~ZstdDecoder() {
+		ZSTD_freeDStream(ds);
+	}
+
+	virtual std::optional<size_t> decode(char *out, size_t capacity) override {
+		if(!ok) {
+			return {};
+		}
+		ZSTD_outBuffer o {out, capacity, 0};
+
+		while(o.pos < o.size && !done) {
+			auto out_before = o.pos;
+			auto in_before = in.pos;
+			auto ret = ZSTD_decompressStream(ds, &o, &in);
+			if(ZSTD_isError(ret)) {
+				ok = false;
+				break;
+			}
+			if(!ret && in.pos == in.size) {
+				// the last frame is decoded and flushed
+				done = true;
+			} else if(o.pos == out_before && in.pos == in_before) {
+				// no progress: the input ended inside a frame
+				ok = false;
+				break;
+			}
+		}
+
+		if(!ok && !o.pos) {
+			return {};
+		}
+		return o.pos;
+	}
+};
+#endif
+
+std::unique_ptr<Decoder> make_decoder([[maybe_unused]] std::string_view input, Compression format) {
+	switch(format) {
+#ifdef PARSEPATCH_WITH_ZLIB
+		case Compression::Gzip:
+			return std::make_unique<GzipDecoder>(input);
+#endif
+#ifdef PARSEPATCH_WITH_LZMA
+		case Compression::Xz:
+			return std::make_unique<XzDecoder>(input);
+#endif
+#ifdef PARSEPATCH_WITH_ZSTD
+		case Compression::Zstd:
+			return std::make_unique<ZstdDecoder>(input);
+#endif
+		default:
+			return {};
+	}
+}
+
+}// namespace
+
+Compression detect_compression(std::string_view head) {
+	if(head.starts_with("\x1f\x8b")) {
+		return Compression::Gzip;
+	}
+	if(head.starts_with("\x28\xb5\x2f\xfd")) {
+		return Compression::Zstd;
+	}
+	if(head.starts_with(std::string_view("\xfd" "7zXZ\0", 6))) {
+		return Compression::Xz;
+	}
+	return Compression::None;
+}
+
+bool compression_supported(Compression format) {
+	switch(format) {
+		case Compression::None:
+			return true;
+		case Compression::Gzip:
+#ifdef PARSEPATCH_WITH_ZLIB
+			return true;
+#else
+			return false;
+#endif
+		case Compression::Zstd:
+#ifdef PARSEPATCH_WITH_ZSTD
+			return true;
+#else
+			return false;
+#endif
+		case Compression::Xz:
+#ifdef PARSEPATCH_WITH_LZMA
+			return true;
+#else
+			return false;
+#endif
+	}
+	return false;
+}
+
+DecompressingSource::DecompressingSource(std::string_view compressed, Compression format, size_t chunk_size, size_t queue_depth): decoder(make_decoder(compressed, format)), buffers(std::max<size_t>(queue_depth, 1)) {
+	for(auto &b: buffers) {
+		b.resize(chunk_size);
+		free.emplace_back(&b);
+	}
+	if(!decoder) {
+		finished = failed = true;
+		return;
+	}
+	thread = std::thread(&DecompressingSource::run, this);
+}
+
+DecompressingSource::~DecompressingSource() {
+	{
+		std::lock_guard lock(mutex);
+		stopping = true;
+	}
+	cv.notify_all();
+	if(thread.joinable()) {
+		thread.join();
+	}
+}
+
+void DecompressingSource::run() {
+	while(true) {
+		std::string *buffer;
+		{
+			std::unique_lock lock(mutex);
+			cv.wait(lock, [&] {
+				return stopping || !free.empty();
+			});
+			if(stopping) {
+				return;
+			}
+			buffer = free.front();
+			free.pop_front();
+		}
+
+		// decompression runs unlocked, in parallel with the parsing of the previous chunks
+		auto produced = decoder->decode(buffer->data(), buffer->size());
+
+		{
+			std::lock_guard lock(mutex);
+			if(!produced || !*produced) {
+				failed = !produced;
+				finished = true;
+				free.emplace_back(buffer);
+			} else {
+				filled.emplace_back(buffer, *produced);
+			}
+		}
+		cv.notify_all();
+		if(!produced || !*produced) {
+			return;
+		}
+	}
+}
+
+Result<std::string_view> DecompressingSource::next_chunk() {
+	std::unique_lock lock(mutex);
+	if(consumed) {
+		free.emplace_back(consumed);
+		consumed = nullptr;
+		cv.notify_all();
+	}
+	cv.wait(lock, [&] {
+		return !filled.empty() || finished;
+	});
+	if(!filled.empty()) {
+		auto [buffer, size] = filled.front();
+		filled.pop_front();
+		consumed = buffer;
+		return std::string_view(buffer->data(), size);
+	}
+	if(failed) {
+		return unexpected<ParsepatchError>({ParsepatchErrorCode::InvalidCompressedData, 0});
+	}
+	return std::string_view {};
+}
+
+};// namespace ParsePatch
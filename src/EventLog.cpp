@@ -0,0 +1,507 @@
+#include <array>
+#include <cstdint>
+#include <span>
+
+#include "ParsePatch/EventLog.hpp"
+
+namespace ParsePatch {
+
+namespace {
+
+enum struct Tag : uint8_t {
+	Diff,
+	Header,
+	Hunk,
+	Context,
+	Added,
+	Removed,
+	HunkRange,
+	DiffRange,
+	DiffEnd,
+	PatchEnd,
+	PathIds,
+	/// A hunk with the numbers and the section heading of its `@@` line
+	HunkHeader,
+	SizeHint,
+	NoNewline
+};
+
+/// Bits of the tag byte of a line: the common case is a line right after the previous one, numbered as expected, and takes 2 bytes
+enum LineFlags : uint8_t {
+	LINE_OLD_NEXT = 1 << 4,/// The old number is the expected one, no difference follows
+	LINE_NEW_NEXT = 1 << 5,/// The new number is the expected one
+	LINE_ADJACENT = 1 << 6,/// The text starts 2 bytes (the line end and the marker) after the previous view, only its length follows
+	LINE_FLAGS = LINE_OLD_NEXT | LINE_NEW_NEXT | LINE_ADJACENT
+};
+
+enum DiffInfoFlags : uint8_t {
+	INFO_BINARY = 1 << 0,
+	INFO_FILE_MODE = 1 << 1
+};
+
+/// A line decoded ahead of its callback
+struct DecodedLine {
+	uint32_t old_line, new_line;
+	std::string_view text;
+};
+
+/// Reads the records of a log, every read is checked against its end
+struct LogReader {
+	const uint8_t *p, *end;
+	std::string_view source;
+	uint64_t cursor = 0;
+	bool ok = true;
+
+	uint8_t byte() {
+		if(p == end) {
+			ok = false;
+			return 0;
+		}
+		return *p++;
+	}
+
+	uint64_t get() {
+		// most numbers are small differences
+		if(p != end && *p < 0x80) {
+			return *p++;
+		}
+		uint64_t value = 0;
+		for(unsigned shift = 0; shift < 64; shift += 7) {
+			auto b = byte();
+			value |= uint64_t(b & 0x7F) << shift;
+			if(!(b & 0x80)) {
+				return value;
+			}
+		}
+		ok = false;
+		return 0;
+	}
+
+	int64_t get_signed() {
+		auto value = get();
+		return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+	}
+
+	uint32_t get32() {
+		auto value = get();
+		ok = ok && value <= UINT32_MAX;
+		return static_cast<uint32_t>(value);
+	}
+
+	/// Decodes the records of lines from the current position until another record, at most as many as fit into `lines`. Lines are decoded in batches with no calls between them and without branching on their kind, which is unpredictable.
+	size_t decode_lines(std::span<DecodedLine> lines, uint32_t &old_next, uint32_t &new_next) {
+		// the position is kept in locals, the stored views could alias the members
+		auto q = p;
+		auto position = cursor;
+		auto number = [&]() -> uint64_t {
+			if(q != end && *q < 0x80) {
+				return *q++;
+			}
+			p = q;
+			auto value = get();
+			q = p;
+			return value;
+		};
+		auto zigzag = [](uint64_t value) {
+			return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+		};
+
+		size_t count = 0;
+		while(count < lines.size() && q != end) {
+			auto byte = *q;
+			auto tag = static_cast<Tag>(byte & ~LINE_FLAGS);
+			if(tag < Tag::Context || tag > Tag::Removed) {
+				break;
+			}
+			++q;
+			// a line without a number has the flag of the expected number set
+			int64_t old_delta = byte & LINE_OLD_NEXT ? 0 : zigzag(number());
+			int64_t new_delta = byte & LINE_NEW_NEXT ? 0 : zigzag(number());
+			bool has_old = tag != Tag::Added, has_new = tag != Tag::Removed;
+			auto old_line = has_old ? static_cast<uint32_t>(old_next + old_delta) : 0u;
+			auto new_line = has_new ? static_cast<uint32_t>(new_next + new_delta) : 0u;
+			old_next = has_old ? old_line + 1 : old_next;
+			new_next = has_new ? new_line + 1 : new_next;
+
+			std::string_view text;
+			if(byte & LINE_ADJACENT) {
+				auto offset = position + 2;
+				auto size = number();
+				if(offset > source.size() || size > source.size() - offset) {
+					ok = false;
+				} else {
+					text = source.substr(offset, size);
+					position = offset + size;
+				}
+			} else {
+				p = q;
+				cursor = position;
+				text = get_view();
+				q = p;
+				position = cursor;
+			}
+			if(!ok) {
+				break;
+			}
+			lines[count++] = DecodedLine {old_line, new_line, text};
+		}
+		p = q;
+		cursor = position;
+		return count;
+	}
+
+	std::string_view get_view() {
+		auto header = get();
+		auto size = header >> 1;
+		if(header & 1) {
+			// inline bytes
+			if(size > static_cast<uint64_t>(end - p)) {
+				ok = false;
+				return {};
+			}
+			std::string_view view(reinterpret_cast<const char *>(p), size);
+			p += size;
+			return view;
+		}
+		auto offset = cursor + get_signed();
+		if(offset > source.size() || size > source.size() - offset) {
+			ok = false;
+			return {};
+		}
+		cursor = offset + size;
+		return source.substr(offset, size);
+	}
+};
+
+/// Drops every event, to check a log
+struct NullPatch: public Patch {
+	struct NullDiff: public Diff {
+		virtual void set_info(const std::string_view, const std::string_view, FileOp, std::optional<std::vector<BinaryHunk>>, std::optional<FileMode>) override {
+		}
+
+		virtual void add_line(uint32_t, uint32_t, std::string_view &&) override {
+		}
+
+		using Diff::new_hunk;
+
+		virtual void new_hunk() override {
+		}
+
+		virtual void close() override {
+		}
+	} diff;
+
+	virtual Diff *new_diff() override {
+		return &diff;
+	}
+
+	virtual void close() override {
+	}
+};
+
+}// namespace
+
+EventLogWriter::EventLogWriter(std::string_view source) {
+	recorder.writer = this;
+	reset(source);
+}
+
+void EventLogWriter::reset(std::string_view source) {
+	this->source = source;
+	log.assign(magic_value, sizeof(magic_value));
+	cursor = range_end = 0;
+	old_next = new_next = 0;
+	put(source.size());
+}
+
+void EventLogWriter::put(uint64_t value) {
+	char buf[10];
+	size_t n = 0;
+	while(value >= 0x80) {
+		buf[n++] = static_cast<char>(value | 0x80);
+		value >>= 7;
+	}
+	buf[n++] = static_cast<char>(value);
+	log.append(buf, n);
+}
+
+void EventLogWriter::put_signed(int64_t value) {
+	// zigzag: small differences of both signs take one byte
+	put((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void EventLogWriter::put_view(std::string_view view) {
+	auto in_source = !source.empty() && view.data() >= source.data() && view.data() + view.size() <= source.data() + source.size();
+	if(!in_source) {
+		put(view.size() << 1 | 1);
+		log.append(view);
+		return;
+	}
+	uint64_t offset = view.data() - source.data();
+	put(view.size() << 1);
+	put_signed(static_cast<int64_t>(offset - cursor));
+	cursor = offset + view.size();
+}
+
+Diff *EventLogWriter::new_diff() {
+	return &recorder;
+}
+
+void EventLogWriter::close() {
+	log.push_back(static_cast<char>(Tag::PatchEnd));
+}
+
+void EventLogWriter::Recorder::set_info(const std::string_view old_name, const std::string_view new_name, FileOp op, std::optional<std::vector<BinaryHunk>> binary_sizes, std::optional<FileMode> file_mode) {
+	auto &w = *writer;
+	w.log.push_back(static_cast<char>(Tag::Diff));
+	w.put_view(old_name);
+	w.put_view(new_name);
+	w.log.push_back(static_cast<char>(op.code));
+	w.put(op.something);
+	w.log.push_back(static_cast<char>((binary_sizes ? INFO_BINARY : 0) | (file_mode ? INFO_FILE_MODE : 0)));
+	if(binary_sizes) {
+		w.put(binary_sizes->size());
+		for(auto &hunk: *binary_sizes) {
+			w.log.push_back(static_cast<char>(hunk.type));
+			w.put(hunk.size);
+		}
+	}
+	if(file_mode) {
+		w.put(file_mode->old);
+		w.put(file_mode->neo);
+	}
+}
+
+void EventLogWriter::Recorder::set_header(std::string_view header) {
+	writer->log.push_back(static_cast<char>(Tag::Header));
+	writer->put_view(header);
+}
+
+void EventLogWriter::Recorder::set_path_ids(uint32_t old_id, uint32_t new_id) {
+	writer->log.push_back(static_cast<char>(Tag::PathIds));
+	writer->put(old_id);
+	writer->put(new_id);
+}
+
+void EventLogWriter::Recorder::new_hunk() {
+	writer->log.push_back(static_cast<char>(Tag::Hunk));
+	// the first line of a hunk has its numbers in full
+	writer->old_next = writer->new_next = 0;
+}
+
+void EventLogWriter::Recorder::new_hunk(const NumbersT &nums, std::string_view section) {
+	auto &w = *writer;
+	w.log.push_back(static_cast<char>(Tag::HunkHeader));
+	w.put(nums.old_count);
+	w.put(nums.old_lines);
+	w.put(nums.new_count);
+	w.put(nums.new_lines);
+	w.put_view(section);
+	w.old_next = w.new_next = 0;
+}
+
+void EventLogWriter::Recorder::no_newline() {
+	writer->log.push_back(static_cast<char>(Tag::NoNewline));
+}
+
+void EventLogWriter::Recorder::size_hint(uint32_t hunks, uint64_t lines) {
+	writer->log.push_back(static_cast<char>(Tag::SizeHint));
+	writer->put(hunks);
+	writer->put(lines);
+}
+
+void EventLogWriter::Recorder::add_line(uint32_t old_line, uint32_t new_line, std::string_view &&line) {
+	auto &w = *writer;
+	auto tag = static_cast<uint8_t>(!old_line ? Tag::Added : (!new_line ? Tag::Removed : Tag::Context));
+	auto adjacent = !w.source.empty() && line.data() == w.source.data() + w.cursor + 2 && line.data() + line.size() <= w.source.data() + w.source.size();
+	// a line without a number has it "as expected", so the replay doesn't branch on the kind
+	tag |= (!old_line || old_line == w.old_next ? LINE_OLD_NEXT : 0) | (!new_line || new_line == w.new_next ? LINE_NEW_NEXT : 0) | (adjacent ? LINE_ADJACENT : 0);
+	w.log.push_back(static_cast<char>(tag));
+	if(old_line) {
+		if(!(tag & LINE_OLD_NEXT)) {
+			w.put_signed(int64_t(old_line) - w.old_next);
+		}
+		w.old_next = old_line + 1;
+	}
+	if(new_line) {
+		if(!(tag & LINE_NEW_NEXT)) {
+			w.put_signed(int64_t(new_line) - w.new_next);
+		}
+		w.new_next = new_line + 1;
+	}
+	if(adjacent) {
+		w.put(line.size());
+		w.cursor += 2 + line.size();
+	} else {
+		w.put_view(line);
+	}
+}
+
+void EventLogWriter::Recorder::set_hunk_range(uint64_t begin, uint64_t end) {
+	auto &w = *writer;
+	w.log.push_back(static_cast<char>(Tag::HunkRange));
+	w.put_signed(static_cast<int64_t>(begin - w.range_end));
+	w.put(end - begin);
+	w.range_end = end;
+}
+
+void EventLogWriter::Recorder::set_range(uint64_t begin, uint64_t end) {
+	auto &w = *writer;
+	w.log.push_back(static_cast<char>(Tag::DiffRange));
+	w.put_signed(static_cast<int64_t>(begin - w.range_end));
+	w.put(end - begin);
+	w.range_end = end;
+}
+
+void EventLogWriter::Recorder::close() {
+	writer->log.push_back(static_cast<char>(Tag::DiffEnd));
+}
+
+bool replay_event_log(std::string_view log, std::string_view source, Patch &patch) {
+	if(!log.starts_with(std::string_view(EventLogWriter::magic_value, sizeof(EventLogWriter::magic_value)))) {
+		return false;
+	}
+	LogReader r {reinterpret_cast<const uint8_t *>(log.data()) + sizeof(EventLogWriter::magic_value), reinterpret_cast<const uint8_t *>(log.data() + log.size()), source};
+	if(r.get() != source.size() || !r.ok) {
+		return false;
+	}
+
+	Diff *diff = nullptr;
+	uint64_t range_end = 0;
+	uint32_t old_next = 0, new_next = 0;
+	auto range = [&](uint64_t &begin, uint64_t &end) {
+		begin = range_end + r.get_signed();
+		end = begin + r.get();
+		range_end = end;
+	};
+
+	std::array<DecodedLine, 64> lines;
+	while(r.ok) {
+		if(diff) {
+			auto count = r.decode_lines(lines, old_next, new_next);
+			for(size_t i = 0; i < count; ++i) {
+				diff->add_line(lines[i].old_line, lines[i].new_line, std::move(lines[i].text));
+			}
+			if(count) {
+				continue;
+			}
+		}
+		auto byte = r.byte();
+		auto tag = static_cast<Tag>(byte & ~LINE_FLAGS);
+		auto flags = byte & LINE_FLAGS;
+		if(!r.ok || flags) {
+			break;
+		}
+		if(tag != Tag::Diff && tag != Tag::PatchEnd && !diff) {
+			// a record of a diff outside of one
+			return false;
+		}
+		switch(tag) {
+			case Tag::Diff: {
+				auto old_name = r.get_view();
+				auto new_name = r.get_view();
+				auto code = static_cast<FileOpCode>(r.byte());
+				FileOp op {code, r.get32()};
+				auto flags = r.byte();
+				std::optional<std::vector<BinaryHunk>> binary_sizes;
+				if(flags & INFO_BINARY) {
+					auto count = r.get();
+					// every hunk takes 2 bytes at least
+					if(count > static_cast<uint64_t>(r.end - r.p) / 2) {
+						return false;
+					}
+					auto &sizes = binary_sizes.emplace();
+					sizes.reserve(count);
+					for(uint64_t i = 0; i < count; ++i) {
+						auto type = static_cast<BinaryHunkType>(r.byte());
+						r.ok = r.ok && type <= BinaryHunkType::Delta;
+						sizes.emplace_back(BinaryHunk {type, r.get()});
+					}
+				}
+				std::optional<FileMode> file_mode;
+				if(flags & INFO_FILE_MODE) {
+					auto old = r.get32();
+					file_mode = FileMode {old, r.get32()};
+				}
+				if(!r.ok || code > FileOpCode::None) {
+					return false;
+				}
+				diff = patch.new_diff();
+				diff->set_info(old_name, new_name, op, std::move(binary_sizes), file_mode);
+			} break;
+			case Tag::Header: {
+				auto header = r.get_view();
+				if(!r.ok) {
+					return false;
+				}
+				diff->set_header(header);
+			} break;
+			case Tag::PathIds: {
+				auto old_id = r.get32();
+				auto new_id = r.get32();
+				if(!r.ok) {
+					return false;
+				}
+				diff->set_path_ids(old_id, new_id);
+			} break;
+			case Tag::Hunk:
+				old_next = new_next = 0;
+				diff->new_hunk();
+				break;
+			case Tag::HunkHeader: {
+				NumbersT nums;
+				nums.old_count = r.get32();
+				nums.old_lines = r.get32();
+				nums.new_count = r.get32();
+				nums.new_lines = r.get32();
+				auto section = r.get_view();
+				if(!r.ok) {
+					return false;
+				}
+				old_next = new_next = 0;
+				diff->new_hunk(nums, section);
+			} break;
+			case Tag::NoNewline:
+				diff->no_newline();
+				break;
+			case Tag::SizeHint: {
+				auto hunks = r.get32();
+				auto lines = r.get();
+				if(!r.ok) {
+					return false;
+				}
+				diff->size_hint(hunks, lines);
+			} break;
+			case Tag::HunkRange:
+			case Tag::DiffRange: {
+				uint64_t begin, end;
+				range(begin, end);
+				if(!r.ok) {
+					return false;
+				}
+				if(tag == Tag::HunkRange) {
+					diff->set_hunk_range(begin, end);
+				} else {
+					diff->set_range(begin, end);
+				}
+			} break;
+			case Tag::DiffEnd:
+				diff->close();
+				diff = nullptr;
+				break;
+			case Tag::PatchEnd:
+				patch.close();
+				return r.p == r.end;
+			default:
+				return false;
+		}
+	}
+	return false;
+}
+
+bool check_event_log(std::string_view log, std::string_view source) {
+	NullPatch patch;
+	return replay_event_log(log, source, patch);
+}
+
+};// namespace ParsePatch
@@ -0,0 +1,59 @@
+#include "ParsePatch/Events.hpp"
+
+namespace ParsePatch {
+
+Generator<PatchEvent> patch_events(PatchReader &reader, std::string_view buf) {
+	reader.reset();
+	reader.buf = buf;
+
+	while(auto some_line = reader.next(ScannerUtils::starter, false)) {
+		std::optional<DiffHeader> header;
+		auto err = reader.parse_diff_header(*some_line, header);
+		if(err) {
+			co_yield PatchEvent {.kind = PatchEventKind::Error, .error = err};
+			co_return;
+		}
+		if(!header) {
+			continue;
+		}
+		co_yield PatchEvent {.kind = PatchEventKind::Diff, .header = &*header};
+
+		auto first = header->hunks;
+		// reading hunks of a diff without them would consume the line after it
+		while(header->hunks) {
+			auto nums_some = reader.next_hunk(first);
+			if(!nums_some) {
+				co_yield PatchEvent {.kind = PatchEventKind::Error, .error = nums_some.error()};
+				co_return;
+			}
+			if(!*nums_some) {
+				break;
+			}
+			auto lines_count = **nums_some;
+			co_yield PatchEvent {.kind = PatchEventKind::Hunk, .numbers = lines_count, .section = reader.hunk_section};
+
+			while(auto line_some = reader.next_hunk_line(lines_count)) {
+				co_yield PatchEvent {.kind = PatchEventKind::Line, .line = *line_some};
+				if(reader.next_no_newline()) {
+					co_yield PatchEvent {.kind = PatchEventKind::NoNewline};
+				}
+			}
+		}
+		co_yield PatchEvent {.kind = PatchEventKind::DiffEnd};
+		if(reader.utf8_error) {
+			// an invalid line of the diff, as `parse_diffs` reports it after closing the diff
+			co_yield PatchEvent {.kind = PatchEventKind::Error, .error = reader.utf8_error};
+			co_return;
+		}
+	}
+
+	if(reader.utf8_check == Utf8Check::All) {
+		// the lines after the last diff, and the last line if it has no line end
+		reader.check_utf8(buf.size());
+		if(reader.utf8_error) {
+			co_yield PatchEvent {.kind = PatchEventKind::Error, .error = reader.utf8_error};
+		}
+	}
+}
+
+};// namespace ParsePatch
@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#include "ParsePatch/Hash.hpp"
+
+namespace ParsePatch {
+
+namespace {
+
+constexpr uint64_t P1 = 11400714785074694791ULL;
+constexpr uint64_t P2 = 14029467366897019727ULL;
+constexpr uint64_t P3 = 1609587929392839161ULL;
+constexpr uint64_t P4 = 9650029242287828579ULL;
+constexpr uint64_t P5 = 2870177450012600261ULL;
+
+inline uint64_t read64(const uint8_t *p) {
+	uint64_t v;
+	std::memcpy(&v, p, sizeof(v));
+	if constexpr(std::endian::native == std::endian::big) {
+		v = __builtin_bswap64(v);
+	}
+	return v;
+}
+
+inline uint32_t read32(const uint8_t *p) {
+	uint32_t v;
+	std::memcpy(&v, p, sizeof(v));
+	if constexpr(std::endian::native == std::endian::big) {
+		v = __builtin_bswap32(v);
+	}
+	return v;
+}
+
+inline uint64_t round(uint64_t acc, uint64_t input) {
+	acc += input * P2;
+	acc = std::rotl(acc, 31);
+	return acc * P1;
+}
+
+inline uint64_t merge_round(uint64_t acc, uint64_t val) {
+	acc ^= round(0, val);
+	return acc * P1 + P4;
+}
+
+inline void init_accumulators(uint64_t (&acc)[4], uint64_t seed) {
+	acc[0] = seed + P1 + P2;
+	acc[1] = seed + P2;
+	acc[2] = seed;
+	acc[3] = seed - P1;
+}
+
+inline void consume_stripe(uint64_t (&acc)[4], const uint8_t *p) {
+	acc[0] = round(acc[0], read64(p));
+	acc[1] = round(acc[1], read64(p + 8));
+	acc[2] = round(acc[2], read64(p + 16));
+	acc[3] = round(acc[3], read64(p + 24));
+}
+
+inline uint64_t converge(const uint64_t (&acc)[4]) {
+	uint64_t h = std::rotl(acc[0], 1) + std::rotl(acc[1], 7) + std::rotl(acc[2], 12) + std::rotl(acc[3], 18);
+	h = merge_round(h, acc[0]);
+	h = merge_round(h, acc[1]);
+	h = merge_round(h, acc[2]);
+	return merge_round(h, acc[3]);
+}
+
+/// Mixes in the last < 32 bytes and avalanches
+uint64_t finalize(uint64_t h, const uint8_t *p, size_t len) {
+	for(; len >= 8; p += 8, len -= 8) {
+		h ^= round(0, read64(p));
+		h = std::rotl(h, 27) * P1 + P4;
+	}
+	if(len >= 4) {
+		h ^= static_cast<uint64_t>(read32(p)) * P1;
+		h = std::rotl(h, 23) * P2 + P3;
+		p += 4;
+		len -= 4;
+	}
+	for(; len; ++p, --len) {
+		h ^= (*p) * P5;
+		h = std::rotl(h, 11) * P1;
+	}
+
+	h ^= h >> 33;
+	h *= P2;
+	h ^= h >> 29;
+	h *= P3;
+	h ^= h >> 32;
+	return h;
+}
+
+}// namespace
+
+uint64_t hash64(std::string_view data, uint64_t seed) {
+	auto p = reinterpret_cast<const uint8_t *>(data.data());
+	auto len = data.size();
+
+	uint64_t h;
+	if(len >= 32) {
+		uint64_t acc[4];
+		init_accumulators(acc, seed);
+		auto limit = p + len - 32;
+		do {
+			consume_stripe(acc, p);
+			p += 32;
+		} while(p <= limit);
+		h = converge(acc);
+	} else {
+		h = seed + P5;
+	}
+	h += len;
+
+	return finalize(h, p, data.size() % 32);
+}
+
+Hasher64::Hasher64(uint64_t seed) {
+	reset(seed);
+}
+
+void Hasher64::reset(uint64_t seed) {
+	this->seed = seed;
+	init_accumulators(acc, seed);
+	total = 0;
+	stripe_size = 0;
+}
+
+void Hasher64::update(std::string_view data) {
+	auto p = reinterpret_cast<const uint8_t *>(data.data());
+	auto len = data.size();
+	total += len;
+
+	if(stripe_size + len < sizeof(stripe)) {
+		std::memcpy(stripe + stripe_size, p, len);
+		stripe_size += static_cast<uint32_t>(len);
+		return;
+	}
+
+	if(stripe_size) {
+		auto fill = sizeof(stripe) - stripe_size;
+		std::memcpy(stripe + stripe_size, p, fill);
+		consume_stripe(acc, stripe);
+		p += fill;
+		len -= fill;
+		stripe_size = 0;
+	}
+	for(; len >= sizeof(stripe); p += sizeof(stripe), len -= sizeof(stripe)) {
+		consume_stripe(acc, p);
+	}
+	std::memcpy(stripe, p, len);
+	stripe_size = static_cast<uint32_t>(len);
+}
+
+uint64_t Hasher64::digest() const {
+	uint64_t h;
+	if(total >= sizeof(stripe)) {
+		h = converge(acc);
+	} else {
+		h = seed + P5;
+	}
+	h += total;
+	return finalize(h, stripe, stripe_size);
+}
+
+Sha1::Sha1() {
+	reset();
+}
+
+void Sha1::reset() {
+	state[0] = 0x67452301;
+	state[1] = 0xEFCDAB89;
+	state[2] = 0x98BADCFE;
+	state[3] = 0x10325476;
+	state[4] = 0xC3D2E1F0;
+	total = 0;
+	block_size = 0;
+}
+
+void Sha1::compress(const uint8_t *p) {
+	uint32_t w[80];
+	for(int i = 0; i < 16; ++i) {
+		w[i] = (uint32_t(p[4 * i]) << 24) | (uint32_t(p[4 * i + 1]) << 16) | (uint32_t(p[4 * i + 2]) << 8) | p[4 * i + 3];
+	}
+	for(int i = 16; i < 80; ++i) {
+		w[i] = std::rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+	}
+
+	auto a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+	for(int i = 0; i < 80; ++i) {
+		uint32_t f, k;
+		if(i < 20) {
+			f = (b & c) | (~b & d);
+			k = 0x5A827999;
+		} else if(i < 40) {
+			f = b ^ c ^ d;
+			k = 0x6ED9EBA1;
+		} else if(i < 60) {
+			f = (b & c) | (b & d) | (c & d);
+			k = 0x8F1BBCDC;
+		} else {
+			f = b ^ c ^ d;
+			k = 0xCA62C1D6;
+		}
+		auto t = std::rotl(a, 5) + f + e + k + w[i];
+		e = d;
+		d = c;
+		c = std::rotl(b, 30);
+		b = a;
+		a = t;
+	}
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+}
+
+void Sha1::update(std::string_view data) {
+	auto p = reinterpret_cast<const uint8_t *>(data.data());
+	auto len = data.size();
+	total += len;
+
+	if(block_size) {
+		auto n = std::min<size_t>(len, sizeof(block) - block_size);
+		std::memcpy(block + block_size, p, n);
+		block_size += n;
+		p += n;
+		len -= n;
+		if(block_size < sizeof(block)) {
+			return;
+		}
+		compress(block);
+		block_size = 0;
+	}
+	for(; len >= sizeof(block); p += sizeof(block), len -= sizeof(block)) {
+		compress(p);
+	}
+	std::memcpy(block, p, len);
+	block_size = len;
+}
+
+Sha1::Digest Sha1::digest() {
+	auto bits = total * 8;
+	uint8_t padding[72] = {0x80};
+	// the length goes into the last 8 bytes of a block
+	auto pad = (block_size < 56 ? 56 : 120) - block_size;
+	update(std::string_view(reinterpret_cast<const char *>(padding), pad));
+	uint8_t length[8];
+	for(int i = 0; i < 8; ++i) {
+		length[i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+	}
+	update(std::string_view(reinterpret_cast<const char *>(length), sizeof(length)));
+
+	Digest res;
+	for(int i = 0; i < 5; ++i) {
+		for(int j = 0; j < 4; ++j) {
+			res[4 * i + j] = static_cast<uint8_t>(state[i] >> (24 - 8 * j));
+		}
+	}
+	reset();
+	return res;
+}
+
+};// namespace ParsePatch
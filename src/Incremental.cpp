@@ -0,0 +1,181 @@
+#include <algorithm>
+
+#include "ParsePatch/Incremental.hpp"
+
+namespace ParsePatch {
+
+namespace {
+
+/// Passes a parse to the consumer, keeping the byte ranges of the diffs
+struct SpanRecorder: public Patch {
+	struct RecordingDiff: public Diff {
+		Diff *target = nullptr;
+		std::vector<DiffSpan> *spans = nullptr;
+
+		virtual void set_info(const std::string_view old_name, const std::string_view new_name, FileOp op, std::optional<std::vector<BinaryHunk>> binary_sizes, std::optional<FileMode> file_mode) override {
+			target->set_info(old_name, new_name, op, std::move(binary_sizes), file_mode);
+		}
+
+		virtual void add_line(uint32_t old_line, uint32_t new_line, std::string_view &&line) override {
+			target->add_line(old_line, new_line, std::move(line));
+		}
+
+		virtual void new_hunk() override {
+			target->new_hunk();
+		}
+
+		virtual void new_hunk(const NumbersT &nums, std::string_view section) override {
+			target->new_hunk(nums, section);
+		}
+
+		virtual void no_newline() override {
+			target->no_newline();
+		}
+
+		virtual void size_hint(uint32_t hunks, uint64_t lines) override {
+			target->size_hint(hunks, lines);
+		}
+
+		virtual void set_header(std::string_view header) override {
+			target->set_header(header);
+		}
+
+		virtual void set_path_ids(uint32_t old_id, uint32_t new_id) override {
+			target->set_path_ids(old_id, new_id);
+		}
+
+		virtual void set_hunk_range(uint64_t begin, uint64_t end) override {
+			target->set_hunk_range(begin, end);
+		}
+
+		virtual void set_range(uint64_t begin, uint64_t end) override {
+			// the line numbers are counted afterwards, once for the whole section
+			spans->emplace_back(DiffSpan {begin, end, 0});
+			target->set_range(begin, end);
+		}
+
+		virtual void close() override {
+			target->close();
+		}
+	} diff;
+
+	Patch &target;
+
+	SpanRecorder(Patch &target, std::vector<DiffSpan> &spans): target(target) {
+		diff.spans = &spans;
+	}
+
+	virtual Diff *new_diff() override {
+		diff.target = target.new_diff();
+		return &diff;
+	}
+
+	virtual void close() override {
+	}
+};
+
+uint64_t count_lines(std::string_view buf, uint64_t begin, uint64_t end) {
+	return static_cast<uint64_t>(std::count(buf.data() + begin, buf.data() + end, '\n'));
+}
+
+}// namespace
+
+ParsepatchError IncrementalParser::parse_section(std::string_view buf, uint64_t begin, uint64_t end, uint64_t line, bool diff_follows, Patch &patch, std::vector<DiffSpan> &spans) {
+	// the same as a section of ChunkedPatchReader, the numbers are the ones in the whole buffer
+	reader.reset();
+	reader.buf = buf.substr(begin, end - begin);
+	reader.offset = begin;
+	reader.line = reader.utf8_line = line;
+	reader.diff_follows = diff_follows;
+
+	SpanRecorder recorder(patch, spans);
+	auto err = reader.parse_diffs(recorder);
+	if(err) {
+		return err;
+	}
+	auto from = begin;
+	for(auto &span: spans) {
+		line += count_lines(buf, from, span.begin);
+		span.line = line;
+		from = span.begin;
+	}
+	return {ParsepatchErrorCode::OK, 0};
+}
+
+ParsepatchError IncrementalParser::parse(std::string_view buf, Patch &patch) {
+	diffs.clear();
+	size = buf.size();
+	valid = false;
+	auto err = parse_section(buf, 0, buf.size(), 1, false, patch, diffs);
+	if(err) {
+		return err;
+	}
+	valid = true;
+	patch.close();
+	return {ParsepatchErrorCode::OK, 0};
+}
+
+ParsepatchError IncrementalParser::reparse(std::string_view buf, uint64_t begin, uint64_t removed, uint64_t inserted, Patch &patch, DiffsChange &change) {
+	auto parse_all = [&] {
+		change = {0, diffs.size(), 0, 0, 0};
+		auto err = parse(buf, patch);
+		change.inserted = diffs.size();
+		return err;
+	};
+	if(!valid || begin > size || removed > size - begin || buf.size() != size - removed + inserted) {
+		return parse_all();
+	}
+
+	// the last diff starting before the edit, and the one before it if the edit is on its first line, which it read ahead
+	auto first = static_cast<size_t>(std::upper_bound(std::begin(diffs), std::end(diffs), begin, [](uint64_t pos, const DiffSpan &span) {
+		return pos < span.begin;
+	}) - std::begin(diffs));
+	if(first) {
+		--first;
+		auto eol = buf.find('\n', diffs[first].begin);
+		if(first && (eol == std::string_view::npos || begin <= eol)) {
+			--first;
+		}
+	}
+	// from the first diff the lines before it are unchanged, before it they may have become a diff
+	uint64_t section_begin = first ? diffs[first].begin : 0;
+	uint64_t section_line = first ? diffs[first].line : 1;
+
+	// the first diff after the edit starting with a `diff -` line, in the new buffer
+	int64_t byte_shift = static_cast<int64_t>(inserted) - static_cast<int64_t>(removed);
+	auto stop = first;
+	while(stop < diffs.size() && (diffs[stop].begin <= begin + removed || !buf.substr(diffs[stop].begin + byte_shift).starts_with("diff -"))) {
+		++stop;
+	}
+	bool diff_follows = stop < diffs.size();
+	uint64_t section_end = diff_follows ? diffs[stop].begin + byte_shift : buf.size();
+	if(!diff_follows && section_begin && !buf.substr(section_begin).starts_with("diff -") && buf.find("\ndiff -", section_begin) != std::string_view::npos) {
+		// a `---` line is a diff only without a `diff -` line after it, the diffs before the section are not any more
+		return parse_all();
+	}
+
+	std::vector<DiffSpan> spans;
+	size = buf.size();
+	auto err = parse_section(buf, section_begin, section_end, section_line, diff_follows, patch, spans);
+	if(err) {
+		valid = false;
+		return err;
+	}
+
+	int64_t line_shift = 0;
+	if(diff_follows) {
+		line_shift = static_cast<int64_t>(section_line + count_lines(buf, section_begin, section_end)) - static_cast<int64_t>(diffs[stop].line);
+		for(auto s = stop; s < diffs.size(); ++s) {
+			diffs[s].begin += byte_shift;
+			diffs[s].end += byte_shift;
+			diffs[s].line += line_shift;
+		}
+	}
+	change = {first, stop - first, spans.size(), byte_shift, line_shift};
+	diffs.erase(std::begin(diffs) + first, std::begin(diffs) + stop);
+	diffs.insert(std::begin(diffs) + first, std::begin(spans), std::end(spans));
+	patch.close();
+	return {ParsepatchErrorCode::OK, 0};
+}
+
+};// namespace ParsePatch
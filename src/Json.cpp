@@ -0,0 +1,241 @@
+#include <bit>
+#include <charconv>
+
+#if defined(__SSE2__)
+	#include <emmintrin.h>
+#endif
+
+#include "ParsePatch/Json.hpp"
+#include "ParsePatch/Utf8.hpp"
+
+namespace ParsePatch {
+
+namespace {
+
+/// Escapes valid UTF-8
+void escape_valid(std::string_view text, std::string &out) {
+	auto p = text.data();
+	auto end = p + text.size();
+	while(p != end) {
+		auto plain = p;
+#if defined(__SSE2__)
+		// runs of bytes needing no escape are copied at once, they are found 16 bytes at a time
+		const auto quote = _mm_set1_epi8('"'), backslash = _mm_set1_epi8('\\'), control_max = _mm_set1_epi8(0x1F);
+		for(; end - p >= 16; p += 16) {
+			auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+			// max(v, 0x1F) == 0x1F for bytes below 0x20, compared as unsigned
+			auto control = _mm_cmpeq_epi8(_mm_max_epu8(v, control_max), control_max);
+			auto special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)), control);
+			auto mask = static_cast<unsigned>(_mm_movemask_epi8(special));
+			if(mask) {
+				p += std::countr_zero(mask);
+				break;
+			}
+		}
+#endif
+		for(; p != end; ++p) {
+			auto c = static_cast<unsigned char>(*p);
+			if(c < 0x20 || c == '"' || c == '\\') {
+				break;
+			}
+		}
+		out.append(plain, p);
+		if(p == end) {
+			break;
+		}
+
+		auto c = static_cast<unsigned char>(*p++);
+		out.push_back('\\');
+		switch(c) {
+			case '"':
+			case '\\':
+				out.push_back(static_cast<char>(c));
+				break;
+			case '\n':
+				out.push_back('n');
+				break;
+			case '\r':
+				out.push_back('r');
+				break;
+			case '\t':
+				out.push_back('t');
+				break;
+			case '\b':
+				out.push_back('b');
+				break;
+			case '\f':
+				out.push_back('f');
+				break;
+			default: {
+				const char digits[] = "0123456789abcdef";
+				out.append("u00");
+				out.push_back(digits[c >> 4]);
+				out.push_back(digits[c & 15]);
+			}
+		}
+	}
+}
+
+void append_string(std::string_view text, std::string &out) {
+	out.push_back('"');
+	append_json_escaped(text, out);
+	out.push_back('"');
+}
+
+void append_number(uint32_t number, std::string &out) {
+	char buf[16];
+	out.append(buf, std::to_chars(buf, buf + sizeof(buf), number).ptr);
+}
+
+void append_bool(bool value, std::string &out) {
+	out.append(value ? "true" : "false");
+}
+
+}// namespace
+
+void append_json_escaped(std::string_view text, std::string &out) {
+	while(true) {
+		auto invalid = find_invalid_utf8(text);
+		if(invalid == std::string_view::npos) {
+			escape_valid(text, out);
+			return;
+		}
+		escape_valid(text.substr(0, invalid), out);
+		// as `String::from_utf8_lossy` of Rust, but every invalid byte is replaced
+		out.append("\xEF\xBF\xBD");
+		text.remove_prefix(invalid + 1);
+	}
+}
+
+JsonWriter::JsonWriter(std::string &out): out(out) {
+	diff.writer = this;
+}
+
+void JsonWriter::start() {
+	if(!started) {
+		started = true;
+		first_diff = true;
+		out.append("{\"diffs\":[");
+	}
+}
+
+Diff *JsonWriter::new_diff() {
+	start();
+	if(!first_diff) {
+		out.push_back(',');
+	}
+	first_diff = false;
+	diff.hunk_open = false;
+	diff.first_hunk = true;
+	return &diff;
+}
+
+void JsonWriter::close() {
+	start();
+	out.append("]}");
+	started = false;
+}
+
+void JsonWriter::JsonDiff::set_info(const std::string_view old_name, const std::string_view new_name, FileOp op, std::optional<std::vector<BinaryHunk>> binary_sizes, std::optional<FileMode> file_mode) {
+	auto &out = writer->out;
+	std::optional<std::string_view> renamed_from, copied_from;
+	auto filename = new_name;
+	switch(op.code) {
+		case FileOpCode::New:
+			file_mode = FileMode {0, op.something};
+			break;
+		case FileOpCode::Deleted:
+			filename = old_name;
+			file_mode = FileMode {op.something, 0};
+			break;
+		case FileOpCode::Renamed:
+			renamed_from = old_name;
+			break;
+		case FileOpCode::Copied:
+			copied_from = old_name;
+			break;
+		default:
+			break;
+	}
+	auto optional_string = [&](std::optional<std::string_view> value) {
+		if(value) {
+			append_string(*value, out);
+		} else {
+			out.append("null");
+		}
+	};
+
+	out.append("{\"filename\":");
+	append_string(filename, out);
+	out.append(",\"new\":");
+	append_bool(op.code == FileOpCode::New, out);
+	out.append(",\"deleted\":");
+	append_bool(op.code == FileOpCode::Deleted, out);
+	out.append(",\"binary\":");
+	append_bool(binary_sizes.has_value(), out);
+	out.append(",\"renamed_from\":");
+	optional_string(renamed_from);
+	out.append(",\"copied_from\":");
+	optional_string(copied_from);
+	out.append(",\"file_mode\":");
+	if(file_mode) {
+		out.append("{\"old\":");
+		append_number(file_mode->old, out);
+		out.append(",\"new\":");
+		append_number(file_mode->neo, out);
+		out.push_back('}');
+	} else {
+		out.append("null");
+	}
+	out.append(",\"hunks\":[");
+}
+
+void JsonWriter::JsonDiff::new_hunk() {
+	end_hunk();
+	auto &out = writer->out;
+	if(!first_hunk) {
+		out.push_back(',');
+	}
+	first_hunk = false;
+	hunk_open = first_line = true;
+	out.append("{\"lines\":[");
+}
+
+void JsonWriter::JsonDiff::add_line(uint32_t old_line, uint32_t new_line, std::string_view &&line) {
+	if(old_line && new_line) {
+		// context lines are not written
+		return;
+	}
+	auto &out = writer->out;
+	if(!first_line) {
+		out.push_back(',');
+	}
+	first_line = false;
+	out.append("{\"line\":");
+	append_number(old_line ? old_line : new_line, out);
+	out.append(",\"deleted\":");
+	append_bool(!new_line, out);
+	out.append(",\"data\":");
+	append_string(line, out);
+	out.push_back('}');
+}
+
+void JsonWriter::JsonDiff::end_hunk() {
+	if(hunk_open) {
+		hunk_open = false;
+		writer->out.append("]}");
+	}
+}
+
+void JsonWriter::JsonDiff::close() {
+	end_hunk();
+	writer->out.append("]}");
+}
+
+ParsepatchError patch_to_json(std::string_view buf, std::string &out) {
+	PatchReader reader;
+	JsonWriter writer(out);
+	return reader.by_buf(buf, writer);
+}
+
+};// namespace ParsePatch
@@ -0,0 +1,129 @@
+#include <algorithm>
+
+#include "ParsePatch/LineMap.hpp"
+
+namespace ParsePatch {
+
+namespace {
+
+/// The members of a block describing one side of the file, so that both directions share the code
+struct Side {
+	uint32_t LineMap::Block::*start, LineMap::Block::*count;
+};
+
+constexpr Side old_side {&LineMap::Block::old_start, &LineMap::Block::old_count};
+constexpr Side new_side {&LineMap::Block::new_start, &LineMap::Block::new_count};
+
+/// Maps `line` using the last block starting not after it (`block` may be null if there is none)
+uint32_t map_after(const LineMap::Block *block, uint32_t line, Side from, Side to) {
+	if(!block) {
+		return line;
+	}
+	auto from_end = block->*from.start + block->*from.count;
+	if(line < from_end) {
+		return 0;
+	}
+	return line - from_end + block->*to.start + block->*to.count;
+}
+
+uint32_t map_line(const std::vector<LineMap::Block> &blocks, uint32_t line, Side from, Side to) {
+	if(!line) {
+		return 0;
+	}
+	auto it = std::upper_bound(begin(blocks), end(blocks), line, [&](uint32_t l, const LineMap::Block &b) {
+		return l < b.*from.start;
+	});
+	return map_after(it == begin(blocks) ? nullptr : &*(it - 1), line, from, to);
+}
+
+void map_lines(const std::vector<LineMap::Block> &blocks, std::span<const uint32_t> lines, std::span<uint32_t> out, Side from, Side to) {
+	const LineMap::Block *block = nullptr;
+	auto next = begin(blocks);
+	for(size_t i = 0; i < lines.size(); ++i) {
+		auto line = lines[i];
+		while(next != end(blocks) && (*next).*from.start <= line) {
+			block = &*next++;
+		}
+		out[i] = line ? map_after(block, line, from, to) : 0;
+	}
+}
+
+}// namespace
+
+uint32_t LineMap::map_old_to_new(uint32_t old_line) const {
+	return map_line(blocks, old_line, old_side, new_side);
+}
+
+uint32_t LineMap::map_new_to_old(uint32_t new_line) const {
+	return map_line(blocks, new_line, new_side, old_side);
+}
+
+void LineMap::map_old_to_new(std::span<const uint32_t> old_lines, std::span<uint32_t> out) const {
+	map_lines(blocks, old_lines, out, old_side, new_side);
+}
+
+void LineMap::map_new_to_old(std::span<const uint32_t> new_lines, std::span<uint32_t> out) const {
+	map_lines(blocks, new_lines, out, new_side, old_side);
+}
+
+Diff *LineMapPatch::new_diff() {
+	files.emplace_back();
+	builder.patch = this;
+	builder.open = false;
+	builder.delta = 0;
+	return &builder;
+}
+
+void LineMapPatch::close() {
+}
+
+void LineMapPatch::MapBuilder::set_info(const std::string_view old_name, const std::string_view new_name, FileOp, std::optional<std::vector<BinaryHunk>>, std::optional<FileMode>) {
+	auto &file = patch->files.back();
+	file.old_name = old_name;
+	file.new_name = new_name;
+}
+
+LineMap::Block &LineMapPatch::MapBuilder::open_block(uint32_t old_start, uint32_t new_start) {
+	auto &blocks = patch->files.back().map.blocks;
+	open = true;
+	if(!blocks.empty()) {
+		auto &last = blocks.back();
+		// hunks without context between them continue the same block
+		if(last.old_start + last.old_count == old_start && last.new_start + last.new_count == new_start) {
+			delta -= static_cast<int64_t>(last.new_count) - last.old_count;
+			return last;
+		}
+	}
+	return blocks.emplace_back(LineMap::Block {old_start, 0, new_start, 0});
+}
+
+void LineMapPatch::MapBuilder::close_block() {
+	if(open) {
+		auto &last = patch->files.back().map.blocks.back();
+		delta += static_cast<int64_t>(last.new_count) - last.old_count;
+		open = false;
+	}
+}
+
+void LineMapPatch::MapBuilder::add_line(uint32_t old_line, uint32_t new_line, std::string_view &&) {
+	if(!new_line) {
+		auto &block = open ? patch->files.back().map.blocks.back() : open_block(old_line, static_cast<uint32_t>(old_line + delta));
+		++block.old_count;
+	} else if(!old_line) {
+		// before the first removed or context line of the block its old position is known only from the blocks before
+		auto &block = open ? patch->files.back().map.blocks.back() : open_block(static_cast<uint32_t>(new_line - delta), new_line);
+		++block.new_count;
+	} else {
+		close_block();
+	}
+}
+
+void LineMapPatch::MapBuilder::new_hunk() {
+	close_block();
+}
+
+void LineMapPatch::MapBuilder::close() {
+	close_block();
+}
+
+};// namespace ParsePatch
@@ -0,0 +1,136 @@
+#include <algorithm>
+
+#include "ParsePatch/LineRanges.hpp"
+
+namespace ParsePatch {
+
+void LineRangeSet::append(uint32_t line) {
+	if(ranges.empty() || ranges.back().end < line) {
+		ranges.emplace_back(Range {line, line + 1});
+		return;
+	}
+	if(ranges.back().end == line) {
+		++ranges.back().end;
+		return;
+	}
+	// out of order: find the first run starting after the line and merge with its neighbours
+	auto it = std::upper_bound(begin(ranges), end(ranges), line, [](uint32_t l, const Range &r) {
+		return l < r.begin;
+	});
+	if(it != begin(ranges) && line < (it - 1)->end) {
+		return;
+	}
+	bool joins_prev = it != begin(ranges) && (it - 1)->end == line;
+	bool joins_next = it != end(ranges) && it->begin == line + 1;
+	if(joins_prev && joins_next) {
+		(it - 1)->end = it->end;
+		ranges.erase(it);
+	} else if(joins_prev) {
+		++(it - 1)->end;
+	} else if(joins_next) {
+		--it->begin;
+	} else {
+		ranges.insert(it, Range {line, line + 1});
+	}
+}
+
+uint64_t LineRangeSet::count() const {
+	uint64_t res = 0;
+	for(auto &r: ranges) {
+		res += r.end - r.begin;
+	}
+	return res;
+}
+
+bool LineRangeSet::contains(uint32_t line) const {
+	auto it = std::upper_bound(begin(ranges), end(ranges), line, [](uint32_t l, const Range &r) {
+		return l < r.begin;
+	});
+	return it != begin(ranges) && line < (it - 1)->end;
+}
+
+namespace {
+
+/// Calls `f` with every nonempty intersection of the runs of two sets, in order
+template <typename F>
+void for_each_overlap(const std::vector<LineRangeSet::Range> &a, const std::vector<LineRangeSet::Range> &b, F f) {
+	auto i = begin(a), j = begin(b);
+	while(i != end(a) && j != end(b)) {
+		auto lo = std::max(i->begin, j->begin);
+		auto hi = std::min(i->end, j->end);
+		if(lo < hi) {
+			f(LineRangeSet::Range {lo, hi});
+		}
+		// the run ending first cannot overlap anything else
+		if(i->end < j->end) {
+			++i;
+		} else {
+			++j;
+		}
+	}
+}
+
+}// namespace
+
+LineRangeSet LineRangeSet::intersect(const LineRangeSet &other) const {
+	LineRangeSet res;
+	for_each_overlap(ranges, other.ranges, [&](Range r) {
+		res.ranges.emplace_back(r);
+	});
+	return res;
+}
+
+uint64_t LineRangeSet::count_intersection(const LineRangeSet &other) const {
+	uint64_t res = 0;
+	for_each_overlap(ranges, other.ranges, [&](Range r) {
+		res += r.end - r.begin;
+	});
+	return res;
+}
+
+uint64_t LineRangeSet::count_intersection(std::span<const uint32_t> sorted_lines) const {
+	uint64_t res = 0;
+	auto line = begin(sorted_lines);
+	for(auto &r: ranges) {
+		// the runs are usually few and the lines many: skip to the run with a binary search
+		line = std::lower_bound(line, end(sorted_lines), r.begin);
+		auto last = std::lower_bound(line, end(sorted_lines), r.end);
+		res += last - line;
+		line = last;
+		if(line == end(sorted_lines)) {
+			break;
+		}
+	}
+	return res;
+}
+
+Diff *ChangedLinesPatch::new_diff() {
+	files.emplace_back();
+	collector.patch = this;
+	return &collector;
+}
+
+void ChangedLinesPatch::close() {
+}
+
+void ChangedLinesPatch::RangeCollector::set_info(const std::string_view old_name, const std::string_view new_name, FileOp, std::optional<std::vector<BinaryHunk>>, std::optional<FileMode>) {
+	auto &file = patch->files.back();
+	file.old_name = old_name;
+	file.new_name = new_name;
+}
+
+void ChangedLinesPatch::RangeCollector::add_line(uint32_t old_line, uint32_t new_line, std::string_view &&) {
+	if(!new_line) {
+		patch->files.back().removed.append(old_line);
+	} else if(!old_line) {
+		patch->files.back().added.append(new_line);
+	}
+}
+
+void ChangedLinesPatch::RangeCollector::new_hunk() {
+}
+
+void ChangedLinesPatch::RangeCollector::close() {
+}
+
+};// namespace ParsePatch
@@ -0,0 +1,107 @@
+#include <fstream>
+#include <utility>
+
+#include "ParsePatch/MappedFile.hpp"
+
+#if __has_include(<sys/mman.h>)
+	#include <cerrno>
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+	#define PARSEPATCH_HAVE_MMAP
+#endif
+
+namespace ParsePatch {
+
+MappedFile::MappedFile(MappedFile &&other) noexcept {
+	*this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+	if(this != &other) {
+		unmap();
+		mapped = std::exchange(other.mapped, false);
+		size = std::exchange(other.size, 0);
+		buffer = std::move(other.buffer);
+		data = mapped ? std::exchange(other.data, nullptr) : buffer.data();
+		other.data = nullptr;
+	}
+	return *this;
+}
+
+MappedFile::~MappedFile() {
+	unmap();
+}
+
+void MappedFile::unmap() {
+#ifdef PARSEPATCH_HAVE_MMAP
+	if(mapped) {
+		munmap(const_cast<char *>(data), size);
+	}
+#endif
+	mapped = false;
+	data = nullptr;
+	size = 0;
+	buffer.clear();
+}
+
+std::optional<MappedFile> MappedFile::open(const std::filesystem::path &path) {
+	MappedFile f;
+#ifdef PARSEPATCH_HAVE_MMAP
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if(fd < 0) {
+		return {};
+	}
+	struct stat st;
+	if(fstat(fd, &st)) {
+		::close(fd);
+		return {};
+	}
+	if(!S_ISREG(st.st_mode)) {
+		// pipes, sockets and terminals have no size to map, they are read until their end
+		char chunk[1 << 16];
+		while(true) {
+			auto n = ::read(fd, chunk, sizeof(chunk));
+			if(n < 0 && errno == EINTR) {
+				continue;
+			}
+			if(n < 0) {
+				::close(fd);
+				return {};
+			}
+			if(!n) {
+				break;
+			}
+			f.buffer.append(chunk, static_cast<size_t>(n));
+		}
+		f.data = f.buffer.data();
+		f.size = f.buffer.size();
+	} else if(st.st_size) {
+		auto p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if(p == MAP_FAILED) {
+			::close(fd);
+			return {};
+		}
+		f.data = static_cast<const char *>(p);
+		f.size = static_cast<size_t>(st.st_size);
+		f.mapped = true;
+	}
+	::close(fd);
+#else
+	std::ifstream s(path, std::ios::binary);
+	if(!s) {
+		return {};
+	}
+	f.buffer.assign(std::istreambuf_iterator<char>(s), std::istreambuf_iterator<char>());
+	f.data = f.buffer.data();
+	f.size = f.buffer.size();
+#endif
+	return f;
+}
+
+std::string_view MappedFile::view() const {
+	return {data, size};
+}
+
+};// namespace ParsePatch
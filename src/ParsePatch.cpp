@@ -1,6 +1,9 @@
+#include <algorithm>
 #include <iostream>
 
 #include "ParsePatch.hpp"
+#include "ParsePatch/PathInterner.hpp"
+#include "ParsePatch/Utf8.hpp"
 
 #if __has_include(<magic_enum.hpp>)
 #include <magic_enum.hpp>
@@ -13,6 +16,28 @@ namespace ParsePatch {
 using namespace ScannerUtils;
 
 Diff::~Diff() = default;
+
+void Diff::new_hunk(const NumbersT &, std::string_view) {
+	new_hunk();
+}
+
+void Diff::no_newline() {
+}
+
+void Diff::size_hint(uint32_t, uint64_t) {
+}
+
+void Diff::set_header(std::string_view) {
+}
+
+void Diff::set_path_ids(uint32_t, uint32_t) {
+}
+
+void Diff::set_hunk_range(uint64_t, uint64_t) {
+}
+
+void Diff::set_range(uint64_t, uint64_t) {
+}
 Patch::~Patch() = default;
 
 bool operator==(const BinaryHunk &lhs, const BinaryHunk &rhs) {
@@ -28,7 +53,7 @@ std::ostream &operator<<(std::ostream &s, const FileOp &op) {
 #if defined(NEARGYE_MAGIC_ENUM_HPP)
 	magic_enum::enum_name(op.code)
 #else
-	std::static_cast<uint16_t>(op.code)
+	static_cast<uint16_t>(op.code)
 #endif
 	<< ", " << op.something << ")" << std::endl;
 }
@@ -50,6 +75,12 @@ std::ostream &operator<<(std::ostream &s, const ParsepatchError &err) {
 		case ParsepatchErrorCode::InvalidString: {
 			return s << "Invalid utf-8 at line " << err.line_or_str << std::endl;
 		} break;
+		case ParsepatchErrorCode::InvalidCompressedData: {
+			return s << "Invalid compressed data" << std::endl;
+		} break;
+		case ParsepatchErrorCode::LineTooLong: {
+			return s << "Line longer than the window at line " << err.line_or_str << std::endl;
+		} break;
 	}
 	return s;
 }
@@ -164,8 +195,7 @@ Result<NumbersT> LineReader::parse_numbers() {
 	// \+([0-9]+),?([0-9]+)? @@')
 	auto iter = begin(buf);
 	auto old_start = parse_decimal_number(iter, end(buf));
-	++iter;
-	if(iter == end(buf)) {
+	if(iter == end(buf) || ++iter == end(buf)) {
 		return unexpected<ParsepatchError>({ParsepatchErrorCode::InvalidHunkHeader, this->get_line()});
 	}
 	auto c = *(iter++);
@@ -178,13 +208,15 @@ Result<NumbersT> LineReader::parse_numbers() {
 
 	if(c != '+') {
 		iter = std::find(iter, std::end(buf), '+');
+		if(iter == end(buf)) {
+			return unexpected<ParsepatchError>({ParsepatchErrorCode::InvalidHunkHeader, this->get_line()});
+		}
 		++iter;// C++ addition, difference in behaviour?
 	}
 
 	auto new_start = parse_decimal_number(iter, end(buf));
 
-	++iter;
-	if(iter == end(buf)) {
+	if(iter == end(buf) || ++iter == end(buf)) {
 		return unexpected<ParsepatchError>({ParsepatchErrorCode::InvalidHunkHeader, this->get_line()});
 	}
 
@@ -199,6 +231,21 @@ Result<NumbersT> LineReader::parse_numbers() {
 	return {{old_start, old_lines, new_start, new_lines}};
 }
 
+std::string_view LineReader::hunk_section() const {
+	auto close = this->buf.find("@@", 2);
+	if(close == std::string_view::npos) {
+		return {};
+	}
+	auto section = this->buf.substr(close + 2);
+	if(section.starts_with(' ')) {
+		section.remove_prefix(1);
+	}
+	if(section.ends_with('\r')) {
+		section.remove_suffix(1);
+	}
+	return section;
+}
+
 Result<std::string_view> LineReader::get_filename(std::string_view buf, size_t line) {
 	auto pos1It = std::find_if(begin(buf), end(buf), [&](char c) {
 		return c != ' ';
@@ -222,7 +269,6 @@ Result<std::string_view> LineReader::get_filename(std::string_view buf, size_t l
 	if(buf == "/dev/null") {
 		return "";
 	} else {
-		//return unexpected<ParsepatchError>({ParsepatchErrorCode::InvalidString, line}); // In the case of utf-8 decoding error
 		return buf;
 	}
 }
@@ -311,6 +357,14 @@ void PatchReader::reset() {
 	this->pos = 0;
 	this->line = 1;
 	this->last = {};
+	this->diff_follows = false;
+	this->offset = 0;
+	this->diff_ahead = {};
+	this->utf8_checked = 0;
+	this->utf8_line = 1;
+	this->utf8_error = noParsePatchError;
+	this->errors.clear();
+	this->hunk_section = {};
 }
 
 /// Read a patch from the given buffer
@@ -324,8 +378,33 @@ size_t PatchReader::get_line() const {
 	return line;
 }
 
+size_t PatchReader::consumed() const {
+	return last ? static_cast<size_t>(last->buf.data() - buf.data()) : pos;
+}
+
+size_t PatchReader::hunk_end() const {
+	auto end = consumed();
+	auto rest = buf.substr(end);
+	// the marker after the last line of a hunk is left to be skipped by the search for the next diff
+	if(rest.starts_with("\\ No newline")) {
+		auto eol = rest.find('\n');
+		end += eol == std::string_view::npos ? rest.size() : eol + 1;
+	}
+	return end;
+}
+
 //<Diff D, Patch<D> P>
 ParsepatchError PatchReader::parse(Patch &patch) {
+	auto err = this->parse_diffs(patch);
+	if(err) {
+		return err;
+	}
+	patch.close();
+
+	return noParsePatchError;
+}
+
+ParsepatchError PatchReader::parse_diffs(Patch &patch) {
 	while(true) {
 		auto some_line = this->next(starter, false);
 		if(!some_line) {
@@ -337,12 +416,126 @@ ParsepatchError PatchReader::parse(Patch &patch) {
 			return res;
 		}
 	}
-	patch.close();
 
-	return noParsePatchError;
+	if(utf8_check == Utf8Check::All) {
+		// the lines after the last diff, and the last line if it has no line end
+		auto anchor = this->consumed();
+		auto anchor_line = this->last ? this->last->line : this->line;
+		check_utf8(this->buf.size());
+		if(recover && utf8_error) {
+			record_error(utf8_error, anchor, anchor_line);
+		}
+	}
+	return utf8_error;
 }
 
 ParsepatchError PatchReader::parse_diff(LineReader &diff_line, Patch &patch) {
+	auto begin = static_cast<size_t>(diff_line.buf.data() - this->buf.data());
+	if(recover && utf8_error) {
+		// an invalid line before the diff doesn't make the diff broken
+		record_error(utf8_error, begin, diff_line.line);
+	}
+	std::optional<DiffHeader> header;
+	auto err = this->parse_diff_header(diff_line, header);
+	if(err) {
+		if(recover) {
+			record_error(err, begin, diff_line.line);
+			// the header may have read up to the next diff, the search for it starts again after the first line of this one
+			auto eol = this->buf.find('\n', begin);
+			this->pos = eol == std::string_view::npos ? this->buf.size() : eol + 1;
+			this->line = diff_line.line + 1;
+			this->last = {};
+			return noParsePatchError;
+		}
+		return err;
+	}
+	if(!header) {
+		return noParsePatchError;
+	}
+
+	auto diff = patch.new_diff();
+	diff->set_info(header->old_name, header->new_name, header->op, std::move(header->binary_sizes), header->file_mode);
+	diff->set_header(header->raw);
+	if(interner) {
+		diff->set_path_ids(header->old_id, header->new_id);
+	}
+	auto end = this->consumed();
+	if(header->hunks) {
+		auto parseHunksError = this->parse_hunks(*header->hunks, diff);
+		if(parseHunksError) {
+			if(!recover) {
+				return parseHunksError;
+			}
+			// the diff is closed with what is read, the search for the next one starts after it
+			diff->set_range(offset + begin, offset + this->consumed());
+			diff->close();
+			record_error(parseHunksError, begin, diff_line.line, true);
+			return noParsePatchError;
+		}
+		end = this->hunk_end();
+	}
+	diff->set_range(offset + begin, offset + end);
+	diff->close();
+	if(recover && utf8_error) {
+		record_error(utf8_error, begin, diff_line.line);
+	}
+	return utf8_error;
+}
+
+void PatchReader::record_error(ParsepatchError err, size_t anchor, size_t anchor_line, bool truncated) {
+	// the start of the line of the error, found from a line whose start is known
+	auto target = err.line_or_str;
+	auto pos = anchor;
+	for(auto l = anchor_line; l < target; ++l) {
+		auto eol = this->buf.find('\n', pos);
+		if(eol == std::string_view::npos) {
+			break;
+		}
+		pos = eol + 1;
+	}
+	for(auto l = anchor_line; l > target && pos; --l) {
+		pos = pos < 2 ? 0 : this->buf.rfind('\n', pos - 2) + 1;
+	}
+	errors.emplace_back(RecoveredError {err, offset + pos, truncated});
+	if(err.code == ParsepatchErrorCode::InvalidString) {
+		// the next invalid line is another error
+		utf8_error = noParsePatchError;
+	}
+}
+
+ParsepatchError PatchReader::parse_diff_header(LineReader &diff_line, std::optional<DiffHeader> &header) {
+	auto err = this->read_diff_header(diff_line, header);
+	if(!err && utf8_error) {
+		// an invalid line of the header (or before it)
+		return utf8_error;
+	}
+	if(!err && header && utf8_check != Utf8Check::None) {
+		if(find_invalid_utf8(header->old_name) != std::string_view::npos || find_invalid_utf8(header->new_name) != std::string_view::npos) {
+			return {ParsepatchErrorCode::InvalidString, diff_line.get_line()};
+		}
+	}
+	if(!err && header && interner) {
+		header->old_id = interner->intern(header->old_name);
+		header->new_id = interner->intern(header->new_name);
+	}
+	if(err || !header || header->raw.data()) {
+		return err;
+	}
+
+	// the header ends where the next thing to read starts
+	const char *header_end;
+	if(header->hunks) {
+		header_end = header->hunks->buf.data();
+	} else if(this->last) {
+		header_end = this->last->buf.data();
+	} else {
+		header_end = this->buf.data() + this->pos;
+	}
+	header->raw = std::string_view(diff_line.buf.data(), header_end);
+	return noParsePatchError;
+}
+
+ParsepatchError PatchReader::read_diff_header(LineReader &diff_line, std::optional<DiffHeader> &header) {
 
 	if(tracing) {
 		*tracing << "Diff " << diff_line << std::endl;
@@ -351,20 +544,31 @@ ParsepatchError PatchReader::parse_diff(LineReader &diff_line, Patch &patch) {
 	if(diff_line.is_triple_minus()) {
 		// The diff starts with a ---: need to look ahead for no "diff ..."
 		// to be sure that we aren't in the header.
-		std::string diff = "\ndiff -";
-		auto buf = std::string_view(begin(this->buf) + pos, end(this->buf));
-		auto some_pos = std::search(begin(buf), end(buf), begin(diff), end(diff));
+		// The found position is the answer for every --- line before it, so a run of them doesn't search the rest of the buffer each.
+		if(!diff_ahead || *diff_ahead < pos) {
+			diff_ahead = this->buf.find("\ndiff -", pos);
+			if(*diff_ahead != std::string_view::npos) {
+				diff_ahead_line = this->line + static_cast<size_t>(std::count(begin(this->buf) + pos, begin(this->buf) + *diff_ahead + 1u, '\n'));
+			}
+		}
 
-		if(some_pos != end(buf)) {
-			decltype(this->pos) pos = some_pos - begin(buf);
+		if(*diff_ahead != std::string_view::npos) {
 			// +1 for the '\n'
-			this->pos += pos + 1u;
+			this->pos = *diff_ahead + 1u;
+			this->line = diff_ahead_line;
+			this->last = {};
 			return noParsePatchError;
 		}
-		return this->parse_minus(diff_line, FileOp {FileOpCode::None}, {}, patch);
+		if(diff_follows) {
+			// the "diff -" line is just past the end of the buffer
+			this->pos = this->buf.size();
+			this->last = {};
+			return noParsePatchError;
+		}
+		return this->parse_minus(diff_line, FileOp {FileOpCode::None}, {}, header);
 	}
 
-	auto some_line = this->next(mv, false);
+	auto some_line = this->next_header_line();
 	LineReader line;
 	if(some_line) {
 		line = *some_line;
@@ -380,23 +584,21 @@ ParsepatchError PatchReader::parse_diff(LineReader &diff_line, Patch &patch) {
 			*tracing << "Single diff line: new: " << neo;
 		}
 
-		auto diff = patch.new_diff();
-		diff->set_info(old, neo, FileOp {FileOpCode::None}, {}, {});
-		diff->close();
+		header = DiffHeader {old, neo, FileOp {FileOpCode::None}, {}, {}, {}, {}};
 		return noParsePatchError;
 	}
 
 	std::optional<FileMode> file_mode;
 	if(old_mode(line)) {
 		auto old = line.parse_mode("old mode ");
-		auto some_l = this->next(mv, false);
+		auto some_l = this->next_header_line();
 		if(!some_l) {
 			return ParsepatchError {ParsepatchErrorCode::NewModeExpected, this->get_line()};
 		}
 		auto l = *some_l;
 		auto neo = l.parse_mode("new mode ");
 		auto file_mode_1 = FileMode {old, neo};
-		if(auto some_l = this->next(mv, false)) {
+		if(auto some_l = this->next_header_line()) {
 			line = *some_l;
 			file_mode = file_mode_1;
 		} else {
@@ -411,11 +613,25 @@ ParsepatchError PatchReader::parse_diff(LineReader &diff_line, Patch &patch) {
 				*tracing << "Single diff line (mode change): new: " << neo;
 			}
 
-			auto diff = patch.new_diff();
-			diff->set_info(old, neo, FileOp {FileOpCode::None}, {}, std::optional(file_mode));
-			diff->close();
+			header = DiffHeader {old, neo, FileOp {FileOpCode::None}, {}, std::optional(file_mode_1), {}, {}};
+			return noParsePatchError;
+		}
+	}
+
+	// git writes the similarity of a renamed or copied file before the "rename from"/"copy from" line
+	while(line.buf.starts_with("similarity index ") || line.buf.starts_with("dissimilarity index ")) {
+		auto some_l = this->next_header_line();
+		if(!some_l) {
+			// Nothing more... so close it
+			auto some_oldNew = diff_line.parse_files();
+			if(!some_oldNew) {
+				return some_oldNew.error();
+			}
+			auto [old, neo] = *some_oldNew;
+			header = DiffHeader {old, neo, FileOp {FileOpCode::None}, {}, file_mode, {}, {}};
 			return noParsePatchError;
 		}
+		line = *some_l;
 	}
 
 	auto op = line.get_file_op();
@@ -441,9 +657,7 @@ ParsepatchError PatchReader::parse_diff(LineReader &diff_line, Patch &patch) {
 			*tracing << "Single diff line: old:  " << old << " -- new: " << neo << std::endl;
 		}
 
-		auto diff = patch.new_diff();
-		diff->set_info(old, neo, {FileOpCode::None, 0}, {}, file_mode);
-		diff->close();
+		header = DiffHeader {old, neo, {FileOpCode::None, 0}, {}, file_mode, {}, {}};
 		this->set_last(line);
 		return noParsePatchError;
 	}
@@ -464,7 +678,7 @@ ParsepatchError PatchReader::parse_diff(LineReader &diff_line, Patch &patch) {
 			return some_old.error();
 		}
 		auto old = *some_old;
-		auto someLine = this->next(mv, false);
+		auto someLine = this->next_header_line();
 		if(!someLine) {
 			return ParsepatchError {ParsepatchErrorCode::InvalidHunkHeader, this->get_line()};
 		}
@@ -479,30 +693,29 @@ ParsepatchError PatchReader::parse_diff(LineReader &diff_line, Patch &patch) {
 			*tracing << "Copy/Renamed from " << old << " to " << neo << std::endl;
 		}
 
-		auto diff = patch.new_diff();
-		diff->set_info(old, neo, {FileOpCode::Renamed, 0}, {}, file_mode);
-
-		auto some_line = this->next(mv, false);
+		auto some_line = this->next_header_line();
+		if(some_line && some_line->is_index()) {
+			// git writes the blob ids of a changed file after the "rename to"/"copy to" line
+			some_line = this->next_header_line();
+		}
 		if(some_line) {
 			auto _line = *some_line;
 			if(_line.is_triple_minus()) {
 				// skip +++ line
-				this->next(mv, false);
-				auto line_some = this->next(mv, false);
+				this->next_header_line();
+				auto line_some = this->next_header_line();
 				if(!line_some) {
 					return ParsepatchError {ParsepatchErrorCode::InvalidHunkHeader, this->get_line()};
 				}
-				line = *line_some;
-				auto err = this->parse_hunks(line, diff);
-				if(err) {
-					return err;
-				}
-				diff->close();
+				header = DiffHeader {old, neo, {op.code, 0}, {}, file_mode, line_some, {}};
 			} else {
 				// we just have a rename/copy but no changes in the file
-				diff->close();
+				header = DiffHeader {old, neo, {op.code, 0}, {}, file_mode, {}, {}};
 				this->set_last(_line);
 			}
+		} else {
+			// Nothing more... so close it
+			header = DiffHeader {old, neo, {op.code, 0}, {}, file_mode, {}, {}};
 		}
 	} else {
 		if(op.is_new_or_deleted() || line.is_index()) {
@@ -524,9 +737,12 @@ ParsepatchError PatchReader::parse_diff(LineReader &diff_line, Patch &patch) {
 					*tracing << "Single new/delete diff line: new: " << neo;
 				}
 
-				auto diff = patch.new_diff();
-				diff->set_info(old, neo, op, {}, file_mode);
-				diff->close();
+				if(diff_follows) {
+					// the lines up to the "diff -" line just past the end of the buffer are skipped, as in the whole input
+					this->line += static_cast<size_t>(std::count(begin(this->buf) + this->pos, end(this->buf), '\n'));
+					this->pos = this->buf.size();
+				}
+				header = DiffHeader {old, neo, op, {}, file_mode, {}, {}};
 				return noParsePatchError;
 			}
 			if(tracing) {
@@ -545,11 +761,9 @@ ParsepatchError PatchReader::parse_diff(LineReader &diff_line, Patch &patch) {
 					*tracing << "Binary file (op == " << op << "): " << neo << std::endl;
 				}
 
-				auto diff = patch.new_diff();
-				auto sizes = this->skip_binary();
-
-				diff->set_info(old, neo, op, {sizes}, file_mode);
-				diff->close();
+				// skip_binary reads past the header
+				auto raw = std::string_view(diff_line.buf.data(), line.buf.data());
+				header = DiffHeader {old, neo, op, {this->skip_binary()}, file_mode, {}, raw};
 				return noParsePatchError;
 			} else if(diff(line)) {
 				auto some_neoOld = diff_line.parse_files();
@@ -562,23 +776,21 @@ ParsepatchError PatchReader::parse_diff(LineReader &diff_line, Patch &patch) {
 					*tracing << "Single new/delete diff line: new: " << neo << std::endl;
 				}
 
-				auto diff = patch.new_diff();
-				diff->set_info(old, neo, op, {}, file_mode);
-				diff->close();
+				header = DiffHeader {old, neo, op, {}, file_mode, {}, {}};
 				this->set_last(line);
 				return noParsePatchError;
 			}
 		}
 
 		if(line.is_triple_minus()) {
-			return this->parse_minus(line, op, file_mode, patch);
+			return this->parse_minus(line, op, file_mode, header);
 		}
 	}
 
 	return noParsePatchError;
 }
 
-ParsepatchError PatchReader::parse_minus(LineReader &line, FileOp op, std::optional<FileMode> file_mode, Patch &patch) {
+ParsepatchError PatchReader::parse_minus(LineReader &line, FileOp op, std::optional<FileMode> file_mode, std::optional<DiffHeader> &header) {
 	if(tracing) {
 		*tracing << "DEBUG (---): " << line << std::endl;
 	}
@@ -590,7 +802,7 @@ ParsepatchError PatchReader::parse_minus(LineReader &line, FileOp op, std::optio
 	}
 	auto old = *old_some;
 
-	auto some_line = this->next(mv, false);
+	auto some_line = this->next_header_line();
 	if(!some_line) {
 		return ParsepatchError {ParsepatchErrorCode::InvalidHunkHeader, this->get_line()};
 	}
@@ -613,75 +825,117 @@ ParsepatchError PatchReader::parse_minus(LineReader &line, FileOp op, std::optio
 		*tracing << "Files: old: " << old << " -- new: " << neo << std::endl;
 	}
 
-	auto diff = patch.new_diff();
-	diff->set_info(old, neo, op, {}, file_mode);
-	auto line_some = this->next(mv, false);
-	{
-		if(!line_some) {
-			return ParsepatchError {ParsepatchErrorCode::InvalidHunkHeader, this->get_line()};
-		}
-		auto line = *line_some;
-		auto parseHunksError = this->parse_hunks(line, diff);
-		if(parseHunksError) {
-			return parseHunksError;
-		}
-		diff->close();
-		return noParsePatchError;
+	auto line_some = this->next_header_line();
+	if(!line_some) {
+		return ParsepatchError {ParsepatchErrorCode::InvalidHunkHeader, this->get_line()};
 	}
+	header = DiffHeader {old, neo, op, {}, file_mode, line_some, {}};
+	return noParsePatchError;
 }
 
 ParsepatchError PatchReader::parse_hunks(LineReader &line, Diff *diff) {
-	auto nums_some = line.parse_numbers();
-	if(!nums_some) {
-		return nums_some.error();
-	}
-	auto nums = *nums_some;
-	this->parse_hunk(nums, diff);
-	for(auto line_some = this->next(hunk_at, true); line_some; line_some = this->next(hunk_at, true)) {
-		auto line = *line_some;
-		nums_some = line.parse_numbers();
+	std::optional<LineReader> first {line};
+	while(true) {
+		// the `@@` line is either the first one or the next one to read
+		auto begin = first ? static_cast<size_t>(first->buf.data() - this->buf.data()) : this->consumed();
+		auto nums_some = this->next_hunk(first);
 		if(!nums_some) {
 			return nums_some.error();
 		}
-		auto [o1, o2, n1, n2] = *nums_some;
-		this->parse_hunk(nums, diff);
+		if(!*nums_some) {
+			break;
+		}
+		this->parse_hunk(**nums_some, diff);
+		diff->set_hunk_range(offset + begin, offset + this->hunk_end());
 	}
 
 	return noParsePatchError;
 }
 
 void PatchReader::parse_hunk(NumbersT lines_count, Diff *diff) {
-	diff->new_hunk();
+	diff->new_hunk(lines_count, this->hunk_section);
+	while(auto line_some = this->next_hunk_line(lines_count)) {
+		diff->add_line(line_some->old_line, line_some->new_line, std::move(line_some->line));
+		if(this->next_no_newline()) {
+			diff->no_newline();
+		}
+	}
+}
+
+Result<std::optional<NumbersT>> PatchReader::next_hunk(std::optional<LineReader> &first) {
+	std::optional<LineReader> line_some;
+	std::swap(line_some, first);
+	if(!line_some) {
+		line_some = this->next(hunk_at, true);
+		if(!line_some) {
+			return std::optional<NumbersT> {};
+		}
+	}
+	auto nums_some = line_some->parse_numbers();
+	if(!nums_some) {
+		return unexpected<ParsepatchError>(nums_some.error());
+	}
+	this->hunk_section = line_some->hunk_section();
+	return std::optional<NumbersT> {*nums_some};
+}
+
+std::optional<HunkLine> PatchReader::next_hunk_line(NumbersT &lines_count) {
+	if(lines_count.old_lines == 0 && lines_count.new_lines == 0) {
+		return {};
+	}
 	for(std::optional<LineReader> line_some = this->next(hunk_change, true); line_some; line_some = this->next(hunk_change, true)) {
 		auto line = *line_some;
 		// we know that line is beginning with -, +, ... so no need to check
 		// bounds
+		auto text = std::string_view {begin(line.buf) + 1, end(line.buf)};
 		auto first = line.buf[0];
 		switch(first) {
 			case '-': {
-				diff->add_line(lines_count.old_count, 0, std::string_view {begin(line.buf) + 1, end(line.buf)});
+				HunkLine res {lines_count.old_count, 0, text};
 				lines_count.old_count += 1;
 				lines_count.old_lines -= 1;
-			} break;
+				return res;
+			}
 			case '+': {
-				diff->add_line(0, lines_count.new_count, std::string_view {begin(line.buf) + 1, end(line.buf)});
+				HunkLine res {0, lines_count.new_count, text};
 				lines_count.new_count += 1;
 				lines_count.new_lines -= 1;
-			} break;
+				return res;
+			}
 			case ' ': {
-				diff->add_line(lines_count.old_count, lines_count.new_count, std::string_view(begin(line.buf) + 1, end(line.buf)));
+				HunkLine res {lines_count.old_count, lines_count.new_count, text};
 				lines_count.old_count += 1;
 				lines_count.new_count += 1;
 				lines_count.old_lines -= 1;
 				lines_count.new_lines -= 1;
-			} break;
+				return res;
+			}
 			default: {
+				// "\ No newline at end of file"
 			} break;
 		}
-		if(lines_count.old_lines == 0 && lines_count.new_lines == 0) {
-			break;
-		}
 	}
+	return {};
+}
+
+bool PatchReader::next_no_newline() {
+	if(!this->buf.substr(this->consumed()).starts_with("\\ No newline")) {
+		return false;
+	}
+	// without a line end the marker is the end of the buffer, `hunk_end` goes past it
+	this->next(mv, false);
+	return true;
+}
+
+std::optional<LineReader> PatchReader::next_header_line() {
+	auto line = this->next(mv, false);
+	if(line && diff(*line)) {
+		// as at the end of a section cut before the line (see `diff_follows`)
+		this->pos = static_cast<size_t>(line->buf.data() - this->buf.data());
+		this->line = line->line;
+		return {};
+	}
+	return line;
 }
 
 void PatchReader::set_last(LineReader line) {
@@ -697,40 +951,57 @@ std::optional<LineReader> PatchReader::next(NextFilterF filter, bool return_on_f
 			return {line};
 		} else {
 			if(return_on_false) {
+				// still the next line to read
+				this->last = l;
 				return {};
 			}
 		}
 	}
 
-	auto pos = this->pos;
-	auto buf = std::string_view(begin(this->buf) + pos, end(this->buf));
-	if(end(buf) <= end(this->buf) && begin(buf) < end(buf)) {
-		size_t n = 0;
-		for(auto c: buf) {
-			if(c == '\n') {
-				auto npos = this->pos + n;
-				if(npos > 0) {
-					auto &prev = this->buf[npos - 1];
-					if(prev == '\r') {
-						npos -= 1;
-					}
-				}
-				auto line = LineReader {
-					.buf = std::string_view {begin(this->buf) + pos, begin(this->buf) + npos},
-					.line = this->line,
-				};
-				this->line += 1;
-				if(filter(line)) {
-					this->pos += n + 1;
-					return {line};
-				} else if(return_on_false) {
-					return {};
-				}
-				pos = this->pos + n + 1;
+	auto line_before = this->line;
+	for(size_t pos = this->pos; pos < this->buf.size();) {
+		size_t eol;
+		if(utf8_check == Utf8Check::All && pos >= utf8_checked) {
+			// a line not checked yet is checked while its end is searched for
+			check_utf8(pos);
+			size_t invalid;
+			eol = find_eol_utf8(this->buf, pos, invalid);
+			if(eol == std::string_view::npos) {
+				break;
 			}
-			++n;
+			if(invalid != std::string_view::npos && !utf8_error) {
+				utf8_error = {ParsepatchErrorCode::InvalidString, this->line};
+			}
+			utf8_checked = eol + 1;
+			utf8_line = this->line + 1;
+		} else {
+			eol = this->buf.find('\n', pos);
+		}
+		if(eol == std::string_view::npos) {
+			break;
 		}
+		auto npos = eol;
+		if(npos > pos && this->buf[npos - 1] == '\r') {
+			npos -= 1;
+		}
+		auto line = LineReader {
+			.buf = std::string_view {begin(this->buf) + pos, begin(this->buf) + npos},
+			.line = this->line,
+		};
+		this->line += 1;
+		if(filter(line)) {
+			this->pos = eol + 1;
+			return {line};
+		} else if(return_on_false) {
+			// the line is kept read ahead, so it is neither scanned nor counted again
+			this->pos = eol + 1;
+			this->set_last(line);
+			return {};
+		}
+		pos = eol + 1;
 	}
+	// nothing matches: the lines are left unconsumed
+	this->line = line_before;
 	return {};
 }
 
@@ -748,6 +1019,11 @@ void PatchReader::skip_until_empty_line() {
 				} else {
 					spos = n + 1;
 				}
+				if(buf.substr(spos).starts_with("diff -")) {
+					// the next diff cuts a block without its empty line
+					this->pos += spos;
+					return;
+				}
 			}
 			++n;
 		}
@@ -755,6 +1031,18 @@ void PatchReader::skip_until_empty_line() {
 	this->pos = this->buf.size();
 }
 
+void PatchReader::check_utf8(size_t until) {
+	while(utf8_checked < until) {
+		size_t invalid;
+		auto eol = find_eol_utf8(this->buf, utf8_checked, invalid);
+		if(invalid != std::string_view::npos && !utf8_error) {
+			utf8_error = {ParsepatchErrorCode::InvalidString, utf8_line};
+		}
+		utf8_checked = eol == std::string_view::npos ? this->buf.size() : eol + 1;
+		++utf8_line;
+	}
+}
+
 namespace ScannerUtils {
 size_t parse_usize(const std::string_view buf) {
 	uint32_t res = 0;
@@ -0,0 +1,191 @@
+#include <cstring>
+
+#if defined(__SSE2__)
+	#include <emmintrin.h>
+#endif
+
+#include "ParsePatch/PatchId.hpp"
+
+namespace ParsePatch {
+
+namespace {
+
+constexpr bool is_space(char c) {
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+}// namespace
+
+void strip_spaces(std::string_view line, std::string &out) {
+	auto p = line.data();
+	auto end = p + line.size();
+	auto old_size = out.size();
+	out.resize(old_size + line.size());
+	auto dst = out.data() + old_size;
+
+#if defined(__SSE2__)
+	const auto space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t'), nl = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r');
+	for(; end - p >= 16; p += 16) {
+		auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+		auto spaces = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)), _mm_or_si128(_mm_cmpeq_epi8(v, nl), _mm_cmpeq_epi8(v, cr)));
+		auto mask = static_cast<unsigned>(_mm_movemask_epi8(spaces));
+		if(!mask) {
+			// code is mostly long runs of non-space bytes
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst), v);
+			dst += 16;
+			continue;
+		}
+		for(int i = 0; i < 16; ++i) {
+			*dst = p[i];
+			dst += !(mask >> i & 1);
+		}
+	}
+#endif
+	for(; p != end; ++p) {
+		*dst = *p;
+		dst += !is_space(*p);
+	}
+	out.resize(dst - out.data());
+}
+
+PatchIdPatch::PatchIdPatch(bool stable): stable(stable) {
+}
+
+void PatchIdPatch::reset() {
+	files.clear();
+	id = {};
+	sha.reset();
+	pre_oid.clear();
+	post_oid.clear();
+	flush_on_diff = skip_diff_line = false;
+}
+
+std::string PatchIdPatch::hex() const {
+	const char digits[] = "0123456789abcdef";
+	std::string res;
+	for(auto b: id) {
+		res += digits[b >> 4];
+		res += digits[b & 15];
+	}
+	return res;
+}
+
+void PatchIdPatch::hash(std::string_view normalized) {
+	sha.update(normalized);
+	diff_hasher.update(normalized);
+}
+
+/// Adds the hash of the lines since the previous flush to the id, as a 160-bit number
+void PatchIdPatch::flush() {
+	auto digest = sha.digest();
+	unsigned carry = 0;
+	for(size_t i = 0; i < id.size(); ++i) {
+		carry += id[i] + digest[i];
+		id[i] = static_cast<uint8_t>(carry);
+		carry >>= 8;
+	}
+}
+
+Diff *PatchIdPatch::new_diff() {
+	files.emplace_back();
+	diff_hasher.reset();
+	collector.patch = this;
+	collector.binary = collector.has_hunks = false;
+	return &collector;
+}
+
+void PatchIdPatch::close() {
+	flush();
+}
+
+void PatchIdPatch::IdCollector::set_info(const std::string_view old_name, const std::string_view new_name, FileOp, std::optional<std::vector<BinaryHunk>> binary_sizes, std::optional<FileMode>) {
+	auto &file = patch->files.back();
+	file.old_name = old_name;
+	file.new_name = new_name;
+	binary = binary_sizes.has_value();
+}
+
+void PatchIdPatch::IdCollector::set_header(std::string_view header) {
+	// the same rules as in git's patch-id.c
+	bool first = true, binary_line = false;
+	while(!header.empty() && !binary_line) {
+		auto eol = header.find('\n');
+		auto line = header.substr(0, eol);
+		header.remove_prefix(eol == std::string_view::npos ? header.size() : eol + 1);
+
+		if(first && line.starts_with("diff ")) {
+			if(patch->skip_diff_line) {
+				// after a binary diff git skips everything up to and including the next "diff" line
+				patch->skip_diff_line = false;
+				continue;
+			}
+			if(patch->flush_on_diff && patch->stable) {
+				patch->flush();
+			}
+		}
+		first = false;
+
+		if(line.starts_with("\\ ")) {
+			continue;
+		}
+		if(line.starts_with("GIT binary patch") || line.starts_with("Binary files")) {
+			binary_line = true;
+		} else if(line.starts_with("index ")) {
+			auto oids = line.substr(sizeof("index ") - 1);
+			auto dots = oids.find("..");
+			if(dots != std::string_view::npos) {
+				patch->pre_oid = oids.substr(0, dots);
+				auto post = oids.substr(dots + 2);
+				patch->post_oid = post.substr(0, post.find(' '));
+			}
+		} else {
+			patch->normalized.clear();
+			strip_spaces(line, patch->normalized);
+			patch->hash(patch->normalized);
+		}
+	}
+
+	if(binary || binary_line) {
+		binary = true;
+		patch->hash(patch->pre_oid);
+		patch->hash(patch->post_oid);
+		if(patch->stable) {
+			patch->flush();
+		}
+	}
+}
+
+void PatchIdPatch::IdCollector::add_line(uint32_t old_line, uint32_t new_line, std::string_view &&line) {
+	auto &normalized = patch->normalized;
+	normalized.clear();
+	// a context line starts with a space, which is stripped
+	if(!new_line) {
+		normalized += '-';
+	} else if(!old_line) {
+		normalized += '+';
+	}
+	strip_spaces(line, normalized);
+	patch->hash(normalized);
+	patch->hunk_hasher.update(normalized);
+}
+
+void PatchIdPatch::IdCollector::end_hunk() {
+	if(has_hunks) {
+		patch->files.back().hunk_hashes.emplace_back(patch->hunk_hasher.digest());
+	}
+	patch->hunk_hasher.reset();
+}
+
+void PatchIdPatch::IdCollector::new_hunk() {
+	end_hunk();
+	has_hunks = true;
+}
+
+void PatchIdPatch::IdCollector::close() {
+	end_hunk();
+	patch->files.back().hash = patch->diff_hasher.digest();
+	patch->flush_on_diff = has_hunks && !binary;
+	patch->skip_diff_line = binary;
+}
+
+};// namespace ParsePatch
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include "ParsePatch/Hash.hpp"
+#include "ParsePatch/PathInterner.hpp"
+
+namespace ParsePatch {
+
+namespace {
+
+constexpr size_t arena_block_size = 1 << 16;
+constexpr size_t initial_slots = 64;
+
+}// namespace
+
+struct PathInterner::Shard {
+	/// An entry of the open-addressed table, `id` 0 is an empty one
+	struct Slot {
+		std::string_view path;
+		/// The high half of the hash of `path`, it gives the position in the table
+		uint32_t tag = 0;
+		uint32_t id = 0;
+	};
+
+	mutable std::shared_mutex mutex;
+	std::vector<Slot> slots = std::vector<Slot>(initial_slots);
+	size_t used = 0;
+	/// The paths are copied into blocks which are never freed nor moved
+	std::vector<std::unique_ptr<char[]>> blocks;
+	char *free_begin = nullptr, *free_end = nullptr;
+
+	/// The id of `path` with `tag`, 0 if it isn't in the table
+	uint32_t lookup(std::string_view path, uint32_t tag) const {
+		auto mask = slots.size() - 1;
+		for(auto i = tag & mask;; i = (i + 1) & mask) {
+			auto &slot = slots[i];
+			if(!slot.id) {
+				return 0;
+			}
+			if(slot.tag == tag && slot.path == path) {
+				return slot.id;
+			}
+		}
+	}
+
+	void place(const Slot &entry) {
+		auto mask = slots.size() - 1;
+		auto i = entry.tag & mask;
+		while(slots[i].id) {
+			i = (i + 1) & mask;
+		}
+		slots[i] = entry;
+	}
+
+	void grow() {
+		auto old = std::move(slots);
+		slots = std::vector<Slot>(old.size() * 2);
+		for(auto &slot: old) {
+			if(slot.id) {
+				place(slot);
+			}
+		}
+	}
+
+	std::string_view copy(std::string_view path) {
+		if(static_cast<size_t>(free_end - free_begin) < path.size()) {
+			// a path longer than a block gets a block of its own, the rest of the current one is kept
+			auto size = std::max(arena_block_size, path.size());
+			blocks.emplace_back(std::make_unique<char[]>(size));
+			if(size > arena_block_size) {
+				std::memcpy(blocks.back().get(), path.data(), path.size());
+				return {blocks.back().get(), path.size()};
+			}
+			free_begin = blocks.back().get();
+			free_end = free_begin + size;
+		}
+		std::memcpy(free_begin, path.data(), path.size());
+		std::string_view copied(free_begin, path.size());
+		free_begin += path.size();
+		return copied;
+	}
+};
+
+PathInterner::PathInterner(): shards(std::make_unique<Shard[]>(size_t(1) << shard_bits)) {
+}
+
+PathInterner::~PathInterner() {
+	for(auto &segment: segments) {
+		delete[] segment.load(std::memory_order_relaxed);
+	}
+}
+
+std::string_view &PathInterner::slot_of(uint32_t id) const {
+	auto k = std::bit_width(id) - 1;
+	return segments[k].load(std::memory_order_acquire)[id - (uint32_t(1) << k)];
+}
+
+uint32_t PathInterner::intern(std::string_view path) {
+	if(path.empty()) {
+		return no_path;
+	}
+	auto hash = hash64(path);
+	auto &shard = shards[hash & ((size_t(1) << shard_bits) - 1)];
+	auto tag = static_cast<uint32_t>(hash >> 32);
+	{
+		std::shared_lock lock(shard.mutex);
+		if(auto id = shard.lookup(path, tag)) {
+			return id;
+		}
+	}
+
+	std::unique_lock lock(shard.mutex);
+	// another thread may have added it between the locks
+	if(auto id = shard.lookup(path, tag)) {
+		return id;
+	}
+	auto id = next_id.fetch_add(1, std::memory_order_relaxed);
+	auto &segment = segments[std::bit_width(id) - 1];
+	if(!segment.load(std::memory_order_acquire)) {
+		// the ids of the segment may be given in several shards at once, one allocation wins
+		auto size = size_t(1) << (std::bit_width(id) - 1);
+		auto fresh = new std::string_view[size];
+		std::string_view *expected = nullptr;
+		if(!segment.compare_exchange_strong(expected, fresh, std::memory_order_acq_rel)) {
+			delete[] fresh;
+		}
+	}
+	auto copied = shard.copy(path);
+	slot_of(id) = copied;
+
+	// the load factor is kept under 3/4
+	if((shard.used + 1) * 4 > shard.slots.size() * 3) {
+		shard.grow();
+	}
+	shard.place({copied, tag, id});
+	++shard.used;
+	return id;
+}
+
+std::optional<uint32_t> PathInterner::find(std::string_view path) const {
+	if(path.empty()) {
+		return no_path;
+	}
+	auto hash = hash64(path);
+	auto &shard = shards[hash & ((size_t(1) << shard_bits) - 1)];
+	std::shared_lock lock(shard.mutex);
+	if(auto id = shard.lookup(path, static_cast<uint32_t>(hash >> 32))) {
+		return id;
+	}
+	return {};
+}
+
+std::string_view PathInterner::path(uint32_t id) const {
+	if(id == no_path) {
+		return {};
+	}
+	return slot_of(id);
+}
+
+size_t PathInterner::size() const {
+	return next_id.load(std::memory_order_relaxed);
+}
+
+};// namespace ParsePatch
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "ParsePatch/Pool.hpp"
+
+namespace ParsePatch {
+
+PatchFactory::~PatchFactory() = default;
+
+void PatchFactory::finished(size_t, size_t, Patch *, ParsepatchError) {
+}
+
+ParseManyStats::Worker &ParseManyStats::Worker::operator+=(const Worker &other) {
+	inputs += other.inputs;
+	bytes += other.bytes;
+	lines += other.lines;
+	errors += other.errors;
+	steals += other.steals;
+	busy += other.busy;
+	return *this;
+}
+
+namespace {
+
+/// [head, tail) of the input indices owned by a worker: head in the low half, tail in the high one
+struct alignas(64) Range {
+	std::atomic<uint64_t> packed {0};
+
+	static constexpr uint64_t pack(uint32_t head, uint32_t tail) {
+		return (static_cast<uint64_t>(tail) << 32) | head;
+	}
+
+	static constexpr uint32_t head(uint64_t r) {
+		return static_cast<uint32_t>(r);
+	}
+
+	static constexpr uint32_t tail(uint64_t r) {
+		return static_cast<uint32_t>(r >> 32);
+	}
+};
+
+struct Pool {
+	std::span<const std::string_view> inputs;
+	PatchFactory &factory;
+	std::unique_ptr<Range[]> ranges;
+	size_t threads;
+	PathInterner *interner;
+
+	/// Takes the first index of the own range
+	bool take(size_t worker, uint32_t &index) {
+		auto &range = ranges[worker].packed;
+		auto r = range.load(std::memory_order_relaxed);
+		while(Range::head(r) < Range::tail(r)) {
+			if(range.compare_exchange_weak(r, Range::pack(Range::head(r) + 1, Range::tail(r)), std::memory_order_acq_rel, std::memory_order_relaxed)) {
+				index = Range::head(r);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/// Moves the back half of the range of another worker into the own (empty) range and takes its first index
+	bool steal(size_t worker, uint32_t &index) {
+		for(size_t i = 1; i < threads; ++i) {
+			auto &victim = ranges[(worker + i) % threads].packed;
+			auto r = victim.load(std::memory_order_relaxed);
+			while(Range::head(r) < Range::tail(r)) {
+				auto count = Range::tail(r) - Range::head(r);
+				auto from = Range::tail(r) - (count + 1) / 2;
+				if(victim.compare_exchange_weak(r, Range::pack(Range::head(r), from), std::memory_order_acq_rel, std::memory_order_relaxed)) {
+					// nobody steals from an empty range, so the own one can be stored directly
+					ranges[worker].packed.store(Range::pack(from + 1, Range::tail(r)), std::memory_order_release);
+					index = from;
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	void run(size_t worker, ParseManyStats::Worker &result) {
+		// counted locally, the results of the workers share cache lines
+		ParseManyStats::Worker stats;
+		PatchReader reader {};
+		reader.interner = interner;
+		uint32_t index;
+		while(true) {
+			if(!take(worker, index)) {
+				if(!steal(worker, index)) {
+					// the other workers finish what they hold
+					result = stats;
+					return;
+				}
+				++stats.steals;
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			auto input = inputs[index];
+			auto patch = factory.patch_for(index, worker);
+			auto err = reader.by_buf(input, *patch);
+			factory.finished(index, worker, patch, err);
+			stats.busy += std::chrono::steady_clock::now() - start;
+
+			++stats.inputs;
+			stats.bytes += input.size();
+			stats.lines += reader.get_line() - 1;
+			if(err) {
+				++stats.errors;
+			}
+		}
+	}
+};
+
+}// namespace
+
+ParseManyStats parse_many(std::span<const std::string_view> inputs, PatchFactory &factory, size_t threads, PathInterner *interner) {
+	auto start = std::chrono::steady_clock::now();
+	if(!threads) {
+		threads = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	// ranges hold 32-bit indices
+	uint64_t skipped = inputs.size() - std::min<size_t>(inputs.size(), UINT32_MAX);
+	inputs = inputs.first(inputs.size() - skipped);
+	threads = std::clamp<size_t>(threads, 1, std::max<size_t>(inputs.size(), 1));
+
+	Pool pool {inputs, factory, std::make_unique<Range[]>(threads), threads, interner};
+	// initially the inputs are split evenly
+	for(size_t i = 0; i < threads; ++i) {
+		pool.ranges[i].packed.store(Range::pack(static_cast<uint32_t>(inputs.size() * i / threads), static_cast<uint32_t>(inputs.size() * (i + 1) / threads)), std::memory_order_relaxed);
+	}
+
+	ParseManyStats stats;
+	stats.skipped = skipped;
+	stats.workers.resize(threads);
+	{
+		std::vector<std::jthread> workers;
+		workers.reserve(threads - 1);
+		for(size_t i = 1; i < threads; ++i) {
+			workers.emplace_back([&pool, &stats, i] {
+				pool.run(i, stats.workers[i]);
+			});
+		}
+		pool.run(0, stats.workers[0]);
+	}
+
+	for(auto &w: stats.workers) {
+		stats.total += w;
+	}
+	stats.wall = std::chrono::steady_clock::now() - start;
+	return stats;
+}
+
+};// namespace ParsePatch
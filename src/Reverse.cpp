@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <utility>
+
+#include "ParsePatch/Reverse.hpp"
+
+namespace ParsePatch {
+
+void reverse(FileOp &op) {
+	switch(op.code) {
+		case FileOpCode::New:
+			op.code = FileOpCode::Deleted;
+			break;
+		case FileOpCode::Deleted:
+			op.code = FileOpCode::New;
+			break;
+		default:
+			// a rename back is a rename with the names swapped; undoing a copy would delete the copy, but the hunks of a copy are relative to the source, so it is kept a copy in the other direction
+			break;
+	}
+}
+
+void reverse(FileMode &mode) {
+	std::swap(mode.old, mode.neo);
+}
+
+void reverse(NumbersT &numbers) {
+	std::swap(numbers.old_count, numbers.new_count);
+	std::swap(numbers.old_lines, numbers.new_lines);
+}
+
+void reverse(HunkLine &line) {
+	std::swap(line.old_line, line.new_line);
+}
+
+namespace {
+
+/// `GIT binary patch` has the forward hunk followed by the reverse one
+void reverse(std::optional<std::vector<BinaryHunk>> &binary_sizes) {
+	if(binary_sizes) {
+		std::reverse(begin(*binary_sizes), end(*binary_sizes));
+	}
+}
+
+}// namespace
+
+void reverse(DiffHeader &header) {
+	std::swap(header.old_name, header.new_name);
+	reverse(header.op);
+	reverse(header.binary_sizes);
+	if(header.file_mode) {
+		reverse(*header.file_mode);
+	}
+	header.raw = {};
+}
+
+ReversePatch::ReversePatch(Patch &target): target(target) {
+}
+
+Diff *ReversePatch::new_diff() {
+	diff.target = target.new_diff();
+	return &diff;
+}
+
+void ReversePatch::close() {
+	target.close();
+}
+
+void ReversePatch::ReverseDiff::set_info(const std::string_view old_name, const std::string_view new_name, FileOp op, std::optional<std::vector<BinaryHunk>> binary_sizes, std::optional<FileMode> file_mode) {
+	reverse(op);
+	reverse(binary_sizes);
+	if(file_mode) {
+		reverse(*file_mode);
+	}
+	target->set_info(new_name, old_name, op, std::move(binary_sizes), file_mode);
+}
+
+void ReversePatch::ReverseDiff::add_line(uint32_t old_line, uint32_t new_line, std::string_view &&line) {
+	target->add_line(new_line, old_line, std::move(line));
+}
+
+void ReversePatch::ReverseDiff::new_hunk() {
+	target->new_hunk();
+}
+
+void ReversePatch::ReverseDiff::new_hunk(const NumbersT &nums, std::string_view section) {
+	auto reversed = nums;
+	reverse(reversed);
+	target->new_hunk(reversed, section);
+}
+
+void ReversePatch::ReverseDiff::no_newline() {
+	target->no_newline();
+}
+
+void ReversePatch::ReverseDiff::size_hint(uint32_t hunks, uint64_t lines) {
+	target->size_hint(hunks, lines);
+}
+
+void ReversePatch::ReverseDiff::set_path_ids(uint32_t old_id, uint32_t new_id) {
+	target->set_path_ids(new_id, old_id);
+}
+
+void ReversePatch::ReverseDiff::set_hunk_range(uint64_t begin, uint64_t end) {
+	target->set_hunk_range(begin, end);
+}
+
+void ReversePatch::ReverseDiff::set_range(uint64_t begin, uint64_t end) {
+	target->set_range(begin, end);
+}
+
+void ReversePatch::ReverseDiff::close() {
+	target->close();
+}
+
+};// namespace ParsePatch
@@ -0,0 +1,200 @@
+#include <bit>
+#include <deque>
+
+#if defined(__SSE2__)
+	#include <emmintrin.h>
+#endif
+
+#include "ParsePatch/Search.hpp"
+
+namespace ParsePatch {
+
+namespace {
+
+constexpr uint32_t no_state = UINT32_MAX;
+
+}// namespace
+
+LiteralSearcher::LiteralSearcher(std::span<const std::string_view> patterns) {
+	// the bytes of the patterns get classes from 1, all the others share 0
+	for(auto pattern: patterns) {
+		for(auto c: pattern) {
+			auto &cls = classes[static_cast<uint8_t>(c)];
+			if(!cls) {
+				cls = static_cast<uint16_t>(class_count++);
+			}
+		}
+	}
+	auto C = class_count;
+
+	// the trie, with the own patterns of every state
+	transitions.assign(C, no_state);
+	std::vector<std::vector<uint32_t>> own(1);
+	sizes.reserve(patterns.size());
+	for(auto pattern: patterns) {
+		auto index = static_cast<uint32_t>(sizes.size());
+		sizes.emplace_back(static_cast<uint32_t>(pattern.size()));
+		if(pattern.empty()) {
+			continue;
+		}
+		uint32_t state = 0;
+		for(auto c: pattern) {
+			auto edge = state * C + classes[static_cast<uint8_t>(c)];
+			if(transitions[edge] == no_state) {
+				transitions[edge] = static_cast<uint32_t>(own.size());
+				own.emplace_back();
+				transitions.resize(transitions.size() + C, no_state);
+			}
+			state = transitions[edge];
+		}
+		own[state].emplace_back(index);
+		if(!starts[static_cast<uint8_t>(pattern[0])]) {
+			starts[static_cast<uint8_t>(pattern[0])] = true;
+			if(start_count < max_start_bytes) {
+				start_bytes[start_count] = static_cast<uint8_t>(pattern[0]);
+			}
+			++start_count;
+		}
+	}
+
+	// breadth first, the failure of a state is shallower so it is complete when the state is reached
+	std::vector<uint32_t> fail(own.size(), 0);
+	std::deque<uint32_t> queue;
+	for(uint32_t c = 0; c < C; ++c) {
+		auto &next = transitions[c];
+		if(next == no_state) {
+			next = 0;
+		} else {
+			queue.emplace_back(next);
+		}
+	}
+	while(!queue.empty()) {
+		auto state = queue.front();
+		queue.pop_front();
+		for(uint32_t c = 0; c < C; ++c) {
+			auto &next = transitions[state * C + c];
+			auto fallback = transitions[fail[state] * C + c];
+			if(next == no_state) {
+				next = fallback;
+				continue;
+			}
+			fail[next] = fallback;
+			// the patterns ending in the failure end here too
+			own[next].insert(end(own[next]), begin(own[fallback]), end(own[fallback]));
+			queue.emplace_back(next);
+		}
+	}
+
+	output_begin.reserve(own.size() + 1);
+	for(auto &patterns_of: own) {
+		output_begin.emplace_back(static_cast<uint32_t>(outputs.size()));
+		outputs.insert(end(outputs), begin(patterns_of), end(patterns_of));
+	}
+	output_begin.emplace_back(static_cast<uint32_t>(outputs.size()));
+	// the states are stored multiplied by the number of classes, it saves a multiplication per byte
+	for(auto &next: transitions) {
+		next = next * C | (own[next].empty() ? 0 : match_bit);
+	}
+}
+
+uint32_t LiteralSearcher::pattern_size(uint32_t pattern) const {
+	return sizes[pattern];
+}
+
+size_t LiteralSearcher::skip(const char *text, size_t pos, size_t size) const {
+	if(!start_count) {
+		return size;
+	}
+#if defined(__SSE2__)
+	if(start_count <= max_start_bytes) {
+		__m128i wanted[max_start_bytes];
+		for(uint32_t i = 0; i < max_start_bytes; ++i) {
+			// the unused ones repeat the first byte
+			wanted[i] = _mm_set1_epi8(static_cast<char>(start_bytes[i < start_count ? i : 0]));
+		}
+		for(; pos + 16 <= size; pos += 16) {
+			auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + pos));
+			auto found = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, wanted[0]), _mm_cmpeq_epi8(block, wanted[1])), _mm_cmpeq_epi8(block, wanted[2]));
+			if(auto mask = static_cast<uint32_t>(_mm_movemask_epi8(found))) {
+				return pos + std::countr_zero(mask);
+			}
+		}
+	}
+#endif
+	while(pos < size && !starts[static_cast<uint8_t>(text[pos])]) {
+		++pos;
+	}
+	return pos;
+}
+
+void LiteralSearcher::find(std::string_view text, std::vector<Hit> &hits) const {
+	auto C = class_count;
+	auto size = text.size();
+	uint32_t state = 0;
+	for(size_t pos = 0; pos < size; ++pos) {
+		if(!state) {
+			pos = skip(text.data(), pos, size);
+			if(pos == size) {
+				break;
+			}
+		}
+		auto next = transitions[state + classes[static_cast<uint8_t>(text[pos])]];
+		state = next & ~match_bit;
+		if(next & match_bit) {
+			auto s = state / C;
+			for(auto i = output_begin[s]; i < output_begin[s + 1]; ++i) {
+				auto pattern = outputs[i];
+				hits.emplace_back(Hit {pattern, static_cast<uint32_t>(pos + 1 - sizes[pattern])});
+			}
+		}
+	}
+}
+
+ParsepatchError search_patch(PatchReader &reader, std::string_view buf, const LiteralSearcher &searcher, SearchSide side, std::vector<SearchMatch> &matches) {
+	reader.reset();
+	reader.buf = buf;
+	std::vector<LiteralSearcher::Hit> hits;
+
+	while(auto some_line = reader.next(ScannerUtils::starter, false)) {
+		std::optional<DiffHeader> header;
+		auto err = reader.parse_diff_header(*some_line, header);
+		if(err) {
+			return err;
+		}
+		if(!header) {
+			continue;
+		}
+		auto file = side == SearchSide::Added ? header->new_name : header->old_name;
+
+		auto first = header->hunks;
+		// reading hunks of a diff without them would consume the line after it
+		while(header->hunks) {
+			auto nums_some = reader.next_hunk(first);
+			if(!nums_some) {
+				return nums_some.error();
+			}
+			if(!*nums_some) {
+				break;
+			}
+			auto lines_count = **nums_some;
+			while(auto line_some = reader.next_hunk_line(lines_count)) {
+				auto number = side == SearchSide::Added ? (line_some->old_line ? 0 : line_some->new_line) : (line_some->new_line ? 0 : line_some->old_line);
+				if(!number) {
+					continue;
+				}
+				hits.clear();
+				searcher.find(line_some->line, hits);
+				for(auto hit: hits) {
+					matches.emplace_back(SearchMatch {file, number, hit.begin + 1, hit.pattern});
+				}
+			}
+		}
+	}
+
+	if(reader.utf8_check == Utf8Check::All) {
+		reader.check_utf8(buf.size());
+	}
+	return reader.utf8_error;
+}
+
+};// namespace ParsePatch
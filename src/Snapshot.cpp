@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <cstring>
+
+#include "ParsePatch/Snapshot.hpp"
+
+namespace ParsePatch {
+
+namespace {
+
+constexpr size_t column_alignment = 8;
+
+constexpr size_t align_up(size_t size) {
+	return (size + column_alignment - 1) & ~(column_alignment - 1);
+}
+
+/// Visits the columns in the order they are laid out in the image. Works both on `ColumnarPatch` (vectors) and on `SnapshotView` (spans).
+template <typename TablesT, typename F>
+void for_each_column(TablesT &t, const SnapshotHeader &h, F &&f) {
+	f(t.diffs.old_name_offset, h.diffs);
+	f(t.diffs.new_name_offset, h.diffs);
+	f(t.diffs.old_name_length, h.diffs);
+	f(t.diffs.new_name_length, h.diffs);
+	f(t.diffs.op, h.diffs);
+	f(t.diffs.op_mode, h.diffs);
+	f(t.diffs.old_mode, h.diffs);
+	f(t.diffs.new_mode, h.diffs);
+	f(t.diffs.flags, h.diffs);
+	f(t.diffs.first_hunk, h.diffs);
+	f(t.diffs.hunk_count, h.diffs);
+	f(t.diffs.first_binary, h.diffs);
+	f(t.diffs.binary_count, h.diffs);
+
+	f(t.hunks.diff, h.hunks);
+	f(t.hunks.first_line, h.hunks);
+	f(t.hunks.line_count, h.hunks);
+	f(t.hunks.old_count, h.hunks);
+	f(t.hunks.old_lines, h.hunks);
+	f(t.hunks.new_count, h.hunks);
+	f(t.hunks.new_lines, h.hunks);
+	f(t.hunks.section_offset, h.hunks);
+	f(t.hunks.section_length, h.hunks);
+
+	f(t.lines.kind, h.lines);
+	f(t.lines.old_line, h.lines);
+	f(t.lines.new_line, h.lines);
+	f(t.lines.offset, h.lines);
+	f(t.lines.length, h.lines);
+	f(t.lines.flags, h.lines);
+
+	f(t.binary.diff, h.binary);
+	f(t.binary.type, h.binary);
+	f(t.binary.hunk_size, h.binary);
+}
+
+}// namespace
+
+void write_snapshot(const ColumnarPatch &tables, std::string &image) {
+	SnapshotHeader header;
+	std::memcpy(header.magic, SnapshotHeader::magic_value, sizeof(header.magic));
+	header.version = SnapshotHeader::current_version;
+	header.byte_order = SnapshotHeader::byte_order_mark;
+	header.source_size = tables.source.size();
+	header.diffs = tables.diffs.size();
+	header.hunks = tables.hunks.size();
+	header.lines = tables.lines.size();
+	header.binary = tables.binary.size();
+
+	size_t size = align_up(sizeof(header));
+	for_each_column(tables, header, [&](const auto &column, uint64_t count) {
+		size += align_up(count * sizeof(column[0]));
+	});
+
+	image.assign(size, '\0');
+	auto base = image.data();
+	std::memcpy(base, &header, sizeof(header));
+
+	size_t pos = align_up(sizeof(header));
+	for_each_column(tables, header, [&](const auto &column, uint64_t count) {
+		auto bytes = count * sizeof(column[0]);
+		if(bytes) {
+			std::memcpy(base + pos, column.data(), bytes);
+		}
+		pos += align_up(bytes);
+	});
+}
+
+void SnapshotWriter::close() {
+	write_snapshot(*this, image);
+}
+
+size_t SnapshotView::DiffTable::size() const {
+	return op.size();
+}
+
+size_t SnapshotView::HunkTable::size() const {
+	return diff.size();
+}
+
+size_t SnapshotView::LineTable::size() const {
+	return kind.size();
+}
+
+size_t SnapshotView::BinaryTable::size() const {
+	return diff.size();
+}
+
+std::optional<SnapshotView> SnapshotView::open(std::string_view image) {
+	SnapshotHeader header;
+	if(image.size() < sizeof(header) || reinterpret_cast<uintptr_t>(image.data()) % column_alignment) {
+		return {};
+	}
+	std::memcpy(&header, image.data(), sizeof(header));
+	if(std::memcmp(header.magic, SnapshotHeader::magic_value, sizeof(header.magic)) || header.version != SnapshotHeader::current_version || header.byte_order != SnapshotHeader::byte_order_mark) {
+		return {};
+	}
+
+	SnapshotView view;
+	view.source_size = header.source_size;
+
+	size_t pos = align_up(sizeof(header));
+	bool fits = true;
+	for_each_column(view, header, [&](auto &column, uint64_t count) {
+		using T = typename std::remove_reference_t<decltype(column)>::element_type;
+		auto bytes = count * sizeof(T);
+		if(!fits || count > image.size() / sizeof(T) || pos + bytes > image.size()) {
+			fits = false;
+			return;
+		}
+		column = {reinterpret_cast<T *>(image.data() + pos), static_cast<size_t>(count)};
+		pos += align_up(bytes);
+	});
+	if(!fits || !view.validate()) {
+		return {};
+	}
+	return view;
+}
+
+bool SnapshotView::validate() const {
+	auto in_source = [&](uint64_t offset, uint32_t length) {
+		return offset <= source_size && length <= source_size - offset;
+	};
+	for(size_t d = 0; d < diffs.size(); ++d) {
+		if(diffs.op[d] > FileOpCode::None || uint64_t(diffs.first_hunk[d]) + diffs.hunk_count[d] > hunks.size() || uint64_t(diffs.first_binary[d]) + diffs.binary_count[d] > binary.size() || !in_source(diffs.old_name_offset[d], diffs.old_name_length[d]) || !in_source(diffs.new_name_offset[d], diffs.new_name_length[d])) {
+			return false;
+		}
+	}
+	for(size_t h = 0; h < hunks.size(); ++h) {
+		if(hunks.first_line[h] > lines.size() || hunks.line_count[h] > lines.size() - hunks.first_line[h] || !in_source(hunks.section_offset[h], hunks.section_length[h])) {
+			return false;
+		}
+	}
+	for(size_t l = 0; l < lines.size(); ++l) {
+		if(lines.kind[l] > LineKind::Removed || lines.flags[l] > LINE_NO_NEWLINE || !in_source(lines.offset[l], lines.length[l])) {
+			return false;
+		}
+	}
+	return std::none_of(begin(binary.type), end(binary.type), [](BinaryHunkType type) {
+		return type > BinaryHunkType::Delta;
+	});
+}
+
+bool SnapshotView::replay(std::string_view source, Patch &patch) const {
+	if(source.size() != source_size) {
+		return false;
+	}
+
+	// the references were checked by `open`, nothing can fail from here
+	for(size_t d = 0; d < diffs.size(); ++d) {
+		auto diff = patch.new_diff();
+
+		std::optional<std::vector<BinaryHunk>> binary_sizes;
+		if(diffs.flags[d] & DIFF_BINARY) {
+			auto &sizes = binary_sizes.emplace();
+			sizes.reserve(diffs.binary_count[d]);
+			for(size_t b = diffs.first_binary[d], e = b + diffs.binary_count[d]; b < e; ++b) {
+				sizes.emplace_back(BinaryHunk {binary.type[b], binary.hunk_size[b]});
+			}
+		}
+		std::optional<FileMode> file_mode;
+		if(diffs.flags[d] & DIFF_FILE_MODE) {
+			file_mode = FileMode {diffs.old_mode[d], diffs.new_mode[d]};
+		}
+
+		diff->set_info(source.substr(diffs.old_name_offset[d], diffs.old_name_length[d]), source.substr(diffs.new_name_offset[d], diffs.new_name_length[d]), FileOp {diffs.op[d], diffs.op_mode[d]}, std::move(binary_sizes), file_mode);
+		if(diffs.hunk_count[d]) {
+			uint64_t line_total = 0;
+			for(size_t h = diffs.first_hunk[d], he = h + diffs.hunk_count[d]; h < he; ++h) {
+				line_total += hunks.line_count[h];
+			}
+			diff->size_hint(diffs.hunk_count[d], line_total);
+		}
+
+		for(size_t h = diffs.first_hunk[d], he = h + diffs.hunk_count[d]; h < he; ++h) {
+			diff->new_hunk(NumbersT {hunks.old_count[h], hunks.old_lines[h], hunks.new_count[h], hunks.new_lines[h]}, source.substr(hunks.section_offset[h], hunks.section_length[h]));
+			for(size_t l = hunks.first_line[h], le = l + hunks.line_count[h]; l < le; ++l) {
+				diff->add_line(lines.old_line[l], lines.new_line[l], source.substr(lines.offset[l], lines.length[l]));
+				if(lines.flags[l] & LINE_NO_NEWLINE) {
+					diff->no_newline();
+				}
+			}
+		}
+		diff->close();
+	}
+	patch.close();
+	return true;
+}
+
+};// namespace ParsePatch
@@ -0,0 +1,94 @@
+#include <vector>
+
+#include "ParsePatch/Split.hpp"
+
+namespace ParsePatch {
+
+Partitioner::~Partitioner() = default;
+
+namespace {
+
+/// Writes the slice of every diff into its partition when the diff is closed
+struct SlicingPatch: public Patch {
+	struct SlicingDiff: public Diff {
+		SlicingPatch *patch = nullptr;
+		std::string_view old_name, new_name;
+		uint64_t begin = 0, end = 0;
+
+		virtual void set_info(const std::string_view old_name, const std::string_view new_name, FileOp, std::optional<std::vector<BinaryHunk>>, std::optional<FileMode>) override {
+			this->old_name = old_name;
+			this->new_name = new_name;
+		}
+
+		virtual void add_line(uint32_t, uint32_t, std::string_view &&) override {
+		}
+
+		using Diff::new_hunk;
+
+		virtual void new_hunk() override {
+		}
+
+		virtual void set_range(uint64_t begin, uint64_t end) override {
+			this->begin = begin;
+			this->end = end;
+		}
+
+		virtual void close() override {
+			patch->write(*this);
+		}
+	};
+
+	std::string_view buf;
+	Partitioner &partitioner;
+	std::span<PatchWriter *const> outputs;
+	bool keep_preamble;
+	/// The text before the first diff, known when the first diff is closed
+	std::optional<std::string_view> preamble;
+	/// Whether a partition has got a diff
+	std::vector<bool> started;
+	SlicingDiff diff;
+
+	SlicingPatch(std::string_view buf, Partitioner &partitioner, std::span<PatchWriter *const> outputs, bool keep_preamble): buf(buf), partitioner(partitioner), outputs(outputs), keep_preamble(keep_preamble), started(outputs.size()) {
+		diff.patch = this;
+	}
+
+	void write(const SlicingDiff &d) {
+		if(!preamble) {
+			preamble = buf.substr(0, keep_preamble ? d.begin : 0);
+		}
+		auto partition = partitioner.partition_of(d.old_name, d.new_name);
+		if(!partition || *partition >= outputs.size()) {
+			return;
+		}
+		auto &out = *outputs[*partition];
+		if(!started[*partition]) {
+			started[*partition] = true;
+			out.write_slice(*preamble);
+		}
+		out.write_slice(buf.substr(d.begin, d.end - d.begin));
+	}
+
+	virtual Diff *new_diff() override {
+		return &diff;
+	}
+
+	virtual void close() override {
+		for(auto out: outputs) {
+			out->close();
+		}
+	}
+};
+
+}// namespace
+
+ParsepatchError PatchSplitter::split(std::string_view buf, Partitioner &partitioner, std::span<PatchWriter *const> outputs) {
+	SlicingPatch slicing(buf, partitioner, outputs, keep_preamble);
+	auto err = reader.by_buf(buf, slicing);
+	if(err) {
+		// what is split before the error is still written
+		slicing.close();
+	}
+	return err;
+}
+
+};// namespace ParsePatch
@@ -0,0 +1,119 @@
+#include <bit>
+#include <cstdint>
+
+#if defined(__SSE2__)
+	#include <emmintrin.h>
+#endif
+
+#include "ParsePatch/Utf8.hpp"
+
+namespace ParsePatch {
+
+namespace {
+
+constexpr bool is_continuation(uint8_t c) {
+	return (c & 0xC0) == 0x80;
+}
+
+/// Length of the valid multibyte sequence at `p`, 0 if it is invalid. Overlong forms, surrogates and code points above U+10FFFF are invalid.
+size_t sequence_length(const uint8_t *p, const uint8_t *end) {
+	auto c = *p;
+	size_t len;
+	// the allowed range of the second byte, the rest are any continuation bytes
+	uint8_t lo = 0x80, hi = 0xBF;
+	if(c >= 0xC2 && c <= 0xDF) {
+		len = 2;
+	} else if(c >= 0xE0 && c <= 0xEF) {
+		len = 3;
+		if(c == 0xE0) {
+			lo = 0xA0;
+		} else if(c == 0xED) {
+			hi = 0x9F;
+		}
+	} else if(c >= 0xF0 && c <= 0xF4) {
+		len = 4;
+		if(c == 0xF0) {
+			lo = 0x90;
+		} else if(c == 0xF4) {
+			hi = 0x8F;
+		}
+	} else {
+		return 0;
+	}
+	if(static_cast<size_t>(end - p) < len || p[1] < lo || p[1] > hi) {
+		return 0;
+	}
+	for(size_t i = 2; i < len; ++i) {
+		if(!is_continuation(p[i])) {
+			return 0;
+		}
+	}
+	return len;
+}
+
+/// The scan of `find_eol_utf8`, stopping at `\n` if `stop_at_eol` is set
+const uint8_t *scan(const uint8_t *p, const uint8_t *end, bool stop_at_eol, const uint8_t *&invalid) {
+	invalid = nullptr;
+	while(p < end) {
+#if defined(__SSE2__)
+		// text is mostly ASCII: 16 bytes at once until a block has a `\n` or a byte of a multibyte sequence
+		const auto nl = _mm_set1_epi8('\n');
+		for(; end - p >= 16; p += 16) {
+			auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+			auto eols = stop_at_eol ? static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl))) : 0u;
+			auto high = static_cast<unsigned>(_mm_movemask_epi8(v));
+			if(!high) {
+				if(eols) {
+					return p + std::countr_zero(eols);
+				}
+				continue;
+			}
+			// the bytes before the first one of interest are ASCII
+			auto first = std::countr_zero(eols | high);
+			p += first;
+			break;
+		}
+#endif
+		// byte by byte until the end of the sequence at hand
+		auto block_end = end - p > 16 ? p + 16 : end;
+		while(p < block_end) {
+			auto c = *p;
+			if(c < 0x80) {
+				if(c == '\n' && stop_at_eol) {
+					return p;
+				}
+				++p;
+				continue;
+			}
+			auto len = sequence_length(p, end);
+			if(!len) {
+				if(!invalid) {
+					invalid = p;
+				}
+				// continuation bytes are never `\n`, so the scan goes on byte by byte
+				len = 1;
+			}
+			p += len;
+		}
+	}
+	return nullptr;
+}
+
+}// namespace
+
+size_t find_invalid_utf8(std::string_view buf) {
+	auto p = reinterpret_cast<const uint8_t *>(buf.data());
+	const uint8_t *invalid;
+	scan(p, p + buf.size(), false, invalid);
+	return invalid ? static_cast<size_t>(invalid - p) : std::string_view::npos;
+}
+
+size_t find_eol_utf8(std::string_view buf, size_t pos, size_t &invalid) {
+	auto p = reinterpret_cast<const uint8_t *>(buf.data());
+	const uint8_t *invalid_at;
+	auto eol = scan(p + pos, p + buf.size(), true, invalid_at);
+	invalid = invalid_at ? static_cast<size_t>(invalid_at - p) : std::string_view::npos;
+	return eol ? static_cast<size_t>(eol - p) : std::string_view::npos;
+}
+
+};// namespace ParsePatch
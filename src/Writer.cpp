@@ -0,0 +1,416 @@
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <ostream>
+
+#include "ParsePatch/Writer.hpp"
+
+#if __has_include(<sys/uio.h>)
+	#include <sys/uio.h>
+	#include <unistd.h>
+	#define PARSEPATCH_HAVE_WRITEV
+#elif __has_include(<io.h>)
+	#include <io.h>
+#endif
+
+namespace ParsePatch {
+
+namespace {
+
+/// IOV_MAX of Linux, the smallest of the common ones
+constexpr size_t max_batch = 1024;
+
+/// Writes all the pieces, retrying on partial writes. Returns errno of the failure or 0.
+int write_all(int fd, std::pair<const char *, size_t> *pieces, size_t count) {
+#ifdef PARSEPATCH_HAVE_WRITEV
+	iovec batch[max_batch];
+	while(count) {
+		auto n = std::min(count, max_batch);
+		for(size_t i = 0; i < n; ++i) {
+			batch[i] = {const_cast<char *>(pieces[i].first), pieces[i].second};
+		}
+		auto written = ::writev(fd, batch, static_cast<int>(n));
+		if(written < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			return errno;
+		}
+		// skip what is written, the rest of a partly written piece stays
+		auto left = static_cast<size_t>(written);
+		while(count && left >= pieces->second) {
+			left -= pieces->second;
+			++pieces;
+			--count;
+		}
+		if(count) {
+			pieces->first += left;
+			pieces->second -= left;
+		}
+	}
+#else
+	for(size_t i = 0; i < count; ++i) {
+		auto [data, size] = pieces[i];
+		while(size) {
+			auto written = ::_write(fd, data, static_cast<unsigned>(std::min<size_t>(size, 1 << 30)));
+			if(written < 0) {
+				return errno;
+			}
+			data += written;
+			size -= written;
+		}
+	}
+#endif
+	return 0;
+}
+
+}// namespace
+
+PatchWriter::PatchWriter(int fd, size_t flush_size): fd(fd), flush_size(flush_size) {
+	diff.writer = this;
+}
+
+PatchWriter::PatchWriter(std::ostream &out, size_t flush_size): out(&out), flush_size(flush_size) {
+	diff.writer = this;
+}
+
+void PatchWriter::append(std::string_view view) {
+	if(view.empty()) {
+		return;
+	}
+	if(!pieces.empty()) {
+		auto &last = pieces.back();
+		// the piece of the `@@` line is filled later, nothing is merged into it
+		bool reserved = diff.hunk_open && pieces.size() - 1 == diff.hunk_piece;
+		if(last.base && !reserved && last.base + last.offset + last.size == view.data()) {
+			last.size += view.size();
+			return;
+		}
+	}
+	pieces.emplace_back(Piece {view.data(), 0, view.size()});
+}
+
+void PatchWriter::format(std::string_view view) {
+	if(!pieces.empty()) {
+		auto &last = pieces.back();
+		bool reserved = diff.hunk_open && pieces.size() - 1 == diff.hunk_piece;
+		if(!last.base && !reserved && last.offset + last.size == text.size()) {
+			last.size += view.size();
+			text.append(view);
+			return;
+		}
+	}
+	pieces.emplace_back(Piece {nullptr, text.size(), view.size()});
+	text.append(view);
+}
+
+void PatchWriter::format(uint32_t number, int base) {
+	char buf[16];
+	auto res = std::to_chars(buf, buf + sizeof(buf), number, base);
+	format(std::string_view(buf, res.ptr));
+}
+
+void PatchWriter::format_name(std::string_view prefix, std::string_view name) {
+	if(name.empty()) {
+		format("/dev/null");
+	} else {
+		format(prefix);
+		format(name);
+	}
+}
+
+bool PatchWriter::should_flush() const {
+	return text.size() >= flush_size || pieces.size() * sizeof(Piece) >= flush_size;
+}
+
+void PatchWriter::write_pieces(size_t count) {
+	if(!error && count) {
+		resolved.clear();
+		for(size_t i = 0; i < count; ++i) {
+			auto &p = pieces[i];
+			resolved.emplace_back((p.base ? p.base : text.data()) + p.offset, p.size);
+		}
+		if(out) {
+			for(auto [data, size]: resolved) {
+				out->write(data, static_cast<std::streamsize>(size));
+			}
+			if(!*out) {
+				error = std::make_error_code(std::errc::io_error);
+			}
+		} else if(auto err = write_all(fd, resolved.data(), resolved.size())) {
+			error = std::error_code(err, std::generic_category());
+		}
+	}
+	pieces.erase(begin(pieces), begin(pieces) + count);
+	if(pieces.empty()) {
+		text.clear();
+	}
+}
+
+void PatchWriter::flush() {
+	if(diff.hunk_open) {
+		// the `@@` line of the open hunk isn't known yet
+		write_pieces(diff.hunk_piece);
+		diff.hunk_piece = 0;
+	} else {
+		write_pieces(pieces.size());
+	}
+}
+
+void PatchWriter::write(const PatchEvent &event) {
+	switch(event.kind) {
+		case PatchEventKind::Diff: {
+			auto &h = *event.header;
+			new_diff();
+			diff.start(h.old_name, h.new_name, h.op, h.binary_sizes.has_value(), h.file_mode);
+			diff.set_header(h.raw);
+		} break;
+		case PatchEventKind::Hunk:
+			diff.new_hunk(event.numbers, event.section);
+			break;
+		case PatchEventKind::Line:
+			diff.add_line(event.line.old_line, event.line.new_line, std::string_view(event.line.line));
+			break;
+		case PatchEventKind::NoNewline:
+			diff.no_newline();
+			break;
+		case PatchEventKind::DiffEnd:
+			diff.close();
+			break;
+		case PatchEventKind::Error:
+			break;
+	}
+}
+
+void PatchWriter::write_slice(std::string_view slice) {
+	append(slice);
+	if(flush_every_diff || should_flush()) {
+		flush();
+	}
+}
+
+Diff *PatchWriter::new_diff() {
+	return &diff;
+}
+
+void PatchWriter::close() {
+	write_pieces(pieces.size());
+	if(out) {
+		out->flush();
+	}
+}
+
+void PatchWriter::DiffWriter::start(std::string_view old_name, std::string_view new_name, FileOp op, bool binary, std::optional<FileMode> file_mode) {
+	this->old_name = old_name;
+	this->new_name = new_name;
+	this->op = op;
+	this->binary = binary;
+	this->file_mode = file_mode;
+	raw = {};
+	eol = "\n";
+	range = {};
+	header_written = hunk_open = false;
+	delta = 0;
+}
+
+void PatchWriter::DiffWriter::set_info(const std::string_view old_name, const std::string_view new_name, FileOp op, std::optional<std::vector<BinaryHunk>> binary_sizes, std::optional<FileMode> file_mode) {
+	start(old_name, new_name, op, binary_sizes.has_value(), file_mode);
+}
+
+void PatchWriter::DiffWriter::set_header(std::string_view header) {
+	raw = header;
+	eol = raw.ends_with("\r\n") ? "\r\n" : "\n";
+}
+
+void PatchWriter::DiffWriter::set_range(uint64_t begin, uint64_t end) {
+	range = {begin, end};
+}
+
+void PatchWriter::DiffWriter::write_binary() {
+	header_written = true;
+	auto &w = *writer;
+	auto &src = w.source;
+	// the slice is the diff only if it starts with its header, a header of another text (i.e. reversed) isn't passed
+	if(range && range->first <= range->second && range->second <= src.size() && !raw.empty() && raw.data() == src.data() + range->first) {
+		w.append(src.substr(range->first, range->second - range->first));
+	} else if(!w.error) {
+		w.error = std::make_error_code(std::errc::invalid_argument);
+	}
+}
+
+void PatchWriter::DiffWriter::write_header() {
+	if(header_written) {
+		return;
+	}
+	header_written = true;
+	auto &w = *writer;
+	// a diff creating or deleting an empty file has no `---` line to name `/dev/null`, so both names are the file
+	auto minus = op.code == FileOpCode::New ? std::string_view {} : old_name;
+	auto plus = op.code == FileOpCode::Deleted ? std::string_view {} : new_name;
+
+	if(!raw.empty()) {
+		w.append(raw);
+	} else {
+		auto a = old_name.empty() ? new_name : old_name;
+		auto b = new_name.empty() ? old_name : new_name;
+		w.format("diff --git a/");
+		w.format(a);
+		w.format(" b/");
+		w.format(b);
+		w.format("\n");
+		if(file_mode) {
+			w.format("old mode ");
+			w.format(file_mode->old, 8);
+			w.format("\nnew mode ");
+			w.format(file_mode->neo, 8);
+			w.format("\n");
+		}
+		switch(op.code) {
+			case FileOpCode::New:
+				w.format("new file mode ");
+				w.format(op.something, 8);
+				w.format("\n");
+				break;
+			case FileOpCode::Deleted:
+				w.format("deleted file mode ");
+				w.format(op.something, 8);
+				w.format("\n");
+				break;
+			case FileOpCode::Renamed:
+			case FileOpCode::Copied: {
+				auto word = op.code == FileOpCode::Renamed ? std::string_view("rename") : std::string_view("copy");
+				w.format(word);
+				w.format(" from ");
+				w.format(a);
+				w.format("\n");
+				w.format(word);
+				w.format(" to ");
+				w.format(b);
+				w.format("\n");
+			} break;
+			default:
+				break;
+		}
+		if(hunk_open) {
+			w.format("--- ");
+			w.format_name("a/", minus);
+			w.format("\n+++ ");
+			w.format_name("b/", plus);
+			w.format("\n");
+		}
+	}
+}
+
+void PatchWriter::DiffWriter::new_hunk() {
+	end_hunk();
+	hunk_open = true;
+	write_header();
+	// the first line sets the start of the hunk
+	hunk = {};
+	hunk_piece = writer->pieces.size();
+	writer->pieces.emplace_back(Piece {nullptr, 0, 0});
+	section = {};
+}
+
+void PatchWriter::DiffWriter::new_hunk(const NumbersT &, std::string_view section) {
+	new_hunk();
+	this->section = section;
+}
+
+void PatchWriter::DiffWriter::no_newline() {
+	writer->format("\\ No newline at end of file");
+	writer->format(eol);
+}
+
+void PatchWriter::DiffWriter::add_line(uint32_t old_line, uint32_t new_line, std::string_view &&line) {
+	auto &w = *writer;
+	char marker = !old_line ? '+' : (!new_line ? '-' : ' ');
+	if(!hunk.old_lines && !hunk.new_lines) {
+		hunk.old_count = old_line ? old_line : static_cast<uint32_t>(new_line - delta);
+		hunk.new_count = new_line ? new_line : static_cast<uint32_t>(old_line + delta);
+	}
+	hunk.old_lines += old_line != 0;
+	hunk.new_lines += new_line != 0;
+
+	// the parsed lines don't include the line end, `\r\n` is kept if the source has it
+	auto &src = w.source;
+	size_t eol_size = 0;
+	bool in_source = !src.empty() && line.data() > src.data() && line.data() + line.size() < src.data() + src.size();
+	if(in_source) {
+		auto rest = std::string_view(line.data() + line.size(), src.data() + src.size());
+		eol_size = rest.starts_with('\n') ? 1 : (rest.starts_with("\r\n") ? 2 : 0);
+	}
+	if(eol_size && line.data()[-1] == marker) {
+		w.append(std::string_view(line.data() - 1, line.size() + 1 + eol_size));
+		return;
+	}
+	w.format(std::string_view(&marker, 1));
+	if(eol_size) {
+		w.append(std::string_view(line.data(), line.size() + eol_size));
+		return;
+	}
+	w.append(line);
+	w.format(eol);
+}
+
+void PatchWriter::DiffWriter::end_hunk() {
+	if(!hunk_open) {
+		return;
+	}
+	hunk_open = false;
+	auto &w = *writer;
+	if(!hunk.old_lines && !hunk.new_lines) {
+		// an empty hunk is not written
+		w.pieces.erase(begin(w.pieces) + hunk_piece);
+		return;
+	}
+	delta = static_cast<int64_t>(hunk.new_count + hunk.new_lines) - (hunk.old_count + hunk.old_lines);
+
+	auto start = w.text.size();
+	w.text.append("@@ -");
+	// format() appends to the last piece, the line goes into the reserved one
+	auto range = [&](uint32_t first, uint32_t count) {
+		char buf[16];
+		auto number = [&](uint32_t n) {
+			w.text.append(buf, std::to_chars(buf, buf + sizeof(buf), n).ptr);
+		};
+		if(!count) {
+			number(first ? first - 1 : 0);
+			w.text.append(",0");
+		} else {
+			number(first);
+			if(count != 1) {
+				w.text.push_back(',');
+				number(count);
+			}
+		}
+	};
+	range(hunk.old_count, hunk.old_lines);
+	w.text.append(" +");
+	range(hunk.new_count, hunk.new_lines);
+	w.text.append(" @@");
+	if(!section.empty()) {
+		w.text.push_back(' ');
+		w.text.append(section);
+	}
+	w.text.append(eol);
+	w.pieces[hunk_piece] = Piece {nullptr, start, w.text.size() - start};
+
+	if(!w.flush_every_diff && w.should_flush()) {
+		w.flush();
+	}
+}
+
+void PatchWriter::DiffWriter::close() {
+	end_hunk();
+	if(binary && !header_written) {
+		write_binary();
+	} else {
+		write_header();
+	}
+	if(writer->flush_every_diff || writer->should_flush()) {
+		writer->flush();
+	}
+}
+
+};// namespace ParsePatch
@@ -1,9 +1,38 @@
 #include <array>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
 #include <gtest/gtest.h>
+#include <sstream>
+#include <thread>
 #include <tuple>
 #include <utility>
 
+#include <ParsePatch.h>
 #include <ParsePatch.hpp>
+#include <ParsePatch/Cache.hpp>
+#include <ParsePatch/Chunked.hpp>
+#include <ParsePatch/Churn.hpp>
+#include <ParsePatch/Columnar.hpp>
+#include <ParsePatch/Compose.hpp>
+#include <ParsePatch/Compression.hpp>
+#include <ParsePatch/EventLog.hpp>
+#include <ParsePatch/Events.hpp>
+#include <ParsePatch/PatchId.hpp>
+#include <ParsePatch/Pool.hpp>
+#include <ParsePatch/Reverse.hpp>
+#include <ParsePatch/Hash.hpp>
+#include <ParsePatch/Incremental.hpp>
+#include <ParsePatch/Json.hpp>
+#include <ParsePatch/LineMap.hpp>
+#include <ParsePatch/LineRanges.hpp>
+#include <ParsePatch/PathInterner.hpp>
+#include <ParsePatch/Search.hpp>
+#include <ParsePatch/Snapshot.hpp>
+#include <ParsePatch/Split.hpp>
+#include <ParsePatch/Utf8.hpp>
+#include <ParsePatch/Writer.hpp>
 
 using namespace ParsePatch;
 
@@ -123,3 +152,1683 @@ TEST(ParsePatch, parse_files) {
 		ASSERT_EQ(neo, (s.second).second);
 	}
 }
+
+static const std::string sample_patch {
+	"diff --git a/foo.txt b/foo.txt\n"
+	"index 1111111..2222222 100644\n"
+	"--- a/foo.txt\n"
+	"+++ b/foo.txt\n"
+	"@@ -1,3 +1,3 @@\n"
+	" one\n"
+	"-two\n"
+	"+deux\n"
+	" three\n"
+	"@@ -10,2 +10,3 @@\n"
+	" ten\n"
+	"+ten and a half\n"
+	" eleven\n"
+	"diff --git a/bar.txt b/bar.txt\n"
+	"new file mode 100755\n"
+	"index 0000000..3333333\n"
+	"--- /dev/null\n"
+	"+++ b/bar.txt\n"
+	"@@ -0,0 +1 @@\n"
+	"+hello\n"};
+
+TEST(ParsePatch, columnar) {
+	ColumnarPatch tables;
+	tables.reset(sample_patch);
+	PatchReader r;
+	ASSERT_FALSE(r.by_buf(sample_patch, tables));
+
+	ASSERT_EQ(tables.diffs.size(), 2u);
+	ASSERT_EQ(tables.view(tables.diffs.new_name_offset[0], tables.diffs.new_name_length[0]), "foo.txt");
+	ASSERT_EQ(tables.diffs.old_name_length[1], 0u);
+	ASSERT_EQ(tables.diffs.op[1], FileOpCode::New);
+	ASSERT_EQ(tables.diffs.op_mode[1], 0100755u);
+	ASSERT_EQ(tables.diffs.hunk_count[0], 2u);
+	ASSERT_EQ(tables.diffs.first_hunk[1], 2u);
+
+	ASSERT_EQ(tables.hunks.size(), 3u);
+	ASSERT_EQ(tables.hunks.line_count[1], 3u);
+	ASSERT_EQ(tables.lines.size(), 8u);
+	ASSERT_EQ(tables.lines.kind[1], LineKind::Removed);
+	ASSERT_EQ(tables.lines.old_line[1], 2u);
+	ASSERT_EQ(tables.lines.kind[2], LineKind::Added);
+	ASSERT_EQ(tables.lines.new_line[2], 2u);
+	ASSERT_EQ(tables.view(tables.lines.offset[5], tables.lines.length[5]), "ten and a half");
+}
+
+TEST(ParsePatch, copies) {
+	std::string copies =
+		"diff --git a/a.txt b/b.txt\n"
+		"similarity index 100%\n"
+		"copy from a.txt\n"
+		"copy to b.txt\n"
+		"diff --git a/a.txt b/c.txt\n"
+		"similarity index 90%\n"
+		"copy from a.txt\n"
+		"copy to c.txt\n"
+		"index 1111111..2222222 100644\n"
+		"--- a/a.txt\n"
+		"+++ b/c.txt\n"
+		"@@ -1 +1 @@\n"
+		"-a\n"
+		"+c\n";
+	ColumnarPatch tables;
+	tables.reset(copies);
+	PatchReader r;
+	ASSERT_FALSE(r.by_buf(copies, tables));
+
+	ASSERT_EQ(tables.diffs.size(), 2u);
+	for(size_t d = 0; d < 2; ++d) {
+		ASSERT_EQ(tables.diffs.op[d], FileOpCode::Copied);
+		ASSERT_EQ(tables.view(tables.diffs.old_name_offset[d], tables.diffs.old_name_length[d]), "a.txt");
+	}
+	ASSERT_EQ(tables.view(tables.diffs.new_name_offset[1], tables.diffs.new_name_length[1]), "c.txt");
+	ASSERT_EQ(tables.diffs.hunk_count[0], 0u);
+	ASSERT_EQ(tables.diffs.hunk_count[1], 1u);
+
+	std::string out;
+	ASSERT_FALSE(patch_to_json(copies, out));
+	ASSERT_NE(out.find("\"filename\":\"b.txt\",\"new\":false,\"deleted\":false,\"binary\":false,\"renamed_from\":null,\"copied_from\":\"a.txt\""), std::string::npos);
+}
+
+TEST(ParsePatch, c_api_batches) {
+	auto reader = parsepatch_reader_new();
+	ASSERT_NE(reader, nullptr);
+	auto err = parsepatch_parse(reader, sample_patch.data(), sample_patch.size());
+	ASSERT_EQ(err.code, PARSEPATCH_OK);
+	auto totals = parsepatch_get_totals(reader);
+	ASSERT_EQ(totals.lines, 8u);
+
+	std::array<uint8_t, 3> kind;
+	std::array<uint64_t, 3> offset;
+	std::array<uint32_t, 3> length;
+	parsepatch_batch batch {};
+	batch.lines.capacity = kind.size();
+	batch.lines.kind = kind.data();
+	batch.lines.offset = offset.data();
+	batch.lines.length = length.data();
+	std::array<uint32_t, 3> old_count, new_lines, section_length;
+	batch.hunks.capacity = old_count.size();
+	batch.hunks.old_count = old_count.data();
+	batch.hunks.new_lines = new_lines.data();
+	batch.hunks.section_length = section_length.data();
+
+	std::vector<std::string_view> texts;
+	size_t calls = 0;
+	int more;
+	do {
+		more = parsepatch_next_batch(reader, &batch);
+		if(calls == 0) {
+			ASSERT_EQ(batch.hunks.count, 3u);
+			ASSERT_EQ(old_count, (std::array<uint32_t, 3> {1, 10, 0}));
+			ASSERT_EQ(new_lines, (std::array<uint32_t, 3> {3, 3, 1}));
+			ASSERT_EQ(section_length, (std::array<uint32_t, 3> {0, 0, 0}));
+		} else {
+			ASSERT_EQ(batch.hunks.count, 0u);
+		}
+		++calls;
+		ASSERT_EQ(batch.lines.first, texts.size());
+		for(size_t i = 0; i < batch.lines.count; ++i) {
+			texts.emplace_back(sample_patch.data() + offset[i], length[i]);
+		}
+	} while(more);
+
+	ASSERT_EQ(calls, 3u);
+	ASSERT_EQ(texts.size(), 8u);
+	ASSERT_EQ(texts[2], "deux");
+	ASSERT_EQ(texts[7], "hello");
+	parsepatch_reader_free(reader);
+}
+
+TEST(ParsePatch, snapshot_roundtrip) {
+	SnapshotWriter writer;
+	writer.reset(sample_patch);
+	PatchReader r;
+	ASSERT_FALSE(r.by_buf(sample_patch, writer));
+
+	auto view_some = SnapshotView::open(writer.image);
+	ASSERT_TRUE(view_some.has_value());
+	auto &view = *view_some;
+	ASSERT_EQ(view.diffs.size(), 2u);
+	ASSERT_EQ(view.lines.size(), 8u);
+	ASSERT_EQ(view.diffs.op[1], FileOpCode::New);
+
+	ColumnarPatch replayed;
+	replayed.reset(sample_patch);
+	ASSERT_TRUE(view.replay(sample_patch, replayed));
+	ASSERT_EQ(replayed.lines.offset, writer.lines.offset);
+	ASSERT_EQ(replayed.lines.kind, writer.lines.kind);
+	ASSERT_EQ(replayed.hunks.first_line, writer.hunks.first_line);
+	ASSERT_EQ(writer.hunks.old_count, (std::vector<uint32_t> {1, 10, 0}));
+	ASSERT_EQ(replayed.hunks.old_count, writer.hunks.old_count);
+	ASSERT_EQ(replayed.hunks.new_lines, writer.hunks.new_lines);
+	ASSERT_EQ(replayed.hunks.section_offset, writer.hunks.section_offset);
+	ASSERT_EQ(replayed.hunks.section_length, writer.hunks.section_length);
+	ASSERT_EQ(replayed.diffs.new_name_offset, writer.diffs.new_name_offset);
+
+	ASSERT_FALSE(view.replay(std::string_view(sample_patch).substr(1), replayed));
+	ASSERT_FALSE(SnapshotView::open(std::string_view(writer.image).substr(0, writer.image.size() - 8)).has_value());
+
+	// an op no parse produces
+	auto damaged = writer.image;
+	auto op_offset = reinterpret_cast<const char *>(view.diffs.op.data()) - writer.image.data();
+	damaged[op_offset] = 9;
+	ASSERT_FALSE(SnapshotView::open(damaged).has_value());
+}
+
+TEST(ParsePatch, hash64) {
+	// reference values of XXH64
+	ASSERT_EQ(hash64(""), 0xef46db3751d8e999ull);
+	ASSERT_EQ(hash64("a"), 0xd24ec4f1a98c6e5bull);
+
+	Hasher64 h;
+	for(auto c: sample_patch) {
+		h.update(std::string_view(&c, 1));
+	}
+	ASSERT_EQ(h.digest(), hash64(sample_patch));
+}
+
+TEST(ParsePatch, parse_cache) {
+	auto dir = std::filesystem::temp_directory_path() / "parsepatch_cache_test";
+	std::filesystem::remove_all(dir);
+	{
+		ParseCache cache(dir, 1 << 20);
+		ColumnarPatch parsed, cached;
+		parsed.reset(sample_patch);
+		cached.reset(sample_patch);
+
+		ASSERT_FALSE(cache.by_buf(sample_patch, parsed));
+		ASSERT_EQ(cache.stats.misses, 1u);
+		ASSERT_TRUE(std::filesystem::exists(cache.entry_path(sample_patch)));
+
+		// a hit gets the same callbacks as the parse
+		EventLogWriter parse_log(sample_patch), hit_log(sample_patch);
+		PatchReader r;
+		ASSERT_FALSE(r.by_buf(sample_patch, parse_log));
+		ASSERT_FALSE(cache.by_buf(sample_patch, hit_log));
+		ASSERT_EQ(cache.stats.hits, 1u);
+		ASSERT_EQ(hit_log.log, parse_log.log);
+
+		// a damaged entry is parsed again, the consumer sees the diffs once
+		auto path = cache.entry_path(sample_patch);
+		std::filesystem::resize_file(path, std::filesystem::file_size(path) - 4);
+		ASSERT_FALSE(cache.by_buf(sample_patch, cached));
+		ASSERT_EQ(cache.stats.misses, 2u);
+		ASSERT_EQ(cached.diffs.size(), 2u);
+		ASSERT_EQ(cached.lines.offset, parsed.lines.offset);
+
+		// entries are per UTF-8 check, recovering parses are not cached
+		cache.reader.utf8_check = Utf8Check::All;
+		ASSERT_NE(cache.entry_path(sample_patch), path);
+		cache.reader.utf8_check = Utf8Check::None;
+		cache.reader.recover = true;
+		ASSERT_FALSE(cache.by_buf(sample_patch, parse_log));
+		ASSERT_EQ(cache.stats.bypassed, 1u);
+		cache.reader.recover = false;
+
+		// a store beyond the size evicts without an explicit scan
+		cache.max_size = 0;
+		std::string other = sample_patch + "\n";
+		EventLogWriter other_log(other);
+		ASSERT_FALSE(cache.by_buf(other, other_log));
+		ASSERT_EQ(cache.stats.stores, 3u);
+		ASSERT_EQ(cache.stats.evictions, 2u);
+		ASSERT_FALSE(std::filesystem::exists(cache.entry_path(sample_patch)));
+		ASSERT_FALSE(std::filesystem::exists(cache.entry_path(other)));
+	}
+	std::filesystem::remove_all(dir);
+}
+
+/// Hands out a buffer in pieces of a fixed size
+struct SplittingSource: public ChunkSource {
+	std::string_view rest;
+	size_t size;
+
+	SplittingSource(std::string_view buf, size_t size): rest(buf), size(size) {
+	}
+
+	virtual Result<std::string_view> next_chunk() override {
+		auto chunk = rest.substr(0, size);
+		rest.remove_prefix(chunk.size());
+		return chunk;
+	}
+};
+
+TEST(ParsePatch, chunked) {
+	ColumnarPatch whole;
+	whole.reset(sample_patch);
+	PatchReader r;
+	ASSERT_FALSE(r.by_buf(sample_patch, whole));
+
+	for(size_t size: {1, 7, 64, 4096}) {
+		ColumnarPatch chunked;
+		SplittingSource source(sample_patch, size);
+		ChunkedPatchReader cr;
+		ASSERT_FALSE(cr.parse(source, chunked));
+		ASSERT_EQ(chunked.diffs.size(), whole.diffs.size());
+		ASSERT_EQ(chunked.diffs.op, whole.diffs.op);
+		ASSERT_EQ(chunked.hunks.line_count, whole.hunks.line_count);
+		ASSERT_EQ(chunked.lines.kind, whole.lines.kind);
+		ASSERT_EQ(chunked.lines.new_line, whole.lines.new_line);
+		ASSERT_EQ(chunked.lines.length, whole.lines.length);
+	}
+}
+
+static const std::array<unsigned char, 189> sample_patch_gz {
+	0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x4d, 0x8f, 0x4b, 0x0e, 0xc3, 0x20,
+	0x0c, 0x44, 0xf7, 0x3e, 0x85, 0xf7, 0x04, 0x42, 0x7e, 0xed, 0x36, 0x57, 0x21, 0xc2, 0x34, 0x48,
+	0x14, 0xa4, 0x88, 0x26, 0x39, 0x7e, 0xa1, 0x10, 0x35, 0xb3, 0x18, 0x59, 0xd6, 0x8c, 0xf5, 0xac,
+	0xad, 0x31, 0xc8, 0xf9, 0xcb, 0x46, 0x54, 0xad, 0x09, 0x41, 0xc4, 0x33, 0xe2, 0x72, 0x4d, 0x60,
+	0xbd, 0xa6, 0x13, 0xbb, 0x22, 0x21, 0xfa, 0x22, 0xec, 0xa4, 0x7c, 0x8c, 0x23, 0x70, 0xce, 0xff,
+	0x2d, 0x60, 0x8c, 0xdd, 0x9a, 0xf3, 0x8c, 0xbc, 0x6b, 0x06, 0x64, 0xd9, 0xe6, 0x19, 0x30, 0x78,
+	0x02, 0x1e, 0x8f, 0x00, 0x4c, 0xd3, 0xe7, 0x04, 0x8c, 0xeb, 0x46, 0x54, 0x62, 0xb2, 0xe9, 0x53,
+	0x4e, 0xd6, 0x60, 0x24, 0x0f, 0x2c, 0x19, 0x2a, 0xaf, 0x51, 0xe1, 0xaa, 0x9c, 0x01, 0x24, 0x47,
+	0x7b, 0xda, 0xeb, 0x3b, 0xee, 0xa2, 0xb6, 0x8a, 0x5b, 0x27, 0xf0, 0x74, 0xa0, 0xb1, 0x8e, 0xf0,
+	0x1d, 0x34, 0x65, 0xca, 0xe7, 0x34, 0xd5, 0x1f, 0x64, 0x91, 0x10, 0x43, 0xd1, 0x0f, 0xbe, 0xd5,
+	0xb4, 0xb7, 0xfe, 0xe3, 0x5c, 0x85, 0xbf, 0xee, 0x64, 0x2a, 0xd9, 0xc8, 0x04, 0x95, 0x89, 0xd8,
+	0x4a, 0xce, 0x05, 0xf8, 0x02, 0x0a, 0x26, 0xa4, 0x23, 0x2b, 0x01, 0x00, 0x00,
+};
+
+TEST(ParsePatch, compressed) {
+	std::string_view gz(reinterpret_cast<const char *>(sample_patch_gz.data()), sample_patch_gz.size());
+	ASSERT_EQ(detect_compression(gz), Compression::Gzip);
+	ASSERT_EQ(detect_compression(sample_patch), Compression::None);
+	if(!compression_supported(Compression::Gzip)) {
+		GTEST_SKIP() << "built without zlib";
+	}
+
+	ColumnarPatch whole, inflated;
+	whole.reset(sample_patch);
+	PatchReader r;
+	ASSERT_FALSE(r.by_buf(sample_patch, whole));
+
+	ChunkedPatchReader cr;
+	ASSERT_FALSE(cr.by_compressed_buf(gz, inflated));
+	ASSERT_EQ(inflated.diffs.size(), whole.diffs.size());
+	ASSERT_EQ(inflated.lines.kind, whole.lines.kind);
+	ASSERT_EQ(inflated.lines.old_line, whole.lines.old_line);
+
+	std::string truncated(gz.substr(0, gz.size() - 40));
+	ColumnarPatch broken;
+	ASSERT_EQ(cr.by_compressed_buf(truncated, broken).code, ParsepatchErrorCode::InvalidCompressedData);
+}
+
+TEST(ParsePatch, events) {
+	ColumnarPatch tables;
+	tables.reset(sample_patch);
+	PatchReader r;
+	ASSERT_FALSE(r.by_buf(sample_patch, tables));
+
+	std::vector<PatchEventKind> kinds;
+	std::vector<NumbersT> hunks;
+	size_t line = 0;
+	for(auto &&event: patch_events(r, sample_patch)) {
+		kinds.emplace_back(event.kind);
+		if(event.kind == PatchEventKind::Diff) {
+			ASSERT_EQ(event.header->new_name, kinds.size() == 1 ? "foo.txt" : "bar.txt");
+		} else if(event.kind == PatchEventKind::Hunk) {
+			hunks.emplace_back(event.numbers);
+		} else if(event.kind == PatchEventKind::Line) {
+			ASSERT_EQ(event.line.old_line, tables.lines.old_line[line]);
+			ASSERT_EQ(event.line.new_line, tables.lines.new_line[line]);
+			ASSERT_EQ(event.line.line, tables.view(tables.lines.offset[line], tables.lines.length[line]));
+			++line;
+		}
+	}
+	ASSERT_EQ(line, tables.lines.size());
+	ASSERT_EQ(kinds.size(), 2u + 3u + 8u + 2u);
+	ASSERT_EQ(kinds.back(), PatchEventKind::DiffEnd);
+	ASSERT_EQ(hunks.size(), 3u);
+	ASSERT_EQ(hunks[1], (NumbersT {10, 2, 10, 3}));
+	// the second hunk is numbered by its own header
+	ASSERT_EQ(tables.lines.old_line[4], 10u);
+
+	// the consumer may stop in the middle of a hunk
+	{
+		auto events = patch_events(r, sample_patch);
+		auto it = events.begin();
+		while((*it).kind != PatchEventKind::Line) {
+			++it;
+		}
+		ASSERT_EQ((*it).line.line, "one");
+	}
+
+	std::string broken = "diff --git a/x b/x\n--- a/x\n+++ b/x\n@@ -1,\n";
+	kinds.clear();
+	for(auto &&event: patch_events(r, broken)) {
+		kinds.emplace_back(event.kind);
+	}
+	ASSERT_EQ(kinds, (std::vector<PatchEventKind> {PatchEventKind::Diff, PatchEventKind::Error}));
+
+	// a diff without hunks is followed by the next one
+	std::string headers_only = "diff --git a/x b/x\nold mode 100644\nnew mode 100755\ndiff --git a/y b/y\nold mode 100644\nnew mode 100755\n";
+	kinds.clear();
+	for(auto &&event: patch_events(r, headers_only)) {
+		kinds.emplace_back(event.kind);
+	}
+	ASSERT_EQ(kinds, (std::vector<PatchEventKind> {PatchEventKind::Diff, PatchEventKind::DiffEnd, PatchEventKind::Diff, PatchEventKind::DiffEnd}));
+}
+
+TEST(ParsePatch, parse_many) {
+	struct Factory: public PatchFactory {
+		std::span<const std::string_view> inputs;
+		std::vector<ColumnarPatch> patches;
+		std::vector<ParsepatchErrorCode> errors;
+
+		Factory(std::span<const std::string_view> inputs): inputs(inputs), patches(inputs.size()), errors(inputs.size()) {}
+
+		virtual Patch *patch_for(size_t index, size_t) override {
+			patches[index].reset(inputs[index]);
+			return &patches[index];
+		}
+
+		virtual void finished(size_t index, size_t, Patch *, ParsepatchError err) override {
+			errors[index] = err.code;
+		}
+	};
+
+	std::string broken = "diff --git a/x b/x\n--- a/x\n+++ b/x\n@@ -1,\n";
+	std::vector<std::string_view> inputs(1000, sample_patch);
+	inputs[123] = broken;
+	Factory factory(inputs);
+	auto stats = parse_many(inputs, factory, 4);
+
+	ASSERT_EQ(stats.workers.size(), 4u);
+	ASSERT_EQ(stats.total.inputs, inputs.size());
+	ASSERT_EQ(stats.skipped, 0u);
+	ASSERT_EQ(stats.total.errors, 1u);
+	ASSERT_EQ(stats.total.bytes, 999 * sample_patch.size() + broken.size());
+	for(size_t i = 0; i < inputs.size(); ++i) {
+		if(i == 123) {
+			ASSERT_EQ(factory.errors[i], ParsepatchErrorCode::InvalidHunkHeader);
+		} else {
+			ASSERT_EQ(factory.errors[i], ParsepatchErrorCode::OK);
+			ASSERT_EQ(factory.patches[i].lines.size(), 8u);
+		}
+	}
+}
+
+TEST(ParsePatch, line_map) {
+	LineMapPatch maps;
+	PatchReader r;
+	ASSERT_FALSE(r.by_buf(sample_patch, maps));
+	ASSERT_EQ(maps.files.size(), 2u);
+
+	auto &foo = maps.files[0].map;
+	ASSERT_EQ(foo.blocks.size(), 2u);
+	ASSERT_EQ(foo.map_old_to_new(1), 1u);
+	ASSERT_EQ(foo.map_old_to_new(2), 0u);
+	ASSERT_EQ(foo.map_old_to_new(3), 3u);
+	ASSERT_EQ(foo.map_old_to_new(11), 12u);
+	ASSERT_EQ(foo.map_old_to_new(50), 51u);
+	ASSERT_EQ(foo.map_new_to_old(11), 0u);
+	ASSERT_EQ(foo.map_new_to_old(12), 11u);
+	ASSERT_EQ(maps.files[1].map.map_new_to_old(1), 0u);
+
+	std::array<uint32_t, 6> old_lines {1, 2, 3, 10, 11, 50}, out;
+	foo.map_old_to_new(old_lines, out);
+	ASSERT_EQ(out, (std::array<uint32_t, 6> {1, 0, 3, 10, 12, 51}));
+
+	// hunks without context between them form a single block
+	std::string zero_context =
+		"diff --git a/x b/x\n"
+		"--- a/x\n"
+		"+++ b/x\n"
+		"@@ -5,0 +6,2 @@\n"
+		"+a\n"
+		"+b\n"
+		"@@ -6 +7,0 @@\n"
+		"-c\n";
+	LineMapPatch zc;
+	ASSERT_FALSE(r.by_buf(zero_context, zc));
+	auto &x = zc.files[0].map;
+	ASSERT_EQ(x.blocks.size(), 1u);
+	ASSERT_EQ(x.map_old_to_new(5), 5u);
+	ASSERT_EQ(x.map_old_to_new(6), 0u);
+	ASSERT_EQ(x.map_old_to_new(7), 8u);
+	ASSERT_EQ(x.map_new_to_old(7), 0u);
+	ASSERT_EQ(x.map_new_to_old(8), 7u);
+}
+
+TEST(ParsePatch, changed_lines) {
+	ChangedLinesPatch changed;
+	PatchReader r;
+	ASSERT_FALSE(r.by_buf(sample_patch, changed));
+	ASSERT_EQ(changed.files.size(), 2u);
+
+	auto &foo = changed.files[0];
+	ASSERT_EQ(foo.added.count(), 2u);
+	ASSERT_EQ(foo.removed.count(), 1u);
+	ASSERT_TRUE(foo.added.contains(11));
+	ASSERT_FALSE(foo.added.contains(12));
+	ASSERT_TRUE(foo.removed.contains(2));
+
+	LineRangeSet covered;
+	for(uint32_t l: {1, 2, 3, 4, 9, 10, 11, 12}) {
+		covered.append(l);
+	}
+	ASSERT_EQ(covered.ranges.size(), 2u);
+	ASSERT_EQ(foo.added.count_intersection(covered), 2u);
+	auto both = foo.added.intersect(covered);
+	ASSERT_EQ(both.ranges.size(), 2u);
+	ASSERT_EQ(both.ranges[1].begin, 11u);
+
+	LineRangeSet unordered;
+	for(uint32_t l: {5, 1, 3, 2, 7, 3, 6}) {
+		unordered.append(l);
+	}
+	ASSERT_EQ(unordered.ranges.size(), 2u);
+	ASSERT_EQ(unordered.count(), 6u);
+	ASSERT_FALSE(unordered.contains(4));
+	unordered.append(4);
+	ASSERT_EQ(unordered.ranges.size(), 1u);
+	ASSERT_EQ(unordered.ranges[0].begin, 1u);
+	ASSERT_EQ(unordered.ranges[0].end, 8u);
+
+	std::array<uint32_t, 4> lines {2, 5, 11, 100};
+	ASSERT_EQ(foo.added.count_intersection(lines), 2u);
+	ASSERT_EQ(changed.files[1].added.count(), 1u);
+}
+
+TEST(ParsePatch, patch_id) {
+	PatchReader r;
+	// the expected ids are printed by `git patch-id --stable` and `git patch-id --unstable`
+	PatchIdPatch stable;
+	ASSERT_FALSE(r.by_buf(sample_patch, stable));
+	ASSERT_EQ(stable.hex(), "106d32d3d73a86a6762caa04632fa519a674f796");
+	PatchIdPatch unstable(false);
+	ASSERT_FALSE(r.by_buf(sample_patch, unstable));
+	ASSERT_EQ(unstable.hex(), "e5734dc916a09305b794e553a5322b5bb355c3ce");
+
+	ASSERT_EQ(stable.files.size(), 2u);
+	ASSERT_EQ(stable.files[0].hunk_hashes.size(), 2u);
+	ASSERT_EQ(stable.files[0].hunk_hashes[1], hash64("ten+tenandahalfeleven"));
+
+	std::string renamed =
+		"diff --git a/f1 b/f1r\n"
+		"similarity index 60%\n"
+		"rename from f1\n"
+		"rename to f1r\n"
+		"index de98044..0cfd46e 100644\n"
+		"--- a/f1\n"
+		"+++ b/f1r\n"
+		"@@ -1,3 +1,4 @@\n"
+		" a\n"
+		" b\n"
+		" c\n"
+		"+new\n"
+		"diff --git a/f2 b/f2\n"
+		"old mode 100644\n"
+		"new mode 100755\n";
+	stable.reset();
+	ASSERT_FALSE(r.by_buf(renamed, stable));
+	ASSERT_EQ(stable.files.size(), 2u);
+	ASSERT_EQ(stable.files[0].new_name, "f1r");
+	ASSERT_EQ(stable.files[0].hunk_hashes.size(), 1u);
+	ASSERT_EQ(stable.hex(), "5f391bbfa5aa3e155b25b3cc3b99fc7da93e00f6");
+
+	std::string stripped;
+	strip_spaces(" \tint  main ( void ) {\r\n return 0;   // a long enough line for the vector path\n", stripped);
+	ASSERT_EQ(stripped, "intmain(void){return0;//alongenoughlineforthevectorpath");
+}
+
+TEST(ParsePatch, compose) {
+	std::string first =
+		"diff --git a/x b/x\n"
+		"--- a/x\n"
+		"+++ b/x\n"
+		"@@ -2,4 +2,5 @@ a\n"
+		" b\n"
+		"-c\n"
+		"+C\n"
+		" d\n"
+		" e\n"
+		"+f\n";
+	std::string second =
+		"diff --git a/x b/x\n"
+		"--- a/x\n"
+		"+++ b/x\n"
+		"@@ -1,3 +1,2 @@\n"
+		" a\n"
+		"-b\n"
+		" C\n"
+		"@@ -5,2 +4,2 @@ d\n"
+		" e\n"
+		"-f\n"
+		"+F\n";
+	PatchReader r;
+	ColumnarPatch a, b;
+	a.reset(first);
+	b.reset(second);
+	ASSERT_FALSE(r.by_buf(first, a));
+	ASSERT_FALSE(r.by_buf(second, b));
+
+	std::array<const ColumnarPatch *, 2> patches {&a, &b};
+	auto composed = compose(patches);
+	ASSERT_TRUE(composed.conflicts.empty());
+	ASSERT_EQ(composed.files.size(), 1u);
+	ASSERT_EQ(composed.files[0].hunks.size(), 1u);
+	ASSERT_EQ(composed.files[0].hunks[0].numbers, (NumbersT {1, 5, 1, 5}));
+
+	// the same as `git diff` between the first and the last revisions prints
+	std::ostringstream text;
+	composed.write_unified(text);
+	ASSERT_EQ(text.str(),
+		"diff --git a/x b/x\n"
+		"--- a/x\n"
+		"+++ b/x\n"
+		"@@ -1,5 +1,5 @@\n"
+		" a\n"
+		"-b\n"
+		"-c\n"
+		"+C\n"
+		" d\n"
+		" e\n"
+		"+F\n");
+
+	// the second patch doesn't apply on top of the first one
+	std::array<const ColumnarPatch *, 2> reversed {&b, &a};
+	auto conflicting = compose(reversed);
+	ASSERT_FALSE(conflicting.conflicts.empty());
+	ASSERT_EQ(conflicting.conflicts[0].kind, ConflictKind::ContextMismatch);
+	ASSERT_EQ(conflicting.conflicts[0].patch, 1u);
+
+	// a missing line end is kept on the line it belongs to: `a\nb\nc` -> `a\nB\nc` -> `a\nB\nc\nd\n`
+	std::string change_b =
+		"diff --git a/y b/y\n"
+		"--- a/y\n"
+		"+++ b/y\n"
+		"@@ -1,3 +1,3 @@\n"
+		" a\n"
+		"-b\n"
+		"+B\n"
+		" c\n"
+		"\\ No newline at end of file\n";
+	std::string append_d =
+		"diff --git a/y b/y\n"
+		"--- a/y\n"
+		"+++ b/y\n"
+		"@@ -1,3 +1,4 @@\n"
+		" a\n"
+		" B\n"
+		"-c\n"
+		"\\ No newline at end of file\n"
+		"+c\n"
+		"+d\n";
+	ColumnarPatch c, d;
+	c.reset(change_b);
+	d.reset(append_d);
+	ASSERT_FALSE(r.by_buf(change_b, c));
+	ASSERT_FALSE(r.by_buf(append_d, d));
+	std::array<const ColumnarPatch *, 2> newline_patches {&c, &d};
+	auto appended = compose(newline_patches);
+	ASSERT_TRUE(appended.conflicts.empty());
+	std::ostringstream appended_text;
+	appended.write_unified(appended_text);
+	ASSERT_EQ(appended_text.str(),
+		"diff --git a/y b/y\n"
+		"--- a/y\n"
+		"+++ b/y\n"
+		"@@ -1,3 +1,4 @@\n"
+		" a\n"
+		"-b\n"
+		"-c\n"
+		"\\ No newline at end of file\n"
+		"+B\n"
+		"+c\n"
+		"+d\n");
+
+	// the second patch expects the line end the first one doesn't leave
+	std::array<const ColumnarPatch *, 2> twice {&d, &d};
+	ASSERT_FALSE(compose(twice).conflicts.empty());
+}
+
+TEST(ParsePatch, reverse) {
+	PatchReader r;
+	ColumnarPatch forward, backward;
+	forward.reset(sample_patch);
+	backward.reset(sample_patch);
+	ASSERT_FALSE(r.by_buf(sample_patch, forward));
+	ReversePatch reversed(backward);
+	ASSERT_FALSE(r.by_buf(sample_patch, reversed));
+
+	ASSERT_EQ(backward.diffs.size(), 2u);
+	ASSERT_EQ(backward.diffs.op[1], FileOpCode::Deleted);
+	ASSERT_EQ(backward.diffs.op_mode[1], 0100755u);
+	ASSERT_EQ(backward.diffs.new_name_length[1], 0u);
+	ASSERT_EQ(backward.view(backward.diffs.old_name_offset[1], backward.diffs.old_name_length[1]), "bar.txt");
+	ASSERT_EQ(backward.lines.kind[1], LineKind::Added);
+	ASSERT_EQ(backward.lines.new_line[1], 2u);
+	ASSERT_EQ(backward.lines.kind[2], LineKind::Removed);
+	ASSERT_EQ(backward.lines.old_line[2], 2u);
+	ASSERT_EQ(backward.lines.kind[7], LineKind::Removed);
+
+	// a patch followed by its reverse changes nothing
+	std::array<const ColumnarPatch *, 2> there_and_back {&forward, &backward};
+	auto composed = compose(there_and_back);
+	ASSERT_TRUE(composed.conflicts.empty());
+	ASSERT_TRUE(composed.files.empty());
+
+	NumbersT nums {10, 2, 10, 3};
+	reverse(nums);
+	ASSERT_EQ(nums, (NumbersT {10, 3, 10, 2}));
+	HunkLine line {0, 11, "ten and a half"};
+	reverse(line);
+	ASSERT_EQ(line.old_line, 11u);
+	ASSERT_EQ(line.new_line, 0u);
+}
+
+TEST(ParsePatch, writer) {
+	PatchReader r;
+	{
+		std::ostringstream text;
+		PatchWriter writer(text);
+		writer.source = sample_patch;
+		ASSERT_FALSE(r.by_buf(sample_patch, writer));
+		ASSERT_FALSE(writer.error);
+		ASSERT_EQ(text.str(), sample_patch);
+	}
+
+	{
+		std::string crlf =
+			"diff --git a/x b/x\r\n"
+			"--- a/x\r\n"
+			"+++ b/x\r\n"
+			"@@ -1,2 +1,2 @@\r\n"
+			" a\r\n"
+			"-b\r\n"
+			"+c\r\n";
+		std::ostringstream text;
+		PatchWriter writer(text);
+		writer.source = crlf;
+		ASSERT_FALSE(r.by_buf(crlf, writer));
+		ASSERT_EQ(text.str(), crlf);
+	}
+
+	{
+		// through writev, in a flush per diff
+		auto file = std::tmpfile();
+		ASSERT_NE(file, nullptr);
+		PatchWriter writer(fileno(file), 16);
+		writer.source = sample_patch;
+		writer.flush_every_diff = true;
+		for(auto &&event: patch_events(r, sample_patch)) {
+			writer.write(event);
+		}
+		writer.close();
+		ASSERT_FALSE(writer.error);
+
+		std::string written(sample_patch.size() + 1, '\0');
+		std::rewind(file);
+		written.resize(std::fread(written.data(), 1, written.size(), file));
+		std::fclose(file);
+		ASSERT_EQ(written, sample_patch);
+	}
+
+	{
+		// the raw headers describe the forward patch, so headers are generated
+		std::ostringstream text;
+		PatchWriter writer(text);
+		writer.source = sample_patch;
+		ReversePatch reversed(writer);
+		ASSERT_FALSE(r.by_buf(sample_patch, reversed));
+		ASSERT_EQ(text.str(),
+			"diff --git a/foo.txt b/foo.txt\n"
+			"--- a/foo.txt\n"
+			"+++ b/foo.txt\n"
+			"@@ -1,3 +1,3 @@\n"
+			" one\n"
+			"+two\n"
+			"-deux\n"
+			" three\n"
+			"@@ -10,3 +10,2 @@\n"
+			" ten\n"
+			"-ten and a half\n"
+			" eleven\n"
+			"diff --git a/bar.txt b/bar.txt\n"
+			"deleted file mode 100755\n"
+			"--- a/bar.txt\n"
+			"+++ /dev/null\n"
+			"@@ -1 +0,0 @@\n"
+			"-hello\n");
+
+		// and the text parses back into the reversed patch
+		auto reparsed_text = text.str();
+		ColumnarPatch reparsed, direct;
+		reparsed.reset(reparsed_text);
+		direct.reset(sample_patch);
+		ASSERT_FALSE(r.by_buf(reparsed_text, reparsed));
+		ReversePatch to_direct(direct);
+		ASSERT_FALSE(r.by_buf(sample_patch, to_direct));
+		ASSERT_EQ(reparsed.lines.kind, direct.lines.kind);
+		ASSERT_EQ(reparsed.lines.old_line, direct.lines.old_line);
+		ASSERT_EQ(reparsed.lines.new_line, direct.lines.new_line);
+		ASSERT_EQ(reparsed.diffs.op, direct.diffs.op);
+	}
+}
+
+/// Records the byte ranges of the diffs and the hunks
+struct RangesPatch: public Patch {
+	struct RangesDiff: public Diff {
+		RangesPatch *patch = nullptr;
+
+		virtual void set_info(const std::string_view, const std::string_view, FileOp, std::optional<std::vector<BinaryHunk>>, std::optional<FileMode>) override {
+		}
+
+		virtual void add_line(uint32_t, uint32_t, std::string_view &&) override {
+		}
+
+		using Diff::new_hunk;
+
+		virtual void new_hunk() override {
+		}
+
+		virtual void set_hunk_range(uint64_t begin, uint64_t end) override {
+			patch->hunks.emplace_back(begin, end);
+		}
+
+		virtual void set_range(uint64_t begin, uint64_t end) override {
+			patch->diffs.emplace_back(begin, end);
+		}
+
+		virtual void close() override {
+		}
+	} diff;
+
+	std::vector<std::pair<uint64_t, uint64_t>> diffs, hunks;
+
+	RangesPatch() {
+		diff.patch = this;
+	}
+
+	virtual Diff *new_diff() override {
+		return &diff;
+	}
+
+	virtual void close() override {
+	}
+};
+
+/// Sends a diff into the partition named by the first letter of its file
+struct FirstLetterPartitioner: public Partitioner {
+	virtual std::optional<size_t> partition_of(std::string_view old_name, std::string_view new_name) override {
+		auto name = new_name.empty() ? old_name : new_name;
+		if(name.starts_with('f')) {
+			return 0;
+		}
+		if(name.starts_with('b')) {
+			return 1;
+		}
+		return {};
+	}
+};
+
+TEST(ParsePatch, byte_ranges) {
+	std::string patch = "Subject: two files\n\n" + sample_patch.substr(0, sample_patch.find("diff --git a/bar")) +
+		"\\ No newline at end of file\n" + sample_patch.substr(sample_patch.find("diff --git a/bar")) + "-- \n2.39.0\n";
+	auto foo = patch.find("diff --git a/foo"), bar = patch.find("diff --git a/bar");
+	auto slice = [&](std::pair<uint64_t, uint64_t> range) {
+		return patch.substr(range.first, range.second - range.first);
+	};
+
+	PatchReader r;
+	RangesPatch ranges;
+	ASSERT_FALSE(r.by_buf(patch, ranges));
+	ASSERT_EQ(ranges.diffs.size(), 2u);
+	ASSERT_EQ(ranges.diffs[0], (std::pair<uint64_t, uint64_t> {foo, bar}));
+	ASSERT_EQ(ranges.diffs[1], (std::pair<uint64_t, uint64_t> {bar, patch.find("-- \n")}));
+	ASSERT_EQ(ranges.hunks.size(), 3u);
+	ASSERT_EQ(slice(ranges.hunks[0]), "@@ -1,3 +1,3 @@\n one\n-two\n+deux\n three\n");
+	ASSERT_EQ(slice(ranges.hunks[1]), "@@ -10,2 +10,3 @@\n ten\n+ten and a half\n eleven\n\\ No newline at end of file\n");
+	ASSERT_EQ(ranges.hunks[2].second, ranges.diffs[1].second);
+
+	// the same ranges when the input comes in pieces
+	RangesPatch chunked_ranges;
+	ChunkedPatchReader chunked;
+	SplittingSource source(patch, 7);
+	ASSERT_FALSE(chunked.parse(source, chunked_ranges));
+	ASSERT_EQ(chunked_ranges.diffs, ranges.diffs);
+	ASSERT_EQ(chunked_ranges.hunks, ranges.hunks);
+
+	std::ostringstream f, b;
+	PatchWriter f_writer(f), b_writer(b);
+	std::array<PatchWriter *, 2> outputs {&f_writer, &b_writer};
+	FirstLetterPartitioner partitioner;
+	PatchSplitter splitter;
+	splitter.keep_preamble = true;
+	ASSERT_FALSE(splitter.split(patch, partitioner, outputs));
+	ASSERT_EQ(f.str(), patch.substr(0, bar));
+	ASSERT_EQ(b.str(), patch.substr(0, foo) + slice(ranges.diffs[1]));
+}
+
+/// A `Patch` ignoring everything
+struct NullPatch: public Patch {
+	struct NullDiff: public Diff {
+		virtual void set_info(const std::string_view, const std::string_view, FileOp, std::optional<std::vector<BinaryHunk>>, std::optional<FileMode>) override {
+		}
+
+		virtual void add_line(uint32_t, uint32_t, std::string_view &&) override {
+		}
+
+		using Diff::new_hunk;
+
+		virtual void new_hunk() override {
+		}
+
+		virtual void close() override {
+		}
+	} diff;
+
+	virtual Diff *new_diff() override {
+		return &diff;
+	}
+
+	virtual void close() override {
+	}
+};
+
+/// Checks that parsing an input made of `n` repetitions takes time about linear in `n`: 8 times more input may take at most 20 times longer (a quadratic parse takes 64 times longer)
+static void expect_linear(const char *name, std::function<std::string(size_t)> make, size_t n) {
+	auto best_time = [](const std::string &input) {
+		auto best = std::chrono::steady_clock::duration::max();
+		for(int i = 0; i < 3; ++i) {
+			PatchReader r;
+			NullPatch p;
+			auto start = std::chrono::steady_clock::now();
+			(void) r.by_buf(input, p);
+			best = std::min(best, std::chrono::steady_clock::now() - start);
+		}
+		return std::chrono::duration<double>(best).count();
+	};
+	auto small = best_time(make(n)), large = best_time(make(8 * n));
+	// plus a millisecond against the noise of timing fast parses
+	EXPECT_LT(large, 20 * small + 1e-3) << name << ": " << small << "s for " << n << ", " << large << "s for " << 8 * n;
+}
+
+static std::string repeat(std::string_view piece, size_t n) {
+	std::string res;
+	res.reserve(piece.size() * n);
+	for(size_t i = 0; i < n; ++i) {
+		res.append(piece);
+	}
+	return res;
+}
+
+TEST(ParsePatch, linear_time) {
+	// every `---` looks ahead for a `diff -` line
+	expect_linear("--- lines", [](size_t n) {
+		return repeat("--- a\n", n);
+	}, 20000);
+	expect_linear("---/+++ without hunks", [](size_t n) {
+		return repeat("--- a/x\n+++ b/x\nx\n", n);
+	}, 20000);
+	expect_linear("diff lines", [](size_t n) {
+		return repeat("diff --git a/x b/x\n", n);
+	}, 20000);
+	expect_linear("a giant line", [](size_t n) {
+		return "diff --git a/" + std::string(n, 'x') + " b/x\n--- a/x\n+++ b/x\n@@ -1 +1 @@\n-" + std::string(n, 'y') + "\n+" + std::string(n, 'z');
+	}, 1 << 18);
+	expect_linear("literal blocks", [](size_t n) {
+		return "diff --git a/x b/x\nnew file mode 100644\nGIT binary patch\n" + repeat("literal 4294967295\nzcmV?d00001\n\n", n);
+	}, 20000);
+	expect_linear("literal without an end", [](size_t n) {
+		return "diff --git a/x b/x\nnew file mode 100644\nGIT binary patch\nliteral 1\n" + repeat("zcmV?d00001\n", n);
+	}, 20000);
+	expect_linear("huge hunk counts", [](size_t n) {
+		return "diff --git a/x b/x\n--- a/x\n+++ b/x\n" + repeat("@@ -1,4294967295 +1,4294967295 @@\n x\n\\ No newline at end of file\n", n);
+	}, 20000);
+	expect_linear("a huge hunk", [](size_t n) {
+		return "diff --git a/x b/x\n--- a/x\n+++ b/x\n@@ -1,4294967295 +1,4294967295 @@\n" + repeat(" x\n-y\n+z\n", n);
+	}, 20000);
+
+	// a truncated `@@` line is an error at its line, lines read ahead are counted once
+	std::string truncated = "diff --git a/x b/x\n--- a/x\n+++ b/x\n@@ -1 +1 @@\n-a\n+b\n@@ -1\n";
+	PatchReader r;
+	NullPatch p;
+	auto err = r.by_buf(truncated, p);
+	ASSERT_EQ(err.code, ParsepatchErrorCode::InvalidHunkHeader);
+	ASSERT_EQ(err.line_or_str, 7u);
+
+	// so are the lines jumped over by a `---` line looking ahead for a `diff -` line
+	std::string jumped = "--- a\nx\ny\n" + truncated;
+	err = r.by_buf(jumped, p);
+	ASSERT_EQ(err.code, ParsepatchErrorCode::InvalidHunkHeader);
+	ASSERT_EQ(err.line_or_str, 10u);
+}
+
+TEST(ParsePatch, windowed) {
+	std::string big_hunk = "diff --git a/gen b/gen\n--- a/gen\n+++ b/gen\n@@ -1,100000 +1,100000 @@\n";
+	for(size_t i = 0; i < 100000; ++i) {
+		big_hunk += (i % 3 ? " line " : (i % 2 ? "-old " : "+new ")) + std::to_string(i) + "\n";
+	}
+	std::string patch = "Subject: a large patch\n\n" + sample_patch + big_hunk + "\\ No newline at end of file\n" + repeat(sample_patch, 50);
+
+	PatchReader r;
+	PatchIdPatch whole;
+	RangesPatch whole_ranges;
+	ASSERT_FALSE(r.by_buf(patch, whole));
+	ASSERT_FALSE(r.by_buf(patch, whole_ranges));
+
+	for(auto [window_size, chunk_size]: {std::pair<size_t, size_t> {4096, 1000}, {4096, 1 << 20}, {1 << 16, 7}}) {
+		WindowedPatchReader wr(window_size);
+		PatchIdPatch windowed;
+		SplittingSource source(patch, chunk_size);
+		ASSERT_FALSE(wr.parse(source, windowed));
+		ASSERT_EQ(windowed.hex(), whole.hex());
+		ASSERT_EQ(windowed.files.size(), whole.files.size());
+		for(size_t i = 0; i < whole.files.size(); ++i) {
+			ASSERT_EQ(windowed.files[i].hash, whole.files[i].hash);
+			ASSERT_EQ(windowed.files[i].hunk_hashes, whole.files[i].hunk_hashes);
+		}
+
+		RangesPatch ranges;
+		SplittingSource ranges_source(patch, chunk_size);
+		ASSERT_FALSE(wr.parse(ranges_source, ranges));
+		ASSERT_EQ(ranges.diffs, whole_ranges.diffs);
+		ASSERT_EQ(ranges.hunks, whole_ranges.hunks);
+	}
+
+	// the body of a binary diff may be longer than the window, the headers cut by its end are read again
+	std::string binary = "diff --git a/blob b/blob\nnew file mode 100644\nindex 0000000..1111111\nGIT binary patch\nliteral 13000\n";
+	for(size_t i = 0; i < 200; ++i) {
+		binary += "zcmV" + std::string(62, 'a' + i % 26) + "\n";
+	}
+	binary += "\nliteral 0\nHcmV?d00001\n\n";
+	std::string binary_patch = repeat(sample_patch, 20) + binary + repeat(sample_patch, 20);
+	ColumnarPatch whole_binary;
+	whole_binary.reset(binary_patch);
+	ASSERT_FALSE(r.by_buf(binary_patch, whole_binary));
+	ASSERT_EQ(whole_binary.binary.size(), 2u);
+	for(size_t window_size: {4096, 4099, 4500, 5000}) {
+		WindowedPatchReader wr(window_size);
+		ColumnarPatch windowed;
+		windowed.reset(binary_patch);
+		SplittingSource source(binary_patch, 1000);
+		ASSERT_FALSE(wr.parse(source, windowed));
+		ASSERT_EQ(windowed.diffs.op, whole_binary.diffs.op);
+		ASSERT_EQ(windowed.binary.hunk_size, whole_binary.binary.hunk_size);
+		ASSERT_EQ(windowed.binary.type, whole_binary.binary.type);
+		ASSERT_EQ(windowed.lines.kind, whole_binary.lines.kind);
+		ASSERT_EQ(windowed.lines.new_line, whole_binary.lines.new_line);
+	}
+
+	// a line must fit into the window
+	std::string long_line = sample_patch + "diff --git a/x b/x\n--- a/x\n+++ b/x\n@@ -1 +1 @@\n-" + std::string(10000, 'x') + "\n+y\n";
+	WindowedPatchReader wr(4096);
+	NullPatch p;
+	SplittingSource source(long_line, 100);
+	auto err = wr.parse(source, p);
+	ASSERT_EQ(err.code, ParsepatchErrorCode::LineTooLong);
+	ASSERT_EQ(err.line_or_str, 25u);
+}
+
+TEST(ParsePatch, utf8) {
+	std::string text = "plain ASCII, then h\u00e9llo w\u00f6rld \u65e5\u672c\u8a9e \U0001F600 and ASCII again";
+	ASSERT_EQ(find_invalid_utf8(text), std::string_view::npos);
+	for(std::string_view bad: {"\xC0\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80", "\x80", "\xE6\x97"}) {
+		ASSERT_EQ(find_invalid_utf8(text + std::string(bad) + text), text.size()) << bad;
+	}
+	// a truncated sequence at the end is invalid
+	ASSERT_EQ(find_invalid_utf8(text + "\xE6\x97"), text.size());
+
+	size_t invalid;
+	auto line = text + "\xFF\n" + text;
+	ASSERT_EQ(find_eol_utf8(line, 0, invalid), text.size() + 1);
+	ASSERT_EQ(invalid, text.size());
+	ASSERT_EQ(find_eol_utf8(line, text.size() + 2, invalid), std::string_view::npos);
+	ASSERT_EQ(invalid, std::string_view::npos);
+
+	auto replace = [](std::string s, std::string_view what, std::string_view with) {
+		for(auto pos = s.find(what); pos != std::string::npos; pos = s.find(what, pos + with.size())) {
+			s.replace(pos, what.size(), with);
+		}
+		return s;
+	};
+	auto bad_line = replace(sample_patch, "+deux", "+deu\xFF");
+	auto bad_name = replace(sample_patch, "foo.txt", "f\xC3o.txt");
+	auto bad_tail = sample_patch + "\xFF";
+
+	auto parse = [](const std::string &patch, Utf8Check check) {
+		PatchReader r;
+		r.utf8_check = check;
+		NullPatch p;
+		return r.by_buf(patch, p);
+	};
+	ASSERT_FALSE(parse(bad_line, Utf8Check::None));
+	ASSERT_FALSE(parse(bad_line, Utf8Check::Filenames));
+	ASSERT_FALSE(parse(sample_patch, Utf8Check::All));
+	for(auto [patch, check, line]: {std::tuple {&bad_line, Utf8Check::All, 8u}, {&bad_name, Utf8Check::Filenames, 1u}, {&bad_name, Utf8Check::All, 1u}, {&bad_tail, Utf8Check::All, 21u}}) {
+		auto err = parse(*patch, check);
+		ASSERT_EQ(err.code, ParsepatchErrorCode::InvalidString);
+		ASSERT_EQ(err.line_or_str, line);
+
+		// the same in pieces
+		NullPatch p;
+		ChunkedPatchReader chunked;
+		chunked.reader.utf8_check = check;
+		SplittingSource source(*patch, 7);
+		err = chunked.parse(source, p);
+		ASSERT_EQ(err.code, ParsepatchErrorCode::InvalidString);
+		ASSERT_EQ(err.line_or_str, line);
+
+		WindowedPatchReader windowed(256);
+		windowed.reader.utf8_check = check;
+		SplittingSource window_source(*patch, 7);
+		err = windowed.parse(window_source, p);
+		ASSERT_EQ(err.code, ParsepatchErrorCode::InvalidString);
+		ASSERT_EQ(err.line_or_str, line);
+
+		PatchReader events_reader;
+		events_reader.utf8_check = check;
+		err = {};
+		for(auto &&event: patch_events(events_reader, *patch)) {
+			if(event.kind == PatchEventKind::Error) {
+				err = event.error;
+			}
+		}
+		ASSERT_EQ(err.code, ParsepatchErrorCode::InvalidString);
+		ASSERT_EQ(err.line_or_str, line);
+	}
+
+	auto reader = parsepatch_reader_new();
+	ASSERT_NE(parsepatch_set_utf8_check(reader, PARSEPATCH_UTF8_ALL + 1), 0);
+	ASSERT_EQ(parsepatch_set_utf8_check(reader, PARSEPATCH_UTF8_ALL), 0);
+	auto err = parsepatch_parse(reader, bad_line.data(), bad_line.size());
+	ASSERT_EQ(err.code, PARSEPATCH_INVALID_STRING);
+	ASSERT_EQ(err.line, 8u);
+	parsepatch_reader_free(reader);
+}
+
+TEST(ParsePatch, json) {
+	std::string out;
+	ASSERT_FALSE(patch_to_json(sample_patch, out));
+	ASSERT_EQ(out,
+		"{\"diffs\":["
+		"{\"filename\":\"foo.txt\",\"new\":false,\"deleted\":false,\"binary\":false,\"renamed_from\":null,\"copied_from\":null,\"file_mode\":null,\"hunks\":["
+		"{\"lines\":[{\"line\":2,\"deleted\":true,\"data\":\"two\"},{\"line\":2,\"deleted\":false,\"data\":\"deux\"}]},"
+		"{\"lines\":[{\"line\":11,\"deleted\":false,\"data\":\"ten and a half\"}]}]},"
+		"{\"filename\":\"bar.txt\",\"new\":true,\"deleted\":false,\"binary\":false,\"renamed_from\":null,\"copied_from\":null,\"file_mode\":{\"old\":0,\"new\":33261},\"hunks\":["
+		"{\"lines\":[{\"line\":1,\"deleted\":false,\"data\":\"hello\"}]}]}]}");
+
+	// the writer is reused for the next document
+	out.clear();
+	JsonWriter writer(out);
+	writer.close();
+	ASSERT_EQ(out, "{\"diffs\":[]}");
+
+	std::string escaped;
+	append_json_escaped("a \"quoted\" C:\\path\twith\x01 control and a long enough run of plain text \xFF\u00e9", escaped);
+	ASSERT_EQ(escaped, "a \\\"quoted\\\" C:\\\\path\\twith\\u0001 control and a long enough run of plain text \uFFFD\u00e9");
+}
+
+TEST(ParsePatch, event_log) {
+	std::string patch = sample_patch +
+		"diff --git a/eof.txt b/eof.txt\n"
+		"--- a/eof.txt\n"
+		"+++ b/eof.txt\n"
+		"@@ -1,2 +1,2 @@\n"
+		" a\n"
+		"-b\n"
+		"\\ No newline at end of file\n"
+		"+c\n"
+		"\\ No newline at end of file\n"
+		"diff --git a/old.txt b/new.txt\n"
+		"similarity index 100%\n"
+		"rename from old.txt\n"
+		"rename to new.txt\n"
+		"diff --git a/img.png b/img.png\n"
+		"old mode 100644\n"
+		"new mode 100755\n"
+		"index 1111111..2222222\n"
+		"GIT binary patch\n"
+		"literal 4\n"
+		"LcmZQzWMT#Y01f~L\n"
+		"\n"
+		"literal 0\n"
+		"HcmV?d00001\n"
+		"\n";
+
+	PatchReader r;
+	EventLogWriter recorder(patch);
+	ASSERT_FALSE(r.by_buf(patch, recorder));
+	// much less than the text
+	ASSERT_LT(recorder.log.size(), patch.size() / 3);
+
+	// every consumer gets the same callbacks as from the parse, as many times as needed
+	std::string parsed_json, replayed_json;
+	JsonWriter parsed_writer(parsed_json);
+	ASSERT_FALSE(r.by_buf(patch, parsed_writer));
+	for(int i = 0; i < 2; ++i) {
+		replayed_json.clear();
+		JsonWriter replayed_writer(replayed_json);
+		ASSERT_TRUE(replay_event_log(recorder.log, patch, replayed_writer));
+		ASSERT_EQ(replayed_json, parsed_json);
+	}
+
+	RangesPatch parsed_ranges, replayed_ranges;
+	ASSERT_FALSE(r.by_buf(patch, parsed_ranges));
+	ASSERT_TRUE(replay_event_log(recorder.log, patch, replayed_ranges));
+	ASSERT_EQ(replayed_ranges.diffs, parsed_ranges.diffs);
+	ASSERT_EQ(replayed_ranges.hunks, parsed_ranges.hunks);
+
+	// raw headers, the lines without a line end and the byte ranges of binary diffs reach the writer, so the output is the same text
+	std::ostringstream written;
+	PatchWriter writer(written);
+	writer.source = patch;
+	ASSERT_TRUE(replay_event_log(recorder.log, patch, writer));
+	ASSERT_FALSE(writer.error);
+	ASSERT_EQ(written.str(), patch);
+
+	// the data of a reversed binary diff is not in the source
+	std::ostringstream reversed_text;
+	PatchWriter reversed_writer(reversed_text);
+	reversed_writer.source = patch;
+	ReversePatch reversed(reversed_writer);
+	ASSERT_FALSE(r.by_buf(patch, reversed));
+	ASSERT_EQ(reversed_writer.error, std::errc::invalid_argument);
+
+	// damaged logs and other sources are rejected
+	NullPatch p;
+	ASSERT_FALSE(replay_event_log(recorder.log, patch.substr(1), p));
+	ASSERT_FALSE(replay_event_log(std::string_view(recorder.log).substr(0, recorder.log.size() / 2), patch, p));
+	ASSERT_FALSE(replay_event_log("not a log", patch, p));
+}
+
+TEST(ParsePatch, path_interner) {
+	PathInterner interner;
+	ASSERT_EQ(interner.intern(""), PathInterner::no_path);
+	auto foo = interner.intern("foo.txt");
+	ASSERT_EQ(interner.intern(std::string("foo.txt")), foo);
+	ASSERT_EQ(interner.path(foo), "foo.txt");
+	ASSERT_FALSE(interner.find("bar.txt"));
+
+	// threads interning the same names at once get the same ids, the tables grow meanwhile
+	const size_t names = 20000;
+	auto name = [](size_t i) {
+		return "src/dir" + std::to_string(i % 7) + "/file" + std::to_string(i) + ".cpp";
+	};
+	std::vector<std::vector<uint32_t>> ids(4);
+	{
+		std::vector<std::jthread> threads;
+		for(size_t t = 0; t < ids.size(); ++t) {
+			threads.emplace_back([&, t] {
+				for(size_t i = 0; i < names; ++i) {
+					ids[t].emplace_back(interner.intern(name((i * (2 * t + 1)) % names)));
+				}
+			});
+		}
+	}
+	ASSERT_EQ(interner.size(), names + 2);
+	for(size_t t = 0; t < ids.size(); ++t) {
+		for(size_t i = 0; i < names; ++i) {
+			auto n = name((i * (2 * t + 1)) % names);
+			ASSERT_EQ(interner.path(ids[t][i]), n);
+			ASSERT_EQ(interner.find(n), ids[t][i]);
+		}
+	}
+
+	// the ids reach the diffs of all the readers of parse_many
+	struct IdsPatch: public Patch {
+		struct IdsDiff: public Diff {
+			IdsPatch *patch;
+			std::string_view old_name, new_name;
+
+			virtual void set_info(const std::string_view old_name, const std::string_view new_name, FileOp, std::optional<std::vector<BinaryHunk>>, std::optional<FileMode>) override {
+				this->old_name = old_name;
+				this->new_name = new_name;
+			}
+
+			virtual void set_path_ids(uint32_t old_id, uint32_t new_id) override {
+				patch->ids.emplace_back(old_name, old_id);
+				patch->ids.emplace_back(new_name, new_id);
+			}
+
+			virtual void add_line(uint32_t, uint32_t, std::string_view &&) override {
+			}
+
+			using Diff::new_hunk;
+
+			virtual void new_hunk() override {
+			}
+
+			virtual void close() override {
+			}
+		} diff;
+		std::vector<std::pair<std::string_view, uint32_t>> ids;
+
+		IdsPatch() {
+			diff.patch = this;
+		}
+
+		virtual Diff *new_diff() override {
+			return &diff;
+		}
+
+		virtual void close() override {
+		}
+	};
+	struct Factory: public PatchFactory {
+		std::vector<IdsPatch> patches;
+
+		Factory(size_t count): patches(count) {}
+
+		virtual Patch *patch_for(size_t index, size_t) override {
+			return &patches[index];
+		}
+	};
+
+	std::vector<std::string_view> inputs(1000, sample_patch);
+	Factory factory(inputs.size());
+	parse_many(inputs, factory, 4, &interner);
+	for(auto &p: factory.patches) {
+		ASSERT_EQ(p.ids.size(), 4u);
+		for(auto [n, id]: p.ids) {
+			ASSERT_EQ(interner.path(id), n);
+		}
+		ASSERT_EQ(p.ids[0].second, foo);
+	}
+	ASSERT_EQ(interner.find("bar.txt"), factory.patches[0].ids[3].second);
+
+	// reversing swaps them
+	PatchReader r {};
+	r.interner = &interner;
+	IdsPatch forward, reversed;
+	ReversePatch reverse(reversed);
+	ASSERT_FALSE(r.by_buf(sample_patch, forward));
+	ASSERT_FALSE(r.by_buf(sample_patch, reverse));
+	ASSERT_EQ(reversed.ids[2].second, forward.ids[3].second);
+	ASSERT_EQ(reversed.ids[3].second, forward.ids[2].second);
+}
+
+TEST(ParsePatch, churn) {
+	std::vector<std::string> history {
+		"diff --git a/src/a.c b/src/a.c\n"
+		"new file mode 100644\n"
+		"index 0000000..1111111\n"
+		"--- /dev/null\n"
+		"+++ b/src/a.c\n"
+		"@@ -0,0 +1,3 @@\n"
+		"+a\n"
+		"+b\n"
+		"+c\n",
+		"diff --git a/src/a.c b/src/a.c\n"
+		"index 1111111..2222222 100644\n"
+		"--- a/src/a.c\n"
+		"+++ b/src/a.c\n"
+		"@@ -2 +2 @@\n"
+		"-b\n"
+		"+B\n",
+		"diff --git a/src/a.c b/lib/b.c\n"
+		"similarity index 80%\n"
+		"rename from src/a.c\n"
+		"rename to lib/b.c\n"
+		"index 2222222..3333333 100644\n"
+		"--- a/src/a.c\n"
+		"+++ b/lib/b.c\n"
+		"@@ -3,0 +4 @@\n"
+		"+d\n",
+		// the freed name is a new file
+		"diff --git a/src/a.c b/src/a.c\n"
+		"new file mode 100644\n"
+		"index 0000000..4444444\n"
+		"--- /dev/null\n"
+		"+++ b/src/a.c\n"
+		"@@ -0,0 +1,2 @@\n"
+		"+x\n"
+		"+y\n",
+		"diff --git a/lib/b.c b/lib/c.c\n"
+		"similarity index 100%\n"
+		"copy from lib/b.c\n"
+		"copy to lib/c.c\n"
+		"diff --git a/lib/b.c b/lib/b.c\n"
+		"index 3333333..5555555 100644\n"
+		"--- a/lib/b.c\n"
+		"+++ b/lib/b.c\n"
+		"@@ -1,2 +1 @@\n"
+		"-a\n"
+		" B\n",
+		"diff --git a/x b/x\n--- a/x\n+++ b/x\n@@ -1,\n",
+	};
+	std::vector<std::string_view> commits(begin(history), end(history));
+	PathInterner paths;
+	auto report = compute_churn(commits, paths, 3);
+
+	auto file = [&](std::string_view name) {
+		return report.files[*paths.find(name)];
+	};
+	auto directory = [&](std::string_view name) {
+		return report.directories[*paths.find(name)];
+	};
+	auto expect = [](ChurnStats stats, uint64_t added, uint64_t removed, uint64_t commits) {
+		ASSERT_EQ(stats.added, added);
+		ASSERT_EQ(stats.removed, removed);
+		ASSERT_EQ(stats.commits, commits);
+	};
+	// the history of src/a.c before the rename is lib/b.c's
+	expect(file("lib/b.c"), 5, 2, 4);
+	expect(file("src/a.c"), 2, 0, 1);
+	expect(file("lib/c.c"), 0, 0, 1);
+	// the copy and the change of lib/b.c are one commit of lib
+	expect(directory("lib"), 5, 2, 4);
+	expect(directory("src"), 2, 0, 1);
+
+	ASSERT_EQ(report.renames.size(), 2u);
+	ASSERT_EQ(report.renames[0].commit, 2u);
+	ASSERT_EQ(paths.path(report.renames[0].from), "src/a.c");
+	ASSERT_FALSE(report.renames[0].copy);
+	ASSERT_EQ(paths.path(report.renames[1].to), "lib/c.c");
+	ASSERT_TRUE(report.renames[1].copy);
+	ASSERT_EQ(report.failed, (std::vector<size_t> {5}));
+}
+
+TEST(ParsePatch, recovery) {
+	std::string patch =
+		"diff --git a/a.txt b/a.txt\n"
+		"--- a/a.txt\n"
+		"+++ b/a.txt\n"
+		"@@ -1 +1 @@\n"
+		"-a\n"
+		"+b\n"
+		"diff --git a/bad.txt b/bad.txt\n"
+		"--- a/bad.txt\n"
+		"+++ b/bad.txt\n"
+		"@@ -1 +1 @@\n"
+		"-x\n"
+		"+y\n"
+		"@@ -3 @@\n"
+		" z\n"
+		"diff --git a/c.txt b/c.txt\n"
+		"--- a/c.txt\n"
+		"+++ b/c.txt\n"
+		"@@ -1 +1 @@\n"
+		"-c\n"
+		"+d\n"
+		"diff --git a/mode.txt b/mode.txt\n"
+		"old mode 100644\n";
+	PatchReader r {};
+	RangesPatch p;
+	auto err = r.by_buf(patch, p);
+	ASSERT_EQ(err.code, ParsepatchErrorCode::InvalidHunkHeader);
+	ASSERT_EQ(err.line_or_str, 13u);
+	ASSERT_TRUE(r.errors.empty());
+
+	p.diffs.clear();
+	r.recover = true;
+	ASSERT_FALSE(r.by_buf(patch, p));
+	ASSERT_EQ(r.errors.size(), 2u);
+	ASSERT_EQ(r.errors[0].error.code, ParsepatchErrorCode::InvalidHunkHeader);
+	ASSERT_EQ(r.errors[0].error.line_or_str, 13u);
+	ASSERT_EQ(r.errors[0].offset, patch.find("@@ -3"));
+	ASSERT_TRUE(r.errors[0].truncated);
+	ASSERT_EQ(r.errors[1].error.code, ParsepatchErrorCode::NewModeExpected);
+	// the line expected after the end
+	ASSERT_EQ(r.errors[1].error.line_or_str, 23u);
+	ASSERT_EQ(r.errors[1].offset, patch.size());
+	ASSERT_FALSE(r.errors[1].truncated);
+	// the good diffs and the start of the broken one
+	ASSERT_EQ(p.diffs.size(), 3u);
+	ASSERT_EQ(p.diffs[0].second, patch.find("diff --git a/bad"));
+	ASSERT_EQ(p.diffs[1].first, patch.find("diff --git a/bad"));
+	ASSERT_EQ(p.diffs[2].first, patch.find("diff --git a/c.txt"));
+	ASSERT_EQ(p.diffs[2].second, patch.find("diff --git a/mode"));
+
+	// the same in pieces
+	ChunkedPatchReader chunked;
+	chunked.reader.recover = true;
+	SplittingSource source(patch, 7);
+	ASSERT_FALSE(chunked.parse(source, p));
+	ASSERT_EQ(chunked.reader.errors.size(), 2u);
+	ASSERT_EQ(chunked.reader.errors[0].offset, r.errors[0].offset);
+	ASSERT_EQ(chunked.reader.errors[1].offset, r.errors[1].offset);
+
+	// an invalid line is recorded per diff, the parse goes on
+	r.utf8_check = Utf8Check::All;
+	auto bad_line = patch;
+	bad_line.replace(patch.find("+b"), 2, "+\xFF");
+	ASSERT_FALSE(r.by_buf(bad_line, p));
+	ASSERT_EQ(r.errors.size(), 3u);
+	ASSERT_EQ(r.errors[0].error.code, ParsepatchErrorCode::InvalidString);
+	ASSERT_EQ(r.errors[0].error.line_or_str, 6u);
+	ASSERT_EQ(r.errors[0].offset, patch.find("+b"));
+	ASSERT_FALSE(r.errors[0].truncated);
+}
+
+TEST(ParsePatch, search) {
+	std::vector<std::string_view> patterns {"he", "she", "his", "hers", "AKIA"};
+	LiteralSearcher searcher(patterns);
+	std::vector<LiteralSearcher::Hit> hits;
+	searcher.find("ushers", hits);
+	ASSERT_EQ(hits.size(), 3u);
+	ASSERT_EQ(hits[0].pattern, 1u);
+	ASSERT_EQ(hits[0].begin, 1u);
+	ASSERT_EQ(hits[1].pattern, 0u);
+	ASSERT_EQ(hits[1].begin, 2u);
+	ASSERT_EQ(hits[2].pattern, 3u);
+
+	// the vectorized skip and the table one find the same, at any position of a block
+	std::string text(100, '.');
+	text.replace(37, 4, "AKIA");
+	text.replace(90, 2, "he");
+	for(auto set: {std::vector<std::string_view> {"AKIA", "he"}, patterns}) {
+		LiteralSearcher s(set);
+		hits.clear();
+		s.find(text, hits);
+		ASSERT_EQ(hits.size(), 2u);
+		ASSERT_EQ(hits[0].begin, 37u);
+		ASSERT_EQ(hits[1].begin, 90u);
+	}
+
+	std::string patch = sample_patch +
+		"diff --git a/keys.txt b/keys.txt\n"
+		"--- a/keys.txt\n"
+		"+++ b/keys.txt\n"
+		"@@ -1,2 +1,2 @@\n"
+		" she said\n"
+		"-key AKIAOLD\n"
+		"+key AKIANEW\n";
+	PatchReader r {};
+	std::vector<SearchMatch> matches;
+	ASSERT_FALSE(search_patch(r, patch, searcher, SearchSide::Added, matches));
+	// "hello" of bar.txt and the new key, not the context line
+	ASSERT_EQ(matches.size(), 2u);
+	ASSERT_EQ(matches[0].file, "bar.txt");
+	ASSERT_EQ(matches[0].line, 1u);
+	ASSERT_EQ(matches[0].column, 1u);
+	ASSERT_EQ(matches[1].file, "keys.txt");
+	ASSERT_EQ(matches[1].line, 2u);
+	ASSERT_EQ(matches[1].column, 5u);
+	ASSERT_EQ(matches[1].pattern, 4u);
+
+	matches.clear();
+	ASSERT_FALSE(search_patch(r, patch, searcher, SearchSide::Removed, matches));
+	ASSERT_EQ(matches.size(), 1u);
+	ASSERT_EQ(matches[0].line, 2u);
+}
+
+/// Records the `@@` lines and the size hints
+struct HunksPatch: public Patch {
+	struct HunksDiff: public Diff {
+		HunksPatch *patch = nullptr;
+
+		virtual void set_info(const std::string_view, const std::string_view, FileOp, std::optional<std::vector<BinaryHunk>>, std::optional<FileMode>) override {
+		}
+
+		virtual void size_hint(uint32_t hunks, uint64_t lines) override {
+			patch->hints.emplace_back(hunks, lines);
+		}
+
+		virtual void add_line(uint32_t, uint32_t, std::string_view &&) override {
+		}
+
+		virtual void new_hunk() override {
+			patch->nums.emplace_back();
+			patch->sections.emplace_back();
+		}
+
+		virtual void new_hunk(const NumbersT &nums, std::string_view section) override {
+			patch->nums.emplace_back(nums);
+			patch->sections.emplace_back(section);
+		}
+
+		virtual void close() override {
+		}
+	} diff;
+
+	std::vector<NumbersT> nums;
+	std::vector<std::string> sections;
+	std::vector<std::pair<uint32_t, uint64_t>> hints;
+
+	HunksPatch() {
+		diff.patch = this;
+	}
+
+	virtual Diff *new_diff() override {
+		return &diff;
+	}
+
+	virtual void close() override {
+	}
+};
+
+TEST(ParsePatch, hunk_headers) {
+	std::string patch =
+		"diff --git a/f.c b/f.c\n"
+		"--- a/f.c\n"
+		"+++ b/f.c\n"
+		"@@ -1,2 +1,3 @@ int main()\n"
+		" a\n"
+		"+b\n"
+		" c\n"
+		"@@ -10 +11,2 @@\n"
+		"-x\n"
+		"+y\n"
+		"+z\n";
+	PatchReader r {};
+	HunksPatch p;
+	ASSERT_FALSE(r.by_buf(patch, p));
+	ASSERT_EQ(p.nums.size(), 2u);
+	ASSERT_EQ(p.nums[0], (NumbersT {1, 2, 1, 3}));
+	// every hunk has its own numbers
+	ASSERT_EQ(p.nums[1], (NumbersT {10, 1, 11, 2}));
+	ASSERT_EQ(p.sections[0], "int main()");
+	ASSERT_EQ(p.sections[1], "");
+	ASSERT_TRUE(p.hints.empty());
+
+	ReversePatch reversed(p);
+	p.nums.clear();
+	ASSERT_FALSE(r.by_buf(patch, reversed));
+	ASSERT_EQ(p.nums[1], (NumbersT {11, 2, 10, 1}));
+
+	// the section heading is written back
+	std::ostringstream written;
+	PatchWriter writer(written);
+	writer.source = patch;
+	ASSERT_FALSE(r.by_buf(patch, writer));
+	ASSERT_EQ(written.str(), patch);
+
+	EventLogWriter recorder(patch);
+	ASSERT_FALSE(r.by_buf(patch, recorder));
+	p.nums.clear();
+	p.sections.clear();
+	ASSERT_TRUE(replay_event_log(recorder.log, patch, p));
+	ASSERT_EQ(p.nums[1], (NumbersT {10, 1, 11, 2}));
+	ASSERT_EQ(p.sections[0], "int main()");
+
+	// a snapshot knows the sizes of the diffs before their hunks
+	SnapshotWriter snapshot;
+	snapshot.reset(patch);
+	ASSERT_FALSE(r.by_buf(patch, snapshot));
+	auto view = SnapshotView::open(snapshot.image);
+	ASSERT_TRUE(view.has_value());
+	ASSERT_TRUE(view->replay(patch, p));
+	ASSERT_EQ(p.hints.size(), 1u);
+	ASSERT_EQ(p.hints[0], (std::pair<uint32_t, uint64_t> {2, 6}));
+}
+
+TEST(ParsePatch, incremental) {
+	auto diff = [](std::string_view name, std::string_view line) {
+		return "diff --git a/" + std::string(name) + " b/" + std::string(name) + "\n--- a/" + std::string(name) + "\n+++ b/" + std::string(name) + "\n@@ -1,2 +1,2 @@\n context\n-" + std::string(line) + "\n+" + std::string(line) + "!\n";
+	};
+	std::string text = "intro\n";
+	for(auto name: {"a.txt", "b.txt", "c.txt", "d.txt", "e.txt"}) {
+		text += diff(name, name);
+	}
+
+	IncrementalParser incremental;
+	RangesPatch p;
+	ASSERT_FALSE(incremental.parse(text, p));
+	ASSERT_EQ(incremental.diffs.size(), 5u);
+
+	// every edit gives the index of a full parse, passing only the reparsed diffs
+	auto edit = [&](size_t begin, size_t removed, std::string_view inserted, size_t first, size_t reparsed, size_t added) {
+		SCOPED_TRACE(text.substr(begin, removed) + " -> " + std::string(inserted));
+		text.replace(begin, removed, inserted);
+		p.diffs.clear();
+		DiffsChange change;
+		ASSERT_FALSE(incremental.reparse(text, begin, removed, inserted.size(), p, change));
+		ASSERT_EQ(change.first, first);
+		ASSERT_EQ(change.removed, reparsed);
+		ASSERT_EQ(change.inserted, added);
+		ASSERT_EQ(p.diffs.size(), added);
+
+		IncrementalParser full;
+		RangesPatch q;
+		ASSERT_FALSE(full.parse(text, q));
+		ASSERT_EQ(incremental.diffs.size(), full.diffs.size());
+		for(size_t d = 0; d < full.diffs.size(); ++d) {
+			ASSERT_EQ(incremental.diffs[d].begin, full.diffs[d].begin) << d;
+			ASSERT_EQ(incremental.diffs[d].end, full.diffs[d].end) << d;
+			ASSERT_EQ(incremental.diffs[d].line, full.diffs[d].line) << d;
+		}
+	};
+	// a line changed in c.txt
+	edit(text.find("-c.txt") + 1, 1, "see", 2, 1, 1);
+	// a line broken in two: the hunk ends earlier
+	edit(text.find(" context", text.find("b.txt")) + 4, 0, "\n", 1, 1, 1);
+	// a diff inserted before d.txt, on the first line of d.txt which c.txt read
+	edit(text.find("diff --git a/d.txt"), 0, diff("new.txt", "x"), 2, 2, 3);
+	// the first line of e.txt changed
+	edit(text.find("diff --git a/e.txt") + 13, 5, "f.txt", 4, 2, 2);
+	// a diff made of the lines before the first one
+	edit(0, 5, "diff --git a/z b/z\nold mode 100644\nnew mode 100755", 0, 0, 1);
+	// the last diff removed
+	auto last = text.find("diff --git a/f.txt");
+	edit(last, text.size() - last, "", 5, 2, 1);
+	ASSERT_EQ(incremental.diffs.back().end, text.size());
+
+	// an edit not fitting the buffer reparses everything
+	DiffsChange change;
+	ASSERT_FALSE(incremental.reparse(text, 0, text.size() + 1, 0, p, change));
+	ASSERT_EQ(change.first, 0u);
+	ASSERT_EQ(change.inserted, incremental.diffs.size());
+
+	// a broken header doesn't take the `diff -` line after it, which the reparse doesn't reach
+	auto header_edit = [](std::string text, size_t begin, size_t removed, std::string_view inserted) {
+		SCOPED_TRACE(text.substr(begin, removed) + " -> " + std::string(inserted));
+		IncrementalParser incremental;
+		incremental.reader.recover = true;
+		RangesPatch p;
+		ASSERT_FALSE(incremental.parse(text, p));
+		text.replace(begin, removed, inserted);
+		DiffsChange change;
+		ASSERT_FALSE(incremental.reparse(text, begin, removed, inserted.size(), p, change));
+
+		IncrementalParser full;
+		full.reader.recover = true;
+		ASSERT_FALSE(full.parse(text, p));
+		ASSERT_EQ(incremental.diffs.size(), full.diffs.size());
+		for(size_t d = 0; d < full.diffs.size(); ++d) {
+			ASSERT_EQ(incremental.diffs[d].begin, full.diffs[d].begin) << d;
+			ASSERT_EQ(incremental.diffs[d].end, full.diffs[d].end) << d;
+			ASSERT_EQ(incremental.diffs[d].line, full.diffs[d].line) << d;
+		}
+	};
+	std::string renamed = "diff --git a/r b/s\nsimilarity index 90%\nrename from r\nrename to s\nxyz\ndiff --git a/m b/m\nold mode 100644\nnew mode 100755\n";
+	// the line end of `rename from` deleted: the `rename to` line is missing
+	header_edit(renamed, renamed.find("\nrename to"), 1, "");
+	// a `---` line typed before the next diff: its `+++` line is missing
+	header_edit(renamed, renamed.find("xyz"), 3, "--- a");
+}
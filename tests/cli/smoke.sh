@@ -0,0 +1,57 @@
+#!/bin/sh
+# Smoke test of the parsepatch command-line tool: smoke.sh <path of parsepatch>
+set -u
+
+parsepatch="$1"
+work="$(mktemp -d)"
+trap 'rm -rf "$work"' EXIT
+failures=0
+
+fail() {
+	echo "FAIL: $1" >&2
+	failures=$((failures + 1))
+}
+
+cat > "$work/sample.patch" <<'PATCH'
+diff --git a/foo.txt b/foo.txt
+--- a/foo.txt
++++ b/foo.txt
+@@ -1,3 +1,3 @@
+ un
+-deux
++two
+ trois
+diff --git a/dir/bar.txt b/dir/bar.txt
+new file mode 100644
+--- /dev/null
++++ b/dir/bar.txt
+@@ -0,0 +1 @@
++hello
+PATCH
+
+expected="$(printf '1\t1\tfoo.txt\n1\t0\tdir/bar.txt\n2\t1\t2 files')"
+
+[ "$("$parsepatch" stat "$work/sample.patch")" = "$expected" ] || fail "stat of a file"
+[ "$("$parsepatch" stat - < "$work/sample.patch")" = "$expected" ] || fail "stat of -"
+
+# a pipe has no size, it must be read rather than taken as empty
+[ "$(cat "$work/sample.patch" | "$parsepatch" stat /dev/stdin)" = "$expected" ] || fail "stat of a pipe"
+mkfifo "$work/fifo"
+cat "$work/sample.patch" > "$work/fifo" &
+[ "$("$parsepatch" stat "$work/fifo")" = "$expected" ] || fail "stat of a FIFO"
+wait
+
+[ "$("$parsepatch" filter --path dir "$work/sample.patch")" = "$(tail -n 6 "$work/sample.patch")" ] || fail "filter"
+
+"$parsepatch" split -o "$work/split" "$work/sample.patch" || fail "split"
+[ "$(cat "$work/split/dir.patch")" = "$(tail -n 6 "$work/sample.patch")" ] || fail "split into directories"
+
+"$parsepatch" stat "$work/missing.patch" 2> /dev/null && fail "a missing input succeeds"
+
+# a failed write is an error
+if [ -w /dev/full ]; then
+	"$parsepatch" filter --path dir "$work/sample.patch" > /dev/full 2> /dev/null && fail "filter into a full device succeeds"
+	"$parsepatch" stat "$work/sample.patch" > /dev/full 2> /dev/null && fail "stat into a full device succeeds"
+fi
+
+exit "$failures"
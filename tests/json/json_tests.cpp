@@ -33,6 +33,10 @@ struct DiffImpl: public Diff {
 				pd->filename = new_name;
 				pd->renamed_from = old_name;
 				break;
+			case FileOpCode::Copied:
+				pd->filename = new_name;
+				pd->copied_from = old_name;
+				break;
 			default:
 				pd->filename = new_name;
 		}
@@ -64,6 +68,8 @@ struct DiffImpl: public Diff {
 		}
 	}
 
+	using Diff::new_hunk;
+
 	virtual void new_hunk() override {
 		pd->hunks.emplace_back(Hunk {});
 	}